@@ -24,8 +24,15 @@
 #include "ns3/nr-u-lbt.h"
 #include "ns3/nr-u-phy.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
 #include "ns3/opengym_interface.h"
+#include "ns3/rng-seed-manager.h"
 #include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 
@@ -52,15 +59,138 @@ GymBwpRlEnv::GetTypeId (void)
                    "Maximum achievable throughput for normalization",
                    DoubleValue (1000.0),
                    MakeDoubleAccessor (&GymBwpRlEnv::m_maxThroughput),
-                   MakeDoubleChecker<double> ());
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("MaxDelay",
+                   "HoL delay normalizing the delay term of the Normalized reward",
+                   DoubleValue (100.0),
+                   MakeDoubleAccessor (&GymBwpRlEnv::m_maxDelay),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("RewardType",
+                   "Reward formula applied to the window totals",
+                   EnumValue (PAPER),
+                   MakeEnumAccessor (&GymBwpRlEnv::m_rewardType),
+                   MakeEnumChecker (PAPER, "Paper",
+                                    NORMALIZED, "Normalized"))
+    .AddAttribute ("DelayStatistic",
+                   "HoL delay statistic of the window in the delay term of the reward; "
+                   "the percentiles target the tail latency",
+                   EnumValue (DELAY_MEAN),
+                   MakeEnumAccessor (&GymBwpRlEnv::m_delayStatistic),
+                   MakeEnumChecker (DELAY_MEAN, "Mean",
+                                    DELAY_P50, "P50",
+                                    DELAY_P95, "P95",
+                                    DELAY_P99, "P99"))
+    .AddAttribute ("PerUeActions",
+                   "Use one BWP choice per UE (MultiDiscrete-like box) instead of "
+                   "a single BWP for all UEs",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&GymBwpRlEnv::m_perUeActions),
+                   MakeBooleanChecker ())
+    .AddAttribute ("NormalizeObservations",
+                   "Normalize every feature with its running mean and variance",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&GymBwpRlEnv::m_normalize),
+                   MakeBooleanChecker ())
+    .AddAttribute ("HistoryLength",
+                   "Number of past observations stacked in the observation tensor",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&GymBwpRlEnv::m_historyLength),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("NormClip",
+                   "Normalized features are clipped to [-NormClip, NormClip]",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&GymBwpRlEnv::m_normClip),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Transport",
+                   "Channel used to exchange steps with the agent",
+                   EnumValue (OPENGYM),
+                   MakeEnumAccessor (&GymBwpRlEnv::m_transport),
+                   MakeEnumChecker (OPENGYM, "OpenGym",
+                                    SHM, "Shm"))
+    .AddAttribute ("ShmName",
+                   "Name of the shared-memory segment (/dev/shm/<name>)",
+                   StringValue ("nr-u-gym"),
+                   MakeStringAccessor (&GymBwpRlEnv::m_shmName),
+                   MakeStringChecker ())
+    .AddAttribute ("ShmDepth",
+                   "Slots per ring of the shared-memory segment",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&GymBwpRlEnv::m_shmDepth),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ShmTimeout",
+                   "Maximum wait for the agent's action over shared memory",
+                   TimeValue (Seconds (30)),
+                   MakeTimeAccessor (&GymBwpRlEnv::m_shmTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("ActionLag",
+                   "Windows between an observation and the application of its action "
+                   "(shared-memory transport only); with a lag the simulation runs the "
+                   "next windows while the agent computes",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&GymBwpRlEnv::m_actionLag),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ReplayCapacity",
+                   "Transitions kept in the native replay buffer (0 disables it)",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&GymBwpRlEnv::m_replayCapacity),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ReplayAlpha",
+                   "Prioritization exponent of the replay buffer (0 for uniform sampling)",
+                   DoubleValue (0.6),
+                   MakeDoubleAccessor (&GymBwpRlEnv::m_replayAlpha),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("PolicyFile",
+                   "Weights of the policy run by GetOptimalAction (nr_u_policy.py "
+                   "format); empty for the LCA-like heuristic",
+                   StringValue (""),
+                   MakeStringAccessor (&GymBwpRlEnv::m_policyFile),
+                   MakeStringChecker ())
+    .AddAttribute ("PolicyPrecision",
+                   "Arithmetic of the policy: float, or int8 with per-channel scales",
+                   EnumValue (NrUPolicyNet::FLOAT),
+                   MakeEnumAccessor (&GymBwpRlEnv::m_policyPrecision),
+                   MakeEnumChecker (NrUPolicyNet::FLOAT, "Float",
+                                    NrUPolicyNet::INT8, "Int8"))
+    .AddAttribute ("PolicyCheck",
+                   "Also run the float path on every int8 decision and track how "
+                   "often both pick the same BWPs",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&GymBwpRlEnv::m_policyCheck),
+                   MakeBooleanChecker ());
   return tid;
 }
 
 GymBwpRlEnv::GymBwpRlEnv ()
   : m_scheduler (nullptr),
+    m_perUeActions (true),
     m_currentStep (0),
     m_episode (0),
-    m_totalReward (0.0)
+    m_totalReward (0.0),
+    m_rewardType (PAPER),
+    m_delayStatistic (DELAY_MEAN),
+    m_obsNumUes (0),
+    m_obsNumBwps (0),
+    m_normalize (false),
+    m_historyLength (1),
+    m_normClip (10.0),
+    m_featureSize (0),
+    m_normCount (0),
+    m_historyHead (0),
+    m_historyFilled (0),
+    m_obsCommitted (false),
+    m_transport (OPENGYM),
+    m_shmDepth (2),
+    m_actionLag (0),
+    m_appliedActionSeq (0),
+    m_lastObsSeq (0),
+    m_episodeStartSeq (0),
+    m_replayCapacity (0),
+    m_replayAlpha (0.6),
+    m_replayHasObs (false),
+    m_policyPrecision (NrUPolicyNet::FLOAT),
+    m_policyCheck (false),
+    m_policyAgreement (0.0),
+    m_policyChecks (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -82,11 +212,92 @@ GymBwpRlEnv::DoInitialize ()
 {
   NS_LOG_FUNCTION (this);
  
-  // Initialize observation space
-  m_observationSpace = CreateObject<OpenGymBoxSpace> (GetObservationSpaceShape ());
+  // Initialize observation space and the buffer backing every observation;
+  // the leading dimension holds the history
+  m_obsShape = GetObservationSpaceShape ();
+  m_obsNumUes = m_scheduler->GetNumUes ();
+  m_obsNumBwps = m_scheduler->GetNumBwps ();
+  m_featureSize = m_obsShape[1];
+  m_obsShape[0] = m_historyLength;
+  m_observationSpace = CreateObject<OpenGymBoxSpace> (m_obsShape);
+  m_obsBuffer.assign (m_obsShape[0] * m_obsShape[1], 0.0f);
+  m_obsContainer = CreateObject<OpenGymBoxContainer<float>> (m_obsShape);
+ 
+  // Normalization and history state, allocated once
+  m_normCount = 0;
+  m_featMean.assign (m_featureSize, 0.0);
+  m_featM2.assign (m_featureSize, 0.0);
+  m_rawObs.assign (m_featureSize, 0.0f);
+  m_history.assign (m_historyLength * m_featureSize, 0.0f);
+  m_historyHead = 0;
+  m_historyFilled = 0;
+  m_obsCommitted = false;
+  m_scheduler->TraceConnectWithoutContext ("WindowCollected",
+                                           MakeCallback (&GymBwpRlEnv::WindowCollected, this));
+ 
+  // Initialize action space: one BWP index per UE, or a single discrete
+  // BWP applied to every UE
+  if (m_perUeActions)
+  {
+    std::vector<uint32_t> actionShape = {m_obsNumUes};
+    m_actionSpace = CreateObject<OpenGymBoxSpace> (0, m_obsNumBwps - 1, actionShape,
+                                                   TypeNameGet<uint32_t> ());
+  }
+  else
+  {
+    m_actionSpace = CreateObject<OpenGymDiscreteSpace> (m_obsNumBwps);
+  }
+  m_actionUeIds.reserve (m_obsNumUes);
+  m_actionBwpIds.reserve (m_obsNumUes);
  
-  // Initialize action space (discrete BWP assignments)
-  m_actionSpace = CreateObject<OpenGymDiscreteSpace> (m_scheduler->GetNumBwps ());
+  if (m_transport == SHM)
+  {
+    // The agent may still read the observations of the last ActionLag
+    // windows, so their slots must not be reused yet
+    uint32_t depth = std::max (m_shmDepth, m_actionLag + 1);
+    m_shm.reset (new NrUShmTransport ());
+    if (!m_shm->Open (m_shmName, m_obsBuffer.size (), GetActionSize (), depth))
+    {
+      NS_FATAL_ERROR ("Cannot create shared-memory segment " << m_shmName);
+    }
+  }
+  else if (m_actionLag > 0)
+  {
+    NS_LOG_WARN ("ActionLag needs the shared-memory transport, stepping synchronously");
+    m_actionLag = 0;
+  }
+ 
+  if (m_replayCapacity > 0)
+  {
+    uint64_t seed = RngSeedManager::GetSeed () * 1000003ULL + RngSeedManager::GetRun ();
+    m_replay.reset (new NrUReplayBuffer (m_replayCapacity, m_obsBuffer.size (), GetActionSize (),
+                                         m_replayAlpha, seed));
+    m_replayObs.assign (m_obsBuffer.size (), 0.0f);
+    m_replayAction.assign (GetActionSize (), 0);
+    m_replayHasObs = false;
+    NS_LOG_INFO ("Replay buffer of " << m_replayCapacity << " transitions, "
+                 << NrUReplayBuffer::GetTransitionBytes (m_obsBuffer.size (), GetActionSize ())
+                 << " bytes each");
+  }
+ 
+  if (!m_policyFile.empty ())
+  {
+    m_policy.reset (new NrUPolicyNet ());
+    if (!m_policy->Load (m_policyFile))
+    {
+      NS_FATAL_ERROR ("Cannot load policy " << m_policyFile);
+    }
+    uint32_t outputs = GetActionSize () * m_obsNumBwps;
+    if (m_policy->GetInputSize () != m_obsBuffer.size () || m_policy->GetOutputSize () != outputs)
+    {
+      NS_FATAL_ERROR ("Policy " << m_policyFile << " maps " << m_policy->GetInputSize ()
+                      << " -> " << m_policy->GetOutputSize () << ", the environment needs "
+                      << m_obsBuffer.size () << " -> " << outputs);
+    }
+    m_policyActions.assign (GetActionSize (), 0);
+    NS_LOG_INFO ("Policy " << m_policyFile << " loaded, int8 kernel "
+                 << NrUPolicyNet::GetKernelName ());
+  }
  
   OpenGymEnv::DoInitialize ();
 }
@@ -136,42 +347,160 @@ GymBwpRlEnv::GetObservation (void)
 {
   NS_LOG_FUNCTION (this);
  
-  // Get current state from scheduler
-  auto ueStats = m_scheduler->GetUeStats ();
-  auto bwpStats = m_scheduler->GetBwpStats ();
+  BuildObservation (m_obsBuffer.data ());
+ 
+  // OpenGymBoxContainer keeps its data private and SetData takes the vector
+  // by value, so the buffer is copied twice here (into the argument, then
+  // into the container) and once more by serialization. That is still far
+  // cheaper than one AddValue per feature. Only the in-process paths
+  // (WriteObservation, the SHM ring slot) avoid the copies.
+  m_obsContainer->SetData (m_obsBuffer);
+  return m_obsContainer;
+}
+
+uint32_t
+GymBwpRlEnv::GetObservationSize (void) const
+{
+  return m_obsBuffer.size ();
+}
+
+bool
+GymBwpRlEnv::IsNormalized (void) const
+{
+  return m_normalize;
+}
+
+void
+GymBwpRlEnv::WriteObservation (float* out)
+{
+  BuildObservation (out);
+}
+
+void
+GymBwpRlEnv::BuildObservation (float* out)
+{
+  CommitObservation ();
+  CopyObservation (out);
+}
+
+void
+GymBwpRlEnv::WindowCollected (uint32_t /* window */)
+{
+  m_obsCommitted = false;
+}
+
+void
+GymBwpRlEnv::CommitObservation (void)
+{
+  // Reading the observation twice in a window (agent step and in-process
+  // policy) must not count it twice
+  if (m_obsCommitted)
+  {
+    return;
+  }
+  m_obsCommitted = true;
+ 
+  // Raw features are packed straight into the output by CopyObservation
+  // unless a stage needs them
+  if (!m_normalize && m_historyLength == 1)
+  {
+    return;
+  }
+ 
+  float* row = m_history.data () + m_historyHead * m_featureSize;
+  PackObservation (m_normalize ? m_rawObs.data () : row);
  
-  uint32_t numUes = ueStats.size ();
-  uint32_t numBwps = bwpStats.size ();
+  if (m_normalize)
+  {
+    // Welford update of every feature, then standardize with the running
+    // variance (unit variance until two samples are seen)
+    m_normCount++;
+    double invCount = 1.0 / m_normCount;
+    double invDof = m_normCount > 1 ? 1.0 / (m_normCount - 1) : 0.0;
+    double clip = m_normClip;
+    for (uint32_t f = 0; f < m_featureSize; ++f)
+    {
+      double x = m_rawObs[f];
+      double delta = x - m_featMean[f];
+      m_featMean[f] += delta * invCount;
+      m_featM2[f] += delta * (x - m_featMean[f]);
+      double var = m_normCount > 1 ? m_featM2[f] * invDof : 1.0;
+      double z = (x - m_featMean[f]) / std::sqrt (var + 1e-8);
+      row[f] = std::max (-clip, std::min (clip, z));
+    }
+  }
  
-  // Create container for observation
-  Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>> (GetObservationSpaceShape ());
+  if (m_historyLength > 1)
+  {
+    m_historyHead = (m_historyHead + 1) % m_historyLength;
+    m_historyFilled = std::min (m_historyFilled + 1, m_historyLength);
+  }
+}
+
+void
+GymBwpRlEnv::CopyObservation (float* out) const
+{
+  if (!m_normalize && m_historyLength == 1)
+  {
+    PackObservation (out);
+    return;
+  }
+  if (m_historyLength == 1)
+  {
+    std::copy (m_history.begin (), m_history.begin () + m_featureSize, out);
+    return;
+  }
+ 
+  // Unroll the ring oldest first; rows not yet seen in this episode are zero
+  uint32_t missing = m_historyLength - m_historyFilled;
+  std::fill (out, out + missing * m_featureSize, 0.0f);
+  out += missing * m_featureSize;
+  uint32_t start = (m_historyHead + missing) % m_historyLength;
+  uint32_t tail = std::min (m_historyFilled, m_historyLength - start);
+  out = std::copy (m_history.begin () + start * m_featureSize,
+                   m_history.begin () + (start + tail) * m_featureSize, out);
+  std::copy (m_history.begin (),
+             m_history.begin () + (m_historyFilled - tail) * m_featureSize, out);
+}
+
+void
+GymBwpRlEnv::PackObservation (float* out) const
+{
+  const auto& ueStats = m_scheduler->GetUeStats ();
+  const auto& bwpStats = m_scheduler->GetBwpStats ();
+ 
+  uint32_t ueStateSize = 5 + m_obsNumBwps;
+  uint32_t numUes = std::min<uint32_t> (ueStats.size (), m_obsNumUes);
+  uint32_t numBwps = std::min<uint32_t> (bwpStats.size (), m_obsNumBwps);
+ 
+  // Zeroing first leaves the one-hot BWP encoding to a single store per UE
+  // and pads UEs/BWPs missing from this window
+  float* begin = out;
+  std::fill (out, out + m_featureSize, 0.0f);
  
   // Fill UE states (equation 16)
-  for (const auto& ue : ueStats)
-  {
-    // Basic UE metrics
-    box->AddValue (ue.queueSize);       // L
-    box->AddValue (ue.holDelay);        // B
-    box->AddValue (ue.avgBitsPerRb);    // C
-    box->AddValue (ue.throughput);      // D (using throughput as proxy for P)
-    box->AddValue (ue.avgBitsPerRb);    // P (reusing same value)
-   
-    // One-hot BWP encoding
-    for (uint32_t i = 0; i < numBwps; ++i)
+  for (uint32_t i = 0; i < numUes; ++i, out += ueStateSize)
+  {
+    const auto& ue = ueStats[i];
+    out[0] = ue.queueSize;       // L
+    out[1] = ue.holDelay;        // B
+    out[2] = ue.avgBitsPerRb;    // C
+    out[3] = ue.throughput;      // D (using throughput as proxy for P)
+    out[4] = ue.avgBitsPerRb;    // P (reusing same value)
+    if (ue.currentBwp < m_obsNumBwps)
     {
-      box->AddValue (ue.currentBwp == i ? 1.0 : 0.0);
+      out[5 + ue.currentBwp] = 1.0f;
     }
   }
  
   // Fill BWP states (set J_n in equation 17)
-  for (const auto& bwp : bwpStats)
+  out = begin + m_obsNumUes * ueStateSize;
+  for (uint32_t i = 0; i < numBwps; ++i, out += 3)
   {
-    box->AddValue (bwp.wifiOccupancy);      // M
-    box->AddValue (bwp.lbtFailureRate);     // F
-    box->AddValue (bwp.contentionWindow);   // CW
+    out[0] = bwpStats[i].wifiOccupancy;      // M
+    out[1] = bwpStats[i].lbtFailureRate;     // F
+    out[2] = bwpStats[i].contentionWindow;   // CW
   }
- 
-  return box;
 }
 
 float
@@ -179,26 +508,81 @@ GymBwpRlEnv::GetReward (void)
 {
   NS_LOG_FUNCTION (this);
  
-  // Calculate reward based on equation (2) from paper
-  double avgHolDelay = 0.0;
-  double totalThroughput = 0.0;
- 
-  auto ueStats = m_scheduler->GetUeStats ();
-  for (const auto& ue : ueStats)
+  // The scheduler sums the reward terms while collecting the window, so
+  // the reward is O(1) whatever the number of UEs
+  const auto& totals = m_scheduler->GetWindowTotals ();
+  float reward;
+  if (!m_rewardCallback.IsNull ())
   {
-    avgHolDelay += ue.holDelay;
-    totalThroughput += ue.throughput;
+    reward = m_rewardCallback (totals);
+  }
+  else
+  {
+    double delay;
+    switch (m_delayStatistic)
+    {
+      case DELAY_P50:
+        delay = totals.holDelayP50;
+        break;
+      case DELAY_P95:
+        delay = totals.holDelayP95;
+        break;
+      case DELAY_P99:
+        delay = totals.holDelayP99;
+        break;
+      default:
+        delay = totals.numUes > 0 ? totals.holDelaySum / totals.numUes : 0.0;
+        break;
+    }
+    if (m_rewardType == NORMALIZED)
+    {
+      reward = totals.throughputSum / m_maxThroughput - m_alpha * delay / m_maxDelay;
+    }
+    else
+    {
+      // R[t_w] = -(α*avgHolDelay + β*(T_max - totalThroughput))
+      reward = -(m_alpha * delay + m_beta * (m_maxThroughput - totals.throughputSum));
+    }
   }
  
-  avgHolDelay /= ueStats.size ();
- 
-  // R[t_w] = -(α*avgHolDelay + β*(T_max - totalThroughput))
-  float reward = -(m_alpha * avgHolDelay + m_beta * (m_maxThroughput - totalThroughput));
- 
-  m_totalReward += reward;
   return reward;
 }
 
+void
+GymBwpRlEnv::RecordStep (float reward, const float* obs)
+{
+  m_totalReward += reward;
+  if (!m_replay)
+  {
+    return;
+  }
+ 
+  // The observation delivered with this reward closes the transition opened
+  // by the previous one; the action is whichever was applied in between
+  // (with an ActionLag, the action of an older observation)
+  std::size_t obsSize = m_replayObs.size ();
+  bool done = GetGameOver ();
+  if (m_replayHasObs)
+  {
+    m_replay->Add (m_replayObs.data (), m_replayAction.data (), reward, done, obs);
+  }
+  std::copy (obs, obs + obsSize, m_replayObs.begin ());
+  m_replayHasObs = !done;
+}
+
+NrUReplayBuffer*
+GymBwpRlEnv::GetReplayBuffer (void) const
+{
+  return m_replay.get ();
+}
+
+void
+GymBwpRlEnv::SetRewardCallback (RewardCallback cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_rewardCallback = cb;
+}
+
 std::string
 GymBwpRlEnv::GetExtraInfo (void)
 {
@@ -207,7 +591,13 @@ GymBwpRlEnv::GetExtraInfo (void)
   std::stringstream ss;
   ss << "{\"episode\": " << m_episode
      << ", \"step\": " << m_currentStep
-     << ", \"total_reward\": " << m_totalReward << "}";
+     << ", \"total_reward\": " << m_totalReward
+     << ", \"action_lag\": " << m_actionLag;
+  if (m_policyChecks > 0)
+  {
+    ss << ", \"policy_agreement\": " << m_policyAgreement / m_policyChecks;
+  }
+  ss << "}";
  
   return ss.str ();
 }
@@ -217,7 +607,15 @@ GymBwpRlEnv::ExecuteActions (Ptr<OpenGymDataContainer> action)
 {
   NS_LOG_FUNCTION (this);
  
-  // Convert action to BWP assignments
+  // Per-UE action: entry i is the BWP of the i-th UE of the observation
+  Ptr<OpenGymBoxContainer<uint32_t>> box = DynamicCast<OpenGymBoxContainer<uint32_t>> (action);
+  if (box)
+  {
+    std::vector<uint32_t> choices = box->GetData ();
+    return ApplyActions (choices.data (), choices.size ());
+  }
+ 
+  // Single action: assign all UEs to the same BWP
   Ptr<OpenGymDiscreteContainer> discrete = DynamicCast<OpenGymDiscreteContainer> (action);
   if (!discrete)
   {
@@ -225,20 +623,173 @@ GymBwpRlEnv::ExecuteActions (Ptr<OpenGymDataContainer> action)
     return false;
   }
  
-  uint32_t numUes = m_scheduler->GetNumUes ();
+  uint32_t choice = discrete->GetValue ();
+  return ApplyActions (&choice, 1);
+}
+
+void
+GymBwpRlEnv::NotifyCurrentState (void)
+{
+  NS_LOG_FUNCTION (this);
+  BeginStep ();
+  if (m_transport == SHM)
+  {
+    StepShm ();
+  }
+  else
+  {
+    // The step is recorded before Notify, which applies the agent's answer;
+    // the GetObservation inside it only copies the committed observation
+    BuildObservation (m_obsBuffer.data ());
+    RecordStep (GetReward (), m_obsBuffer.data ());
+    Notify ();
+  }
+  EndStep ();
+}
+
+void
+GymBwpRlEnv::BeginStep (void)
+{
+  // Counted before the observation goes out, so the terminal step is
+  // delivered and recorded with GetGameOver true
+  m_currentStep++;
+}
+
+void
+GymBwpRlEnv::EndStep (void)
+{
+  if (!GetGameOver ())
+  {
+    return;
+  }
+  if (m_checkpoint)
+  {
+    ResetToCheckpoint ();
+  }
+  else
+  {
+    // Without a checkpoint the simulation carries on as the next episode
+    BeginEpisode ();
+    NS_LOG_INFO ("Episode " << m_episode << " started");
+  }
+}
+
+void
+GymBwpRlEnv::SaveCheckpoint (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_checkpoint)
+  {
+    m_checkpoint.reset (new NrUeAiScheduler::Snapshot ());
+  }
+  m_scheduler->SaveState (*m_checkpoint);
+  NS_LOG_INFO ("Saved checkpoint at " << Simulator::Now ().GetSeconds () << "s");
+}
+
+bool
+GymBwpRlEnv::ResetToCheckpoint (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_checkpoint)
+  {
+    NS_LOG_WARN ("No checkpoint to reset to");
+    return false;
+  }
+ 
+  m_scheduler->RestoreState (*m_checkpoint);
+  BeginEpisode ();
+  NS_LOG_INFO ("Episode " << m_episode << " restarted from checkpoint");
+  return true;
+}
+
+void
+GymBwpRlEnv::BeginEpisode (void)
+{
+  m_historyFilled = 0;
+  m_obsCommitted = false;
+  // Actions still in the lag pipeline answer observations of the ended
+  // episode; StepShm skips them
+  m_episodeStartSeq = m_lastObsSeq;
+  m_appliedActionSeq = 0;
+  m_replayHasObs = false;
+  m_currentStep = 0;
+  m_totalReward = 0.0;
+  m_episode++;
+}
+
+void
+GymBwpRlEnv::StepShm (void)
+{
+  NS_LOG_FUNCTION (this);
+ 
+  // The observation is built straight into the ring slot, the agent reads
+  // it through a numpy view of the same memory
+  float* obs = m_shm->BeginObservation ();
+  BuildObservation (obs);
+  float reward = GetReward ();
+  RecordStep (reward, obs);
+  uint32_t seq = m_shm->CommitObservation (reward, GetGameOver (), m_appliedActionSeq);
+  m_lastObsSeq = seq;
+ 
+  // With a lag, the action answering an older observation is applied and
+  // the agent works on this one while the next windows are simulated; the
+  // first steps of an episode have no action of that episode to apply yet
+  if (seq <= m_episodeStartSeq + m_actionLag)
+  {
+    return;
+  }
+  uint32_t actionSeq = seq - m_actionLag;
+  const uint32_t* action = m_shm->WaitAction (actionSeq, m_shmTimeout.GetMilliSeconds ());
+  if (!action)
+  {
+    NS_LOG_WARN ("No action from the agent for step " << actionSeq << ", keeping the current BWPs");
+    return;
+  }
+  ApplyActions (action, GetActionSize ());
+  m_appliedActionSeq = actionSeq;
+}
+
+uint32_t
+GymBwpRlEnv::GetActionSize (void) const
+{
+  return m_perUeActions ? m_obsNumUes : 1;
+}
+
+bool
+GymBwpRlEnv::ApplyActions (const uint32_t* choices, uint32_t count)
+{
+  NS_LOG_FUNCTION (this << count);
+ 
   uint32_t numBwps = m_scheduler->GetNumBwps ();
+  const auto& ueStats = m_scheduler->GetUeStats ();
+  m_actionUeIds.clear ();
+  m_actionBwpIds.clear ();
+  if (count == 0 || numBwps == 0)
+  {
+    NS_LOG_ERROR ("Empty action or no BWP to assign");
+    return false;
+  }
  
-  // Simple action: Assign all UEs to same BWP (for initial implementation)
-  // Could extend to per-UE assignments with more complex action space
-  uint16_t selectedBwp = discrete->GetValue () % numBwps;
+  // A single choice moves every UE to the same BWP
+  bool perUe = count > 1;
+  std::size_t numUes = perUe ? std::min<std::size_t> (count, ueStats.size ()) : ueStats.size ();
+  for (std::size_t i = 0; i < numUes; ++i)
+  {
+    m_actionUeIds.push_back (ueStats[i].ueId);
+    m_actionBwpIds.push_back (choices[perUe ? i : 0] % numBwps);
+  }
+  m_scheduler->SwitchBwps (m_actionUeIds, m_actionBwpIds);
  
-  auto ueStats = m_scheduler->GetUeStats ();
-  for (const auto& ue : ueStats)
+  if (m_replay)
   {
-    m_scheduler->SwitchBwp (ue.ueId, selectedBwp);
+    // Recorded in the agent's layout, as the BWPs actually applied
+    for (uint32_t i = 0; i < m_replayAction.size (); ++i)
+    {
+      m_replayAction[i] = choices[perUe ? std::min (i, count - 1) : 0] % numBwps;
+    }
   }
  
-  NS_LOG_INFO ("Executed action - assigned all UEs to BWP " << selectedBwp);
+  NS_LOG_INFO ("Executed action for " << numUes << " UEs");
   return true;
 }
 
@@ -247,10 +798,14 @@ GymBwpRlEnv::GetOptimalAction (Ptr<OpenGymSpace> state)
 {
   NS_LOG_FUNCTION (this);
  
-  // For initial implementation, use same heuristic as LCA
-  // In full implementation, this would use the trained DRQN model
+  if (m_policy)
+  {
+    return GetPolicyAction ();
+  }
+ 
+  // Without a trained policy, use same heuristic as LCA
  
-  auto bwpStats = m_scheduler->GetBwpStats ();
+  const auto& bwpStats = m_scheduler->GetBwpStats ();
   uint16_t bestBwp = 0;
   double maxMetric = 0.0;
  
@@ -267,17 +822,76 @@ GymBwpRlEnv::GetOptimalAction (Ptr<OpenGymSpace> state)
     }
   }
  
-  Ptr<OpenGymDiscreteContainer> action = CreateObject<OpenGymDiscreteContainer> (m_actionSpace);
+  if (m_perUeActions)
+  {
+    std::vector<uint32_t> actionShape = {m_obsNumUes};
+    Ptr<OpenGymBoxContainer<uint32_t>> action = CreateObject<OpenGymBoxContainer<uint32_t>> (actionShape);
+    action->SetData (std::vector<uint32_t> (m_obsNumUes, bestBwp));
+    return action;
+  }
+ 
+  Ptr<OpenGymDiscreteContainer> action = CreateObject<OpenGymDiscreteContainer> (m_obsNumBwps);
   action->SetValue (bestBwp);
  
   return action;
 }
 
+Ptr<OpenGymDataContainer>
+GymBwpRlEnv::GetPolicyAction (void)
+{
+  NS_LOG_FUNCTION (this);
+ 
+  // The observation of this window, already committed if the agent was
+  // handed it
+  BuildObservation (m_obsBuffer.data ());
+  m_policy->SelectActions (m_obsBuffer.data (), m_obsNumBwps, m_policyActions.data (), m_policyPrecision);
+  if (m_policyCheck && m_policyPrecision == NrUPolicyNet::INT8)
+  {
+    m_policyAgreement += m_policy->CheckAgreement (m_obsBuffer.data (), 1, m_obsNumBwps);
+    m_policyChecks++;
+  }
+ 
+  if (m_perUeActions)
+  {
+    std::vector<uint32_t> actionShape = {m_obsNumUes};
+    Ptr<OpenGymBoxContainer<uint32_t>> action = CreateObject<OpenGymBoxContainer<uint32_t>> (actionShape);
+    action->SetData (m_policyActions);
+    return action;
+  }
+ 
+  Ptr<OpenGymDiscreteContainer> action = CreateObject<OpenGymDiscreteContainer> (m_obsNumBwps);
+  action->SetValue (m_policyActions[0]);
+  return action;
+}
+
+Ptr<NrUeAiScheduler>
+GymBwpRlEnv::GetScheduler (void) const
+{
+  return m_scheduler;
+}
+
+int64_t
+GymBwpRlEnv::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  return m_scheduler->AssignStreams (stream);
+}
+
 void
 GymBwpRlEnv::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
   m_scheduler = nullptr;
+  m_obsContainer = nullptr;
+  m_shm.reset ();
+  m_checkpoint.reset ();
+  m_replay.reset ();
+  if (m_policyChecks > 0)
+  {
+    NS_LOG_INFO ("Int8 policy agreed with the float path on "
+                 << 100.0 * m_policyAgreement / m_policyChecks << "% of the BWP choices");
+  }
+  m_policy.reset ();
   OpenGymEnv::DoDispose ();
 }
 
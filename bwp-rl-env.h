@@ -14,12 +14,39 @@
 #include "ns3/opengym_interface.h"  // Contains OpenGymEnv base class
 #include "ns3/spaces.h"             // Contains BoxSpace and DiscreteSpace
 #include "ns3/nr-u-scheduler-ai.h"  // For NrUeAiScheduler
+#include "ns3/nr-u-shm-transport.h"
+#include "ns3/nr-u-replay-buffer.h"
+#include "ns3/nr-u-policy.h"
+#include <memory>
 
 namespace ns3 {
 
 class GymBwpRlEnv : public OpenGymEnv
 {
 public:
+  /// Channel used to exchange steps with the agent
+  enum TransportType {
+    OPENGYM,  ///< OpenGym ZMQ/protobuf interface
+    SHM       ///< Shared-memory ring (NrUShmTransport)
+  };
+
+  /// Reward formula applied to the window totals of the scheduler
+  enum RewardType {
+    PAPER,      ///< -(alpha * avgHolDelay + beta * (T_max - throughput)), eq. (2)
+    NORMALIZED  ///< throughput / T_max - alpha * avgHolDelay / D_max, as in RL.py
+  };
+
+  /// HoL delay statistic of the window penalized by the reward
+  enum DelayStatistic {
+    DELAY_MEAN, ///< Mean over the UEs, as in the paper
+    DELAY_P50,  ///< Median over the UEs
+    DELAY_P95,  ///< 95th percentile over the UEs
+    DELAY_P99   ///< 99th percentile over the UEs
+  };
+
+  /// Custom reward formula, overriding RewardType when set
+  typedef Callback<float, const NrUeAiScheduler::WindowTotals&> RewardCallback;
+
   static TypeId GetTypeId (void);
   GymBwpRlEnv ();
   virtual ~GymBwpRlEnv ();
@@ -35,8 +62,41 @@ public:
   virtual std::string GetExtraInfo (void);
   virtual bool ExecuteActions (Ptr<OpenGymDataContainer> action);
 
+  // Hand the current state to the agent over the configured transport and
+  // apply its action
+  void NotifyCurrentState (void);
+
+  // Episode checkpoints: save the warmed-up scheduler/LBT/BWP/PHY state once
+  // and restart every later episode from it instead of re-simulating.
+  // Once a checkpoint exists, NotifyCurrentState restores it at game over.
+  void SaveCheckpoint (void);
+  bool ResetToCheckpoint (void);
+
+  void SetRewardCallback (RewardCallback cb);
+
   // Helper methods
   Ptr<OpenGymDataContainer> GetOptimalAction (Ptr<OpenGymSpace> state);
+  Ptr<NrUeAiScheduler> GetScheduler (void) const;
+  int64_t AssignStreams (int64_t stream);
+
+  // Raw access used when several environments are batched (GymBwpRlVecEnv)
+  uint32_t GetObservationSize (void) const;
+  // Whether observation features are standardized, so can be negative
+  bool IsNormalized (void) const;
+  void WriteObservation (float* out);
+  uint32_t GetActionSize (void) const;
+  bool ApplyActions (const uint32_t* choices, uint32_t count);
+  // Close the step delivering obs: add the reward to the episode total and
+  // record the transition; called once per step by whoever steps the agent
+  void RecordStep (float reward, const float* obs);
+  // Step bracket for whoever steps the agent: BeginStep before the
+  // observation is built, EndStep once the answer is applied, which starts
+  // the next episode (from the checkpoint, if any) after the terminal step
+  void BeginStep (void);
+  void EndStep (void);
+
+  // Transitions recorded at every step when ReplayCapacity is set, null otherwise
+  NrUReplayBuffer* GetReplayBuffer (void) const;
 
 protected:
   virtual void DoInitialize (void);
@@ -44,14 +104,25 @@ protected:
 
 private:
   std::vector<uint32_t> GetObservationSpaceShape (void) const;
+  void PackObservation (float* out) const;
+  void BuildObservation (float* out);
+  // Normalization statistics and history advance once per decision window
+  // (CommitObservation); CopyObservation only reads them
+  void CommitObservation (void);
+  void CopyObservation (float* out) const;
+  void WindowCollected (uint32_t window);
+  void StepShm (void);
+  void BeginEpisode (void);
+  Ptr<OpenGymDataContainer> GetPolicyAction (void);
 
   Ptr<NrUeAiScheduler> m_scheduler;
   
   // MODIFIED: Changed from OpenGymBoxSpace to BoxSpace
   Ptr<BoxSpace> m_observationSpace;
   
-  // MODIFIED: Changed from OpenGymDiscreteSpace to DiscreteSpace
-  Ptr<DiscreteSpace> m_actionSpace;
+  // Per-UE BWP choices (box of numUes) or one BWP for all UEs (discrete)
+  Ptr<OpenGymSpace> m_actionSpace;
+  bool m_perUeActions;
 
   uint32_t m_currentStep;
   uint32_t m_episode;
@@ -61,6 +132,69 @@ private:
   double m_alpha;
   double m_beta;
   double m_maxThroughput;
+  double m_maxDelay;
+  RewardType m_rewardType;
+  DelayStatistic m_delayStatistic;
+  RewardCallback m_rewardCallback;
+
+  // Observation tensor, sized once in DoInitialize and refilled in place;
+  // the container gets a copy of it at every GetObservation
+  std::vector<uint32_t> m_obsShape;
+  uint32_t m_obsNumUes;
+  uint32_t m_obsNumBwps;
+  std::vector<float> m_obsBuffer;
+  Ptr<OpenGymBoxContainer<float>> m_obsContainer;
+
+  // Running normalization (Welford) and history of the last H observations,
+  // delivered as an [H, features] tensor, oldest first
+  bool m_normalize;
+  uint32_t m_historyLength;
+  double m_normClip;
+  uint32_t m_featureSize;
+  uint64_t m_normCount;
+  std::vector<double> m_featMean;
+  std::vector<double> m_featM2;
+  std::vector<float> m_rawObs;
+  std::vector<float> m_history;
+  uint32_t m_historyHead;
+  uint32_t m_historyFilled;
+  bool m_obsCommitted;
+
+  // Shared-memory transport
+  TransportType m_transport;
+  std::string m_shmName;
+  uint32_t m_shmDepth;
+  Time m_shmTimeout;
+  uint32_t m_actionLag;
+  uint32_t m_appliedActionSeq;
+  uint32_t m_lastObsSeq;          // Last observation published
+  uint32_t m_episodeStartSeq;     // Last observation of the previous episode
+  std::unique_ptr<NrUShmTransport> m_shm;
+
+  // Episode checkpoint, empty until SaveCheckpoint
+  std::unique_ptr<NrUeAiScheduler::Snapshot> m_checkpoint;
+
+  // Replay buffer fed with (previous obs, applied action, reward, obs, done)
+  uint32_t m_replayCapacity;
+  double m_replayAlpha;
+  std::unique_ptr<NrUReplayBuffer> m_replay;
+  std::vector<float> m_replayObs;
+  std::vector<uint32_t> m_replayAction;
+  bool m_replayHasObs;
+
+  // In-process policy behind GetOptimalAction, with the optional int8/float
+  // agreement check
+  std::string m_policyFile;
+  NrUPolicyNet::Precision m_policyPrecision;
+  bool m_policyCheck;
+  std::unique_ptr<NrUPolicyNet> m_policy;
+  std::vector<uint32_t> m_policyActions;
+  double m_policyAgreement;
+  uint64_t m_policyChecks;
+
+  // Decoded per-UE action, reused across steps
+  std::vector<uint16_t> m_actionUeIds;
+  std::vector<uint16_t> m_actionBwpIds;
 };
 
 } // namespace ns3
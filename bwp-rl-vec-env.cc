@@ -0,0 +1,282 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bwp-rl-vec-env.h"
+#include "ns3/nr-u-scheduler-ai.h"
+#include "ns3/log.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("GymBwpRlVecEnv");
+NS_OBJECT_ENSURE_REGISTERED (GymBwpRlVecEnv);
+
+TypeId
+GymBwpRlVecEnv::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::GymBwpRlVecEnv")
+    .SetParent<OpenGymEnv> ()
+    .AddConstructor<GymBwpRlVecEnv> ()
+    .AddAttribute ("NumThreads",
+                   "Threads computing observations and rewards, the simulator "
+                   "thread included (0 for the hardware concurrency)",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&GymBwpRlVecEnv::m_numThreads),
+                   MakeUintegerChecker<uint32_t> ());
+  return tid;
+}
+
+GymBwpRlVecEnv::GymBwpRlVecEnv ()
+  : m_numThreads (0),
+    m_obsSize (0),
+    m_actionSize (0),
+    m_pendingWindows (0),
+    m_currentStep (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+GymBwpRlVecEnv::~GymBwpRlVecEnv ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+GymBwpRlVecEnv::AddEnv (Ptr<GymBwpRlEnv> env)
+{
+  NS_LOG_FUNCTION (this << env);
+  NS_ASSERT_MSG (env->GetScheduler (), "Set the scheduler before adding the environment");
+ 
+  // Decisions come from the agent, the scheduler only collects statistics
+  env->GetScheduler ()->SetAttribute ("AlgorithmType", EnumValue (NrUeAiScheduler::EXTERNAL));
+  m_envs.push_back (env);
+}
+
+uint32_t
+GymBwpRlVecEnv::GetNumEnvs (void) const
+{
+  return m_envs.size ();
+}
+
+int64_t
+GymBwpRlVecEnv::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  int64_t assigned = 0;
+  for (auto& env : m_envs)
+  {
+    assigned += env->AssignStreams (stream + assigned);
+  }
+  return assigned;
+}
+
+void
+GymBwpRlVecEnv::DoInitialize ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_envs.empty (), "No environment added");
+ 
+  uint32_t numEnvs = m_envs.size ();
+  for (auto& env : m_envs)
+  {
+    env->Initialize ();
+    // Only this environment talks to the agent
+    env->GetScheduler ()->SetGymEnv (nullptr);
+    env->GetScheduler ()->TraceConnectWithoutContext (
+      "WindowCollected", MakeCallback (&GymBwpRlVecEnv::WindowCollected, this));
+  }
+ 
+  // Batching requires every instance to expose the same tensor shapes
+  m_obsSize = m_envs[0]->GetObservationSize ();
+  m_actionSize = m_envs[0]->GetActionSize ();
+  for (const auto& env : m_envs)
+  {
+    NS_ABORT_MSG_IF (env->GetObservationSize () != m_obsSize
+                     || env->GetActionSize () != m_actionSize,
+                     "All environments must have the same UE and BWP counts");
+    NS_ABORT_MSG_IF (env->IsNormalized () != m_envs[0]->IsNormalized (),
+                     "All environments must have the same Normalize setting");
+  }
+  m_pendingWindows = numEnvs;
+ 
+  // Raw features are non-negative, standardized ones are not
+  float maxValue = std::numeric_limits<float>::max ();
+  float minObs = m_envs[0]->IsNormalized () ? -maxValue : 0.0f;
+  std::vector<uint32_t> obsShape = {numEnvs, m_obsSize};
+  std::vector<uint32_t> rewardShape = {numEnvs};
+  m_observationSpace = CreateObject<OpenGymDictSpace> ();
+  m_observationSpace->Add ("obs", CreateObject<OpenGymBoxSpace> (minObs, maxValue, obsShape,
+                                                                 TypeNameGet<float> ()));
+  m_observationSpace->Add ("reward", CreateObject<OpenGymBoxSpace> (-maxValue, maxValue, rewardShape,
+                                                                    TypeNameGet<float> ()));
+ 
+  uint32_t numBwps = m_envs[0]->GetScheduler ()->GetNumBwps ();
+  std::vector<uint32_t> actionShape = {numEnvs, m_actionSize};
+  m_actionSpace = CreateObject<OpenGymBoxSpace> (0, numBwps - 1, actionShape,
+                                                 TypeNameGet<uint32_t> ());
+ 
+  // The dict keeps pointers to both containers, so it is built only once
+  m_obsBuffer.assign (numEnvs * m_obsSize, 0.0f);
+  m_rewards.assign (numEnvs, 0.0f);
+  m_obsContainer = CreateObject<OpenGymBoxContainer<float>> (obsShape);
+  m_rewardContainer = CreateObject<OpenGymBoxContainer<float>> (rewardShape);
+  m_obsDict = CreateObject<OpenGymDictContainer> ();
+  m_obsDict->Add ("obs", m_obsContainer);
+  m_obsDict->Add ("reward", m_rewardContainer);
+ 
+  uint32_t numThreads = m_numThreads ? m_numThreads : std::thread::hardware_concurrency ();
+  m_pool.reset (new NrUThreadPool (std::max (1u, std::min (numThreads, numEnvs))));
+  NS_LOG_INFO ("Vector environment with " << numEnvs << " instances on "
+               << m_pool->GetNumThreads () << " threads");
+ 
+  OpenGymEnv::DoInitialize ();
+}
+
+void
+GymBwpRlVecEnv::WindowCollected (uint32_t window)
+{
+  NS_LOG_FUNCTION (this << window);
+ 
+  // Step the agent once the last instance has reached the window boundary
+  if (--m_pendingWindows == 0)
+  {
+    m_pendingWindows = m_envs.size ();
+    // Every instance writes its own row and reward slot and records its own
+    // step, nothing is shared
+    m_pool->ParallelFor (m_envs.size (), [this] (uint32_t i)
+    {
+      float* row = m_obsBuffer.data () + i * m_obsSize;
+      m_envs[i]->BeginStep ();
+      m_envs[i]->WriteObservation (row);
+      m_rewards[i] = m_envs[i]->GetReward ();
+      m_envs[i]->RecordStep (m_rewards[i], row);
+    });
+    Notify ();
+    // Episode resets restore checkpoints and schedule simulator events, so
+    // they stay on this thread
+    for (auto& env : m_envs)
+    {
+      env->EndStep ();
+    }
+  }
+}
+
+Ptr<OpenGymSpace>
+GymBwpRlVecEnv::GetObservationSpace (void)
+{
+  NS_LOG_FUNCTION (this);
+  return m_observationSpace;
+}
+
+Ptr<OpenGymSpace>
+GymBwpRlVecEnv::GetActionSpace (void)
+{
+  NS_LOG_FUNCTION (this);
+  return m_actionSpace;
+}
+
+bool
+GymBwpRlVecEnv::GetGameOver (void)
+{
+  NS_LOG_FUNCTION (this);
+  return std::all_of (m_envs.begin (), m_envs.end (),
+                      [] (const Ptr<GymBwpRlEnv>& env) { return env->GetGameOver (); });
+}
+
+Ptr<OpenGymDataContainer>
+GymBwpRlVecEnv::GetObservation (void)
+{
+  NS_LOG_FUNCTION (this);
+ 
+  // Filled when the step started (WindowCollected); the containers take
+  // copies, they give no access to their storage
+  m_obsContainer->SetData (m_obsBuffer);
+  m_rewardContainer->SetData (m_rewards);
+  return m_obsDict;
+}
+
+float
+GymBwpRlVecEnv::GetReward (void)
+{
+  NS_LOG_FUNCTION (this);
+ 
+  // Rewards are computed with the observations when the step starts
+  return std::accumulate (m_rewards.begin (), m_rewards.end (), 0.0f) / m_rewards.size ();
+}
+
+std::string
+GymBwpRlVecEnv::GetExtraInfo (void)
+{
+  NS_LOG_FUNCTION (this);
+ 
+  std::stringstream ss;
+  ss << "{\"num_envs\": " << m_envs.size ()
+     << ", \"step\": " << m_currentStep << "}";
+ 
+  return ss.str ();
+}
+
+bool
+GymBwpRlVecEnv::ExecuteActions (Ptr<OpenGymDataContainer> action)
+{
+  NS_LOG_FUNCTION (this);
+ 
+  Ptr<OpenGymBoxContainer<uint32_t>> box = DynamicCast<OpenGymBoxContainer<uint32_t>> (action);
+  if (!box)
+  {
+    NS_LOG_ERROR ("Invalid action type");
+    return false;
+  }
+ 
+  std::vector<uint32_t> choices = box->GetData ();
+  if (choices.size () != m_envs.size () * m_actionSize)
+  {
+    NS_LOG_ERROR ("Expected " << m_envs.size () * m_actionSize << " actions, got "
+                  << choices.size ());
+    return false;
+  }
+ 
+  // Switching schedules simulator events, so actions stay on this thread
+  bool ok = true;
+  for (std::size_t i = 0; i < m_envs.size (); ++i)
+  {
+    ok &= m_envs[i]->ApplyActions (choices.data () + i * m_actionSize, m_actionSize);
+  }
+  m_currentStep++;
+  return ok;
+}
+
+void
+GymBwpRlVecEnv::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_pool.reset ();
+  m_envs.clear ();
+  m_obsContainer = nullptr;
+  m_rewardContainer = nullptr;
+  m_obsDict = nullptr;
+  OpenGymEnv::DoDispose ();
+}
+
+} // namespace ns3
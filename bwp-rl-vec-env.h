@@ -0,0 +1,91 @@
+#ifndef GYM_BWP_RL_VEC_ENV_H
+#define GYM_BWP_RL_VEC_ENV_H
+
+#include "ns3/opengym-module.h"
+#include "ns3/bwp-rl-env.h"
+#include "ns3/nr-u-thread-pool.h"
+#include <memory>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief N BWP environments of one process stepped in lockstep
+ *
+ * Each sub-environment wraps its own scheduler, LBT and BWP manager, all
+ * living in the same simulator. The sub-schedulers are switched to the
+ * External algorithm and the agent is notified once every one of them has
+ * collected the statistics of the current decision window, so all
+ * schedulers must use the same TimeWindowSize. Use AssignStreams to give
+ * every instance its own random streams.
+ *
+ * The observation is a dict with "obs" (N x obsSize floats, row i is the
+ * observation of sub-environment i) and "reward" (N floats). The action is
+ * a box of N x actionSize BWP indices, actionSize being the number of UEs
+ * for per-UE sub-environments and 1 otherwise. GetReward returns the mean
+ * reward, for agents that only read the scalar.
+ *
+ * Observations and rewards are computed on a thread pool; actions are
+ * applied on the simulator thread because they schedule events. Logging
+ * of the sub-environments should stay disabled when NumThreads > 1.
+ */
+class GymBwpRlVecEnv : public OpenGymEnv
+{
+public:
+  static TypeId GetTypeId (void);
+  GymBwpRlVecEnv ();
+  virtual ~GymBwpRlVecEnv ();
+
+  /**
+   * \brief Add a sub-environment, its scheduler must already be set
+   * \param env The environment
+   */
+  void AddEnv (Ptr<GymBwpRlEnv> env);
+  uint32_t GetNumEnvs (void) const;
+
+  /**
+   * \brief Assign consecutive random streams to all sub-environments
+   * \param stream The first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  // OpenGymEnv interface implementation
+  virtual Ptr<OpenGymSpace> GetObservationSpace (void);
+  virtual Ptr<OpenGymSpace> GetActionSpace (void);
+  virtual bool GetGameOver (void);
+  virtual Ptr<OpenGymDataContainer> GetObservation (void);
+  virtual float GetReward (void);
+  virtual std::string GetExtraInfo (void);
+  virtual bool ExecuteActions (Ptr<OpenGymDataContainer> action);
+
+protected:
+  virtual void DoInitialize (void);
+  virtual void DoDispose (void);
+
+private:
+  void WindowCollected (uint32_t window);
+
+  std::vector<Ptr<GymBwpRlEnv>> m_envs;
+  uint32_t m_numThreads;
+  std::unique_ptr<NrUThreadPool> m_pool;
+
+  uint32_t m_obsSize;
+  uint32_t m_actionSize;
+  uint32_t m_pendingWindows;
+  uint32_t m_currentStep;
+
+  Ptr<OpenGymDictSpace> m_observationSpace;
+  Ptr<OpenGymBoxSpace> m_actionSpace;
+
+  // Batched observation and rewards, sized once in DoInitialize
+  std::vector<float> m_obsBuffer;
+  std::vector<float> m_rewards;
+  Ptr<OpenGymBoxContainer<float>> m_obsContainer;
+  Ptr<OpenGymBoxContainer<float>> m_rewardContainer;
+  Ptr<OpenGymDictContainer> m_obsDict;
+};
+
+} // namespace ns3
+
+#endif /* GYM_BWP_RL_VEC_ENV_H */
@@ -0,0 +1,523 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Microbenchmarks of the per-slot and per-window steps of the NR-U stack,
+ * each timed on synthetic scenarios swept over UE and BWP counts:
+ *
+ *   ./ns3 run "nr-u-bench --ues=24,384,6144 --bwps=3,12 --output=bench.csv"
+ *   ./ns3 run "nr-u-bench --baseline=bench.csv"
+ *
+ * Every row of the CSV holds the time per call of one benchmark in one
+ * scenario (minimum, median and maximum over the repetitions). With
+ * --baseline, medians more than --tolerance above the baseline's are
+ * reported and the exit status is 1, so a CI job can catch regressions.
+ * Build with the optimized profile, logging dominates otherwise.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/nr-u-bwp-manager.h"
+#include "ns3/nr-u-lbt.h"
+#include "ns3/nr-u-phy.h"
+#include "ns3/nr-u-scheduler-ai.h"
+#include "ns3/bwp-rl-env.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <tuple>
+
+using namespace ns3;
+
+namespace ns3 {
+
+/**
+ * \brief Synthetic NR-U scenario whose steps can be called one at a time
+ *
+ * numUes UEs (RNTIs 1..numUes) are spread round-robin over numBwps BWPs of
+ * 50, 70 and 100 RBs in turn, with random sub-band CQI. Friend of NrUeLbt
+ * and NrUeAiScheduler, so their private steps can be timed in isolation.
+ */
+class NrUBenchmark
+{
+public:
+  /// The timed steps
+  enum Step
+  {
+    CHANNEL_ACCESS_REQUEST,
+    HANDLE_WIFI_INTERFERENCE,
+    SWITCH_BWP,
+    COLLECT_WINDOW_STATISTICS,
+    ASSIGN_BWPS_LCA,
+    ALLOCATE_RESOURCES,
+    GET_OBSERVATION,
+    NUM_STEPS
+  };
+
+  static const char* GetStepName (Step step);
+
+  NrUBenchmark (uint32_t numUes, uint16_t numBwps);
+  ~NrUBenchmark ();
+
+  /**
+   * \brief Call a step a number of times
+   * \param step The step
+   * \param iterations Calls to make
+   */
+  void Run (Step step, uint64_t iterations);
+
+  /**
+   * \return true if the step schedules events, which must then be dropped
+   *         between batches to keep the event queue from growing
+   */
+  static bool SchedulesEvents (Step step);
+
+  /// \return a value depending on every result, so no call is optimized out
+  uint64_t GetSink (void) const;
+
+private:
+  uint32_t m_numUes;
+  uint16_t m_numBwps;
+  Ptr<NrUPhy> m_phy;
+  Ptr<NrUeLbt> m_lbt;
+  Ptr<NrUeBwpManager> m_bwpManager;
+  Ptr<NrUeAiScheduler> m_scheduler;
+  Ptr<GymBwpRlEnv> m_env;
+  std::vector<uint16_t> m_ueBwp;                ///< BWP of each UE, by RNTI
+  std::vector<std::vector<uint16_t>> m_bwpUes;  ///< UEs of each BWP
+  uint64_t m_next;                              ///< Rotates the UE or BWP used
+  uint64_t m_sink;
+};
+
+const char*
+NrUBenchmark::GetStepName (Step step)
+{
+  static const char* names[NUM_STEPS] = {
+    "ChannelAccessRequest", "HandleWifiInterference", "SwitchBwp", "CollectWindowStatistics",
+    "AssignBwpsLca", "AllocateResources", "GetObservation"
+  };
+  return names[step];
+}
+
+bool
+NrUBenchmark::SchedulesEvents (Step step)
+{
+  return step == HANDLE_WIFI_INTERFERENCE || step == SWITCH_BWP || step == ASSIGN_BWPS_LCA;
+}
+
+NrUBenchmark::NrUBenchmark (uint32_t numUes, uint16_t numBwps)
+  : m_numUes (numUes),
+    m_numBwps (numBwps),
+    m_ueBwp (numUes + 1, 0),
+    m_bwpUes (numBwps),
+    m_next (0),
+    m_sink (0)
+{
+  static const uint16_t bwpRbs[] = {50, 70, 100};
+  std::mt19937 rng (numUes * 131u + numBwps);
+  std::uniform_real_distribution<double> cqiDist (1.0, 15.0);
+
+  m_phy = CreateObject<NrUPhy> ();
+  m_phy->SetAttribute ("FullBuffer", BooleanValue (true));
+  m_lbt = CreateObject<NrUeLbt> ();
+  m_lbt->SetPhy (m_phy);
+  m_bwpManager = CreateObject<NrUeBwpManager> ();
+
+  std::vector<uint16_t> bwpIds;
+  std::vector<uint16_t> numRbs;
+  std::vector<double> wifiMeans;
+  for (uint16_t b = 0; b < numBwps; ++b)
+  {
+    bwpIds.push_back (b);
+    numRbs.push_back (bwpRbs[b % 3]);
+    wifiMeans.push_back (0.2 + 0.2 * (b % 3));
+    m_phy->ConfigureBwp (b, 1, 30e3, numRbs.back ());
+  }
+  m_bwpManager->AddBwps (bwpIds, numRbs);
+  m_lbt->AddBwps (bwpIds, wifiMeans);
+
+  std::vector<uint16_t> ueIds;
+  std::vector<uint16_t> ueBwps;
+  for (uint32_t ue = 1; ue <= numUes; ++ue)
+  {
+    uint16_t bwp = ue % numBwps;
+    ueIds.push_back (ue);
+    ueBwps.push_back (bwp);
+    m_ueBwp[ue] = bwp;
+    m_bwpUes[bwp].push_back (ue);
+    std::vector<double> cqi (numRbs[bwp]);
+    for (double& value : cqi)
+    {
+      value = cqiDist (rng);
+    }
+    m_phy->UpdateChannelQuality (ue, cqi);
+  }
+  m_bwpManager->AddUes (ueIds);
+  m_bwpManager->SwitchBwps (ueIds, ueBwps);
+
+  m_scheduler = CreateObject<NrUeAiScheduler> ();
+  m_scheduler->SetAttribute ("AlgorithmType", EnumValue (NrUeAiScheduler::LCA));
+  m_scheduler->SetBwpManager (m_bwpManager);
+  m_scheduler->SetLbt (m_lbt);
+  m_scheduler->SetPhy (m_phy);
+  m_scheduler->Initialize ();
+  m_scheduler->CollectWindowStatistics ();
+
+  m_env = CreateObject<GymBwpRlEnv> ();
+  m_env->SetScheduler (m_scheduler);
+  m_env->Initialize ();
+
+  // Drop the switch notifications and first events, nothing is ever run
+  Simulator::Destroy ();
+}
+
+NrUBenchmark::~NrUBenchmark ()
+{
+  m_env->Dispose ();
+  m_scheduler->Dispose ();
+  m_bwpManager->Dispose ();
+  m_lbt->Dispose ();
+  m_phy->Dispose ();
+  Simulator::Destroy ();
+}
+
+uint64_t
+NrUBenchmark::GetSink (void) const
+{
+  return m_sink;
+}
+
+void
+NrUBenchmark::Run (Step step, uint64_t iterations)
+{
+  switch (step)
+  {
+    case CHANNEL_ACCESS_REQUEST:
+      for (uint64_t i = 0; i < iterations; ++i)
+      {
+        m_sink += m_lbt->ChannelAccessRequest (m_next++ % m_numBwps);
+      }
+      break;
+    case HANDLE_WIFI_INTERFERENCE:
+      for (uint64_t i = 0; i < iterations; ++i)
+      {
+        m_lbt->HandleWifiInterference (m_next++ % m_numBwps);
+      }
+      m_sink += m_lbt->GetContentionWindow (0);
+      break;
+    case SWITCH_BWP:
+      // Always a real switch: every UE moves on to the next BWP
+      for (uint64_t i = 0; i < iterations; ++i)
+      {
+        uint16_t ue = 1 + m_next++ % m_numUes;
+        m_ueBwp[ue] = (m_ueBwp[ue] + 1) % m_numBwps;
+        m_bwpManager->SwitchBwp (ue, m_ueBwp[ue]);
+      }
+      m_sink += m_bwpManager->GetActiveUes (0);
+      break;
+    case COLLECT_WINDOW_STATISTICS:
+      for (uint64_t i = 0; i < iterations; ++i)
+      {
+        m_scheduler->CollectWindowStatistics ();
+      }
+      m_sink += m_scheduler->GetWindowTotals ().numUes;
+      break;
+    case ASSIGN_BWPS_LCA:
+      for (uint64_t i = 0; i < iterations; ++i)
+      {
+        m_scheduler->AssignBwpsLca ();
+      }
+      m_sink += m_bwpManager->GetActiveUes (0);
+      break;
+    case ALLOCATE_RESOURCES:
+      for (uint64_t i = 0; i < iterations; ++i)
+      {
+        uint16_t bwp = m_next++ % m_numBwps;
+        m_sink += m_phy->AllocateResources (bwp, m_bwpUes[bwp]).size ();
+      }
+      break;
+    case GET_OBSERVATION:
+      for (uint64_t i = 0; i < iterations; ++i)
+      {
+        m_sink += PeekPointer (m_env->GetObservation ()) != nullptr;
+      }
+      break;
+    case NUM_STEPS:
+      break;
+  }
+}
+
+} // namespace ns3
+
+namespace {
+
+/// Timings of one benchmark in one scenario, nanoseconds per call
+struct BenchResult
+{
+  std::string name;
+  uint32_t numUes;
+  uint16_t numBwps;
+  uint64_t iterations;          ///< Calls per repetition
+  std::vector<double> nsPerCall; ///< One per repetition, sorted
+};
+
+/// Calls between two event-queue resets of the steps that schedule events
+const uint64_t EVENT_BATCH = 4096;
+
+template <typename T>
+bool
+ParseList (const std::string& text, std::vector<T>& out)
+{
+  out.clear ();
+  std::stringstream ss (text);
+  std::string item;
+  while (std::getline (ss, item, ','))
+  {
+    std::stringstream is (item);
+    T value;
+    if (!(is >> value))
+    {
+      return false;
+    }
+    out.push_back (value);
+  }
+  return !out.empty ();
+}
+
+/// \return the seconds taken by the calls, leaving out event-queue resets
+double
+TimeCalls (NrUBenchmark& bench, NrUBenchmark::Step step, uint64_t iterations)
+{
+  bool batched = NrUBenchmark::SchedulesEvents (step);
+  double elapsed = 0;
+  while (iterations > 0)
+  {
+    uint64_t calls = batched ? std::min (iterations, EVENT_BATCH) : iterations;
+    auto start = std::chrono::steady_clock::now ();
+    bench.Run (step, calls);
+    elapsed += std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+    if (batched)
+    {
+      Simulator::Destroy ();
+    }
+    iterations -= calls;
+  }
+  return elapsed;
+}
+
+BenchResult
+Measure (NrUBenchmark& bench, NrUBenchmark::Step step, double minTime, uint32_t repetitions)
+{
+  // Warm up, then grow the calls per repetition until one takes minTime
+  TimeCalls (bench, step, 1);
+  uint64_t iterations = 1;
+  double elapsed = TimeCalls (bench, step, iterations);
+  while (elapsed < minTime && iterations < (1ULL << 40))
+  {
+    uint64_t scale = elapsed > 0 ? static_cast<uint64_t> (1.2 * minTime / elapsed) : 10;
+    iterations *= std::min<uint64_t> (std::max<uint64_t> (scale, 2), 10);
+    elapsed = TimeCalls (bench, step, iterations);
+  }
+
+  BenchResult result;
+  result.name = NrUBenchmark::GetStepName (step);
+  result.iterations = iterations;
+  result.nsPerCall.push_back (elapsed * 1e9 / iterations);
+  for (uint32_t r = 1; r < repetitions; ++r)
+  {
+    result.nsPerCall.push_back (TimeCalls (bench, step, iterations) * 1e9 / iterations);
+  }
+  std::sort (result.nsPerCall.begin (), result.nsPerCall.end ());
+  return result;
+}
+
+double
+Median (const std::vector<double>& sorted)
+{
+  std::size_t n = sorted.size ();
+  return n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+}
+
+void
+WriteCsv (std::ostream& os, const std::vector<BenchResult>& results)
+{
+  os << "benchmark,ues,bwps,iterations,repetitions,min_ns,median_ns,max_ns\n";
+  for (const BenchResult& r : results)
+  {
+    os << r.name << "," << r.numUes << "," << r.numBwps << "," << r.iterations << ","
+       << r.nsPerCall.size () << "," << r.nsPerCall.front () << "," << Median (r.nsPerCall)
+       << "," << r.nsPerCall.back () << "\n";
+  }
+}
+
+/// \return the number of results slower than the baseline by more than tolerance
+uint32_t
+CompareBaseline (const std::string& path, const std::vector<BenchResult>& results, double tolerance)
+{
+  std::ifstream file (path);
+  if (!file)
+  {
+    std::cerr << "Cannot read baseline " << path << "\n";
+    return 1;
+  }
+  // benchmark,ues,bwps -> median_ns
+  std::map<std::tuple<std::string, uint32_t, uint32_t>, double> baseline;
+  std::string line;
+  std::getline (file, line);
+  while (std::getline (file, line))
+  {
+    std::vector<std::string> fields;
+    std::stringstream ss (line);
+    std::string field;
+    while (std::getline (ss, field, ','))
+    {
+      fields.push_back (field);
+    }
+    if (fields.size () >= 7)
+    {
+      baseline[std::make_tuple (fields[0], std::stoul (fields[1]), std::stoul (fields[2]))] =
+        std::stod (fields[6]);
+    }
+  }
+
+  uint32_t regressions = 0;
+  for (const BenchResult& r : results)
+  {
+    auto it = baseline.find (std::make_tuple (r.name, r.numUes, static_cast<uint32_t> (r.numBwps)));
+    if (it == baseline.end ())
+    {
+      continue;
+    }
+    double median = Median (r.nsPerCall);
+    if (median > it->second * (1 + tolerance))
+    {
+      std::cerr << "REGRESSION " << r.name << " ues=" << r.numUes << " bwps=" << r.numBwps
+                << ": " << median << " ns vs " << it->second << " ns (+"
+                << 100 * (median / it->second - 1) << "%)\n";
+      regressions++;
+    }
+  }
+  return regressions;
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char* argv[])
+{
+  std::string benchmarks = "all";
+  std::string ues = "24,96,384,1536,6144";
+  std::string bwps = "3,6,12";
+  double minTime = 0.1;
+  uint32_t repetitions = 5;
+  std::string output;
+  std::string baselineFile;
+  double tolerance = 0.1;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("benchmarks", "Comma-separated benchmarks, or all", benchmarks);
+  cmd.AddValue ("ues", "Comma-separated UE counts (at most 65534)", ues);
+  cmd.AddValue ("bwps", "Comma-separated BWP counts", bwps);
+  cmd.AddValue ("minTime", "Seconds per repetition", minTime);
+  cmd.AddValue ("repetitions", "Repetitions per benchmark and scenario", repetitions);
+  cmd.AddValue ("output", "Results CSV, stdout if empty", output);
+  cmd.AddValue ("baseline", "Results CSV of a previous run to compare with", baselineFile);
+  cmd.AddValue ("tolerance", "Allowed slowdown of the median against the baseline", tolerance);
+  cmd.Parse (argc, argv);
+
+  std::vector<uint32_t> ueCounts;
+  std::vector<uint32_t> bwpCounts;
+  if (!ParseList (ues, ueCounts) || !ParseList (bwps, bwpCounts))
+  {
+    NS_FATAL_ERROR ("Bad UE or BWP count list");
+  }
+  for (uint32_t count : ueCounts)
+  {
+    NS_ABORT_MSG_IF (count == 0 || count > 65534, "UE counts must be in 1..65534");
+  }
+  for (uint32_t count : bwpCounts)
+  {
+    NS_ABORT_MSG_IF (count == 0 || count > 1024, "BWP counts must be in 1..1024");
+  }
+  repetitions = std::max (repetitions, 1u);
+
+  std::vector<NrUBenchmark::Step> steps;
+  for (int s = 0; s < NrUBenchmark::NUM_STEPS; ++s)
+  {
+    NrUBenchmark::Step step = static_cast<NrUBenchmark::Step> (s);
+    if (benchmarks == "all"
+        || ("," + benchmarks + ",").find (std::string (",") + NrUBenchmark::GetStepName (step) + ",")
+             != std::string::npos)
+    {
+      steps.push_back (step);
+    }
+  }
+  if (steps.empty ())
+  {
+    NS_FATAL_ERROR ("No benchmark matches " << benchmarks);
+  }
+
+  std::vector<BenchResult> results;
+  uint64_t sink = 0;
+  for (uint32_t numBwps : bwpCounts)
+  {
+    for (uint32_t numUes : ueCounts)
+    {
+      for (NrUBenchmark::Step step : steps)
+      {
+        // A fresh scenario per benchmark, so none inherits another's state
+        NrUBenchmark bench (numUes, numBwps);
+        BenchResult result = Measure (bench, step, minTime, repetitions);
+        result.numUes = numUes;
+        result.numBwps = numBwps;
+        sink += bench.GetSink ();
+        std::cerr << result.name << " ues=" << numUes << " bwps=" << numBwps << ": "
+                  << Median (result.nsPerCall) << " ns\n";
+        results.push_back (result);
+      }
+    }
+  }
+
+  // Compared before writing, the output may replace the baseline
+  uint32_t regressions = 0;
+  if (!baselineFile.empty ())
+  {
+    regressions = CompareBaseline (baselineFile, results, tolerance);
+  }
+
+  if (output.empty ())
+  {
+    WriteCsv (std::cout, results);
+  }
+  else
+  {
+    std::ofstream file (output);
+    WriteCsv (file, results);
+    if (!file)
+    {
+      NS_FATAL_ERROR ("Cannot write " << output);
+    }
+  }
+  std::cerr << "Checksum " << sink << "\n";
+  return regressions > 0 ? 1 : 0;
+}
@@ -21,7 +21,10 @@
 #include "nr-u-bwp-manager.h"
 #include "ns3/log.h"
 #include "ns3/nr-phy.h"
+#include "ns3/simulator.h"
+#include "ns3/nr-u-trace-ring.h"
 #include <algorithm>
+#include <numeric>
 
 namespace ns3 {
 
@@ -48,7 +51,8 @@ NrUeBwpManager::GetTypeId (void)
 }
 
 NrUeBwpManager::NrUeBwpManager ()
-  : m_currentSlot (0)
+  : m_currentSlot (0),
+    m_nextBatchId (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -70,6 +74,11 @@ NrUeBwpManager::DoDispose ()
   NS_LOG_FUNCTION (this);
   m_ueMap.clear ();
   m_bwpMap.clear ();
+  for (auto& pending : m_pendingNotifications)
+  {
+    pending.second.event.Cancel ();
+  }
+  m_pendingNotifications.clear ();
 }
 
 void
@@ -86,6 +95,35 @@ NrUeBwpManager::AddBwp (uint16_t bwpId, uint16_t numRbs)
   NS_LOG_INFO ("Added BWP " << bwpId << " with " << numRbs << " RBs");
 }
 
+void
+NrUeBwpManager::AddBwps (const std::vector<uint16_t>& bwpIds,
+                         const std::vector<uint16_t>& numRbs)
+{
+  NS_LOG_FUNCTION (this << bwpIds.size ());
+  NS_ASSERT_MSG (bwpIds.size () == numRbs.size (),
+                 "Each BWP needs exactly one RB count");
+ 
+  // Insert in ascending ID order so each insert can use the position of the
+  // previous one as hint and costs amortized constant time
+  std::vector<std::size_t> order (bwpIds.size ());
+  std::iota (order.begin (), order.end (), 0);
+  std::sort (order.begin (), order.end (),
+             [&bwpIds] (std::size_t a, std::size_t b) { return bwpIds[a] < bwpIds[b]; });
+ 
+  auto hint = m_bwpMap.begin ();
+  for (std::size_t idx : order)
+  {
+    BwpInfo bwpInfo;
+    bwpInfo.bwpId = bwpIds[idx];
+    bwpInfo.numRbs = numRbs[idx];
+    bwpInfo.activeUes = 0;
+ 
+    hint = m_bwpMap.insert_or_assign (hint, bwpInfo.bwpId, bwpInfo);
+    ++hint;
+  }
+  NS_LOG_INFO ("Added " << bwpIds.size () << " BWPs, " << m_bwpMap.size () << " in total");
+}
+
 void
 NrUeBwpManager::RemoveBwp (uint16_t bwpId)
 {
@@ -150,6 +188,28 @@ NrUeBwpManager::AddUe (uint16_t ueId)
   }
 }
 
+void
+NrUeBwpManager::AddUes (const std::vector<uint16_t>& ueIds)
+{
+  NS_LOG_FUNCTION (this << ueIds.size ());
+ 
+  std::vector<uint16_t> sorted (ueIds);
+  std::sort (sorted.begin (), sorted.end ());
+ 
+  // emplace_hint leaves UEs that are already attached untouched, so the
+  // active count is bumped once by the number of UEs actually inserted
+  std::size_t before = m_ueMap.size ();
+  auto hint = m_ueMap.begin ();
+  for (uint16_t ueId : sorted)
+  {
+    hint = m_ueMap.emplace_hint (hint, ueId, m_defaultBwpId);
+    ++hint;
+  }
+  uint16_t added = m_ueMap.size () - before;
+  m_bwpMap[m_defaultBwpId].activeUes += added;
+  NS_LOG_INFO ("Added " << added << " UEs to default BWP " << m_defaultBwpId);
+}
+
 void
 NrUeBwpManager::RemoveUe (uint16_t ueId)
 {
@@ -168,8 +228,6 @@ NrUeBwpManager::RemoveUe (uint16_t ueId)
 void
 NrUeBwpManager::SwitchBwp (uint16_t ueId, uint16_t newBwpId)
 {
-  NS_LOG_FUNCTION (this << ueId << newBwpId);
- 
   auto ueIt = m_ueMap.find (ueId);
   auto bwpIt = m_bwpMap.find (newBwpId);
  
@@ -185,12 +243,12 @@ NrUeBwpManager::SwitchBwp (uint16_t ueId, uint16_t newBwpId)
      
       // Update UE mapping
       ueIt->second = newBwpId;
+      NrUTraceRing::Write (NrUTraceRing::BWP_SWITCH, Simulator::Now ().GetNanoSeconds (),
+                           newBwpId, ueId, oldBwpId, 0);
      
-      NS_LOG_INFO ("Switched UE " << ueId << " from BWP " << oldBwpId
-                   << " to BWP " << newBwpId);
-     
-      // Notify PHY about BWP switch with configured latency
-      Simulator::Schedule (m_bwpSwitchLatency, &NotifyPhyLayer, ueId, newBwpId);
+      // Notify PHY about BWP switch with configured latency; tracked, so
+      // checkpoints save it and restores and dispose cancel it
+      ScheduleNotification (m_bwpSwitchLatency, {{ueId, newBwpId}});
     }
   }
   else
@@ -199,6 +257,49 @@ NrUeBwpManager::SwitchBwp (uint16_t ueId, uint16_t newBwpId)
   }
 }
 
+void
+NrUeBwpManager::SwitchBwps (const std::vector<uint16_t>& ueIds,
+                            const std::vector<uint16_t>& newBwpIds)
+{
+  NS_LOG_FUNCTION (this << ueIds.size ());
+  NS_ASSERT_MSG (ueIds.size () == newBwpIds.size (),
+                 "Each UE needs exactly one target BWP");
+ 
+  // All switches of the batch share one PHY notification event
+  std::vector<std::pair<uint16_t, uint16_t>> switches;
+  uint32_t invalid = 0;
+  int64_t now = Simulator::Now ().GetNanoSeconds ();
+  for (std::size_t i = 0; i < ueIds.size (); ++i)
+  {
+    auto ueIt = m_ueMap.find (ueIds[i]);
+    auto newIt = m_bwpMap.find (newBwpIds[i]);
+    if (ueIt == m_ueMap.end () || newIt == m_bwpMap.end ())
+    {
+      invalid++;
+      continue;
+    }
+    if (ueIt->second != newBwpIds[i])
+    {
+      m_bwpMap[ueIt->second].activeUes--;
+      newIt->second.activeUes++;
+      NrUTraceRing::Write (NrUTraceRing::BWP_SWITCH, now, newBwpIds[i], ueIds[i], ueIt->second, 0);
+      ueIt->second = newBwpIds[i];
+      switches.emplace_back (ueIds[i], newBwpIds[i]);
+    }
+  }
+ 
+  if (invalid > 0)
+  {
+    NS_LOG_WARN ("Ignored " << invalid << " switches with invalid UE or BWP");
+  }
+  NS_LOG_INFO ("Switched " << switches.size () << " of " << ueIds.size () << " UEs");
+ 
+  if (!switches.empty ())
+  {
+    ScheduleNotification (m_bwpSwitchLatency, std::move (switches));
+  }
+}
+
 uint16_t
 NrUeBwpManager::GetUeBwp (uint16_t ueId) const
 {
@@ -224,5 +325,64 @@ NrUeBwpManager::NotifyPhyLayer (uint16_t ueId, uint16_t bwpId)
   // about the BWP switch for the specified UE
 }
 
+void
+NrUeBwpManager::ScheduleNotification (Time delay,
+                                      std::vector<std::pair<uint16_t, uint16_t>> switches)
+{
+  uint32_t batchId = m_nextBatchId++;
+  PendingNotification& pending = m_pendingNotifications[batchId];
+  pending.switches = std::move (switches);
+  pending.event = Simulator::Schedule (delay, &NrUeBwpManager::NotifyPhyLayerBatch, this, batchId);
+}
+
+void
+NrUeBwpManager::NotifyPhyLayerBatch (uint32_t batchId)
+{
+  NS_LOG_FUNCTION (this << batchId);
+  auto it = m_pendingNotifications.find (batchId);
+  if (it == m_pendingNotifications.end ())
+  {
+    return;
+  }
+  for (const auto& sw : it->second.switches)
+  {
+    NotifyPhyLayer (sw.first, sw.second);
+  }
+  m_pendingNotifications.erase (it);
+}
+
+void
+NrUeBwpManager::SaveState (Snapshot& snapshot) const
+{
+  NS_LOG_FUNCTION (this);
+  snapshot.bwpMap = m_bwpMap;
+  snapshot.ueMap = m_ueMap;
+  snapshot.currentSlot = m_currentSlot;
+  snapshot.pendingNotifications.clear ();
+  for (const auto& pending : m_pendingNotifications)
+  {
+    snapshot.pendingNotifications.emplace_back (Simulator::GetDelayLeft (pending.second.event),
+                                                pending.second.switches);
+  }
+}
+
+void
+NrUeBwpManager::RestoreState (const Snapshot& snapshot)
+{
+  NS_LOG_FUNCTION (this);
+  m_bwpMap = snapshot.bwpMap;
+  m_ueMap = snapshot.ueMap;
+  m_currentSlot = snapshot.currentSlot;
+  for (auto& pending : m_pendingNotifications)
+  {
+    pending.second.event.Cancel ();
+  }
+  m_pendingNotifications.clear ();
+  for (const auto& pending : snapshot.pendingNotifications)
+  {
+    ScheduleNotification (pending.first, pending.second);
+  }
+}
+
 } // namespace ns3
 
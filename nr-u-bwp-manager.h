@@ -2,12 +2,22 @@
 #define NR_UE_BWP_MANAGER_H
 
 #include "ns3/object.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
 #include <map>
+#include <vector>
 
 namespace ns3 {
 
 class NrUeBwpManager : public Object
 {
+private:
+  struct BwpInfo {
+    uint16_t bwpId;
+    uint16_t numRbs;
+    uint16_t activeUes;
+  };
+
 public:
   static TypeId GetTypeId (void);
   NrUeBwpManager ();
@@ -15,6 +25,8 @@ public:
 
   // BWP management
   void AddBwp (uint16_t bwpId, uint16_t numRbs);
+  void AddBwps (const std::vector<uint16_t>& bwpIds,
+                const std::vector<uint16_t>& numRbs);
   void RemoveBwp (uint16_t bwpId);
   uint16_t GetNumBwps () const;
   uint16_t GetNumRbs (uint16_t bwpId) const;
@@ -22,29 +34,47 @@ public:
 
   // UE management
   void AddUe (uint16_t ueId);
+  void AddUes (const std::vector<uint16_t>& ueIds);
   void RemoveUe (uint16_t ueId);
   void SwitchBwp (uint16_t ueId, uint16_t newBwpId);
+  void SwitchBwps (const std::vector<uint16_t>& ueIds,
+                   const std::vector<uint16_t>& newBwpIds);
   uint16_t GetUeBwp (uint16_t ueId) const;
   const std::map<uint16_t, uint16_t>& GetUeMap () const;
 
+  // Checkpointing: pending PHY notifications are kept with their remaining
+  // delay and rescheduled relative to the time of the restore
+  struct Snapshot {
+    std::map<uint16_t, BwpInfo> bwpMap;
+    std::map<uint16_t, uint16_t> ueMap;
+    uint64_t currentSlot;
+    std::vector<std::pair<Time, std::vector<std::pair<uint16_t, uint16_t>>>> pendingNotifications;
+  };
+  void SaveState (Snapshot& snapshot) const;
+  void RestoreState (const Snapshot& snapshot);
+
 protected:
   virtual void DoInitialize (void);
   virtual void DoDispose (void);
 
 private:
-  struct BwpInfo {
-    uint16_t bwpId;
-    uint16_t numRbs;
-    uint16_t activeUes;
+  /// PHY notification of a switch batch, waiting for the switch latency
+  struct PendingNotification {
+    EventId event;
+    std::vector<std::pair<uint16_t, uint16_t>> switches;
   };
 
   void NotifyPhyLayer (uint16_t ueId, uint16_t bwpId);
+  void NotifyPhyLayerBatch (uint32_t batchId);
+  void ScheduleNotification (Time delay, std::vector<std::pair<uint16_t, uint16_t>> switches);
 
   std::map<uint16_t, BwpInfo> m_bwpMap; // BWP ID to BWP info
   std::map<uint16_t, uint16_t> m_ueMap; // UE ID to BWP ID
   uint16_t m_defaultBwpId;
   Time m_bwpSwitchLatency;
   uint64_t m_currentSlot;
+  std::map<uint32_t, PendingNotification> m_pendingNotifications; // Batch ID to notification
+  uint32_t m_nextBatchId;
 };
 
 } // namespace ns3
@@ -0,0 +1,167 @@
+#ifndef NR_U_DELAY_HISTOGRAM_H
+#define NR_U_DELAY_HISTOGRAM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Log-linear (HDR-style) histogram of delays in slots
+ *
+ * Values below 2^subBucketBits get one bucket each; above that, every
+ * power of two [2^k, 2^(k+1)) is split into 2^subBucketBits equal buckets,
+ * so a value is known to within 1 / 2^subBucketBits of itself (6.25% with
+ * the default 4 bits). Values above maxValue land in the last bucket.
+ *
+ * The buckets are allocated once by the constructor: Record is a bit scan,
+ * a shift and an increment, and the memory does not grow with the samples
+ * (208 counters, 832 bytes, with the defaults). Histograms of the same
+ * layout merge exactly, so per-UE histograms add up to per-BWP or per-cell
+ * ones, and replications on separate threads can each keep their own.
+ */
+class NrUDelayHistogram
+{
+public:
+  /**
+   * \brief Create an empty histogram
+   * \param subBucketBits Precision, log2 of the buckets per power of two
+   * \param maxValue Largest value told apart from larger ones
+   */
+  explicit NrUDelayHistogram (uint32_t subBucketBits = 4, uint32_t maxValue = 65535)
+    : m_subBucketBits (std::min (std::max (subBucketBits, 1u), 16u)),
+      m_maxValue (std::max (maxValue, 1u))
+  {
+    m_counts.assign (Index (m_maxValue) + 1, 0);
+  }
+
+  /// Count one delay
+  void Record (uint32_t value)
+  {
+    value = std::min (value, m_maxValue);
+    m_counts[Index (value)]++;
+    m_count++;
+    m_sum += value;
+    m_max = std::max (m_max, value);
+  }
+
+  /**
+   * \brief Fold in the counts of another histogram
+   * \param other A histogram of the same layout
+   * \return false, leaving this one unchanged, if the layouts differ
+   */
+  bool Merge (const NrUDelayHistogram& other)
+  {
+    if (other.m_subBucketBits != m_subBucketBits || other.m_maxValue != m_maxValue)
+    {
+      return false;
+    }
+    for (std::size_t i = 0; i < m_counts.size (); ++i)
+    {
+      m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max (m_max, other.m_max);
+    return true;
+  }
+
+  /// Forget every sample, keeping the buckets
+  void Reset (void)
+  {
+    std::fill (m_counts.begin (), m_counts.end (), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_max = 0;
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  /// \return the exact mean of the recorded (clamped) values, 0 if empty
+  double GetMean (void) const
+  {
+    return m_count > 0 ? double (m_sum) / m_count : 0.0;
+  }
+
+  /// \return the largest recorded (clamped) value
+  uint32_t GetMax (void) const
+  {
+    return m_max;
+  }
+
+  /**
+   * \brief Value at a percentile
+   * \param percentile In [0, 100]
+   * \return the highest value of the bucket holding that rank, capped at
+   *         the largest recorded value; 0 if empty
+   */
+  uint32_t GetValueAtPercentile (double percentile) const
+  {
+    if (m_count == 0)
+    {
+      return 0;
+    }
+    double fraction = std::min (std::max (percentile, 0.0), 100.0) / 100.0;
+    uint64_t rank = std::max<uint64_t> (1, uint64_t (std::ceil (fraction * m_count)));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < m_counts.size (); ++i)
+    {
+      seen += m_counts[i];
+      if (seen >= rank)
+      {
+        return std::min (HighestInBucket (i), m_max);
+      }
+    }
+    return m_max;
+  }
+
+  /// \return the number of buckets, the memory is four bytes each
+  std::size_t GetNumBuckets (void) const
+  {
+    return m_counts.size ();
+  }
+
+private:
+  /// \return the bucket of a value not above m_maxValue
+  std::size_t Index (uint32_t value) const
+  {
+    uint32_t subBuckets = 1u << m_subBucketBits;
+    if (value < subBuckets)
+    {
+      return value;
+    }
+    // value is in [2^msb, 2^(msb+1)): octave msb - bits, sub-bucket of the top bits
+    uint32_t msb = 31 - __builtin_clz (value);
+    uint32_t shift = msb - m_subBucketBits;
+    return std::size_t (shift) * subBuckets + (value >> shift);
+  }
+
+  /// \return the largest value falling into a bucket
+  uint32_t HighestInBucket (std::size_t index) const
+  {
+    uint32_t subBuckets = 1u << m_subBucketBits;
+    if (index < subBuckets)
+    {
+      return index;
+    }
+    uint32_t shift = index / subBuckets - 1;
+    uint64_t lowest = uint64_t (index % subBuckets + subBuckets) << shift;
+    return uint32_t (std::min<uint64_t> (lowest + (uint64_t (1) << shift) - 1, UINT32_MAX));
+  }
+
+  uint32_t m_subBucketBits;         ///< log2 of the buckets per power of two
+  uint32_t m_maxValue;              ///< Values above are clamped
+  std::vector<uint32_t> m_counts;   ///< Samples per bucket
+  uint64_t m_count = 0;             ///< Samples
+  uint64_t m_sum = 0;               ///< Sum of the samples
+  uint32_t m_max = 0;               ///< Largest sample
+};
+
+} // namespace ns3
+
+#endif /* NR_U_DELAY_HISTOGRAM_H */
@@ -0,0 +1,460 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-fast-sim.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+namespace {
+
+// Model constants of RL.py
+const uint32_t MIN_PKT_SIZE = 0;
+const uint32_t MAX_PKT_SIZE = 30;
+const double MIN_CAPACITY = 5.0;
+const double MAX_CAPACITY = 30.0;
+const double CAPACITY_STEP_STDDEV = 3.0;
+const double MIN_CHANNEL_QUALITY = 0.3;
+const double MAX_CHANNEL_QUALITY = 1.5;
+const double EMA_WEIGHT = 0.05;
+const uint32_t LBT_INITIAL_CW = 4;
+const uint32_t LBT_MAX_CW = 64;
+const uint32_t LBT_MAX_ATTEMPTS = 10;
+
+// T_MAX_LIST: RB * subcarriers * symbols * bits per symbol * slots/s, Mbit/s
+double
+BwpCapacityMbps (uint32_t numRbs, uint32_t slotsPerSec)
+{
+  return numRbs * 12.0 * 14.0 * 8.0 * slotsPerSec / 1e6;
+}
+
+} // anonymous namespace
+
+NrUFastSimConfig
+NrUFastSim::GetDefaultConfig (void)
+{
+  NrUFastSimConfig config = {};
+  config.numUes = 24;
+  config.numBwps = 3;
+  config.maxUesPerSlot = 8;
+  config.slotsPerWindow = 500;
+  config.maxQueueSize = 200;
+  config.slotsPerSec = 2000;
+  config.alpha = 0.3;
+  config.maxDelayThreshold = 100.0;
+  config.beta = 1.0;
+  config.wifiInterference[0] = 0.1;
+  config.wifiInterference[1] = 0.2;
+  config.wifiInterference[2] = 0.3;
+  config.bwpRbs[0] = 50;
+  config.bwpRbs[1] = 70;
+  config.bwpRbs[2] = 100;
+  config.seed = 42;
+  return config;
+}
+
+NrUFastSim::NrUFastSim (const NrUFastSimConfig& config)
+  : m_config (config),
+    m_meanTmax (0.0),
+    m_rng (config.seed),
+    m_slot (0),
+    m_queues (config.numUes, std::max (1u, config.maxQueueSize)),
+    m_traffic (config.numUes, config.seed ^ 0x6e722d7574726166ULL)
+{
+  m_config.numBwps = std::max (1u, std::min<uint32_t> (m_config.numBwps, NR_U_FAST_SIM_MAX_BWPS));
+  m_config.maxQueueSize = std::max (1u, m_config.maxQueueSize);
+  for (uint32_t b = 0; b < m_config.numBwps; ++b)
+  {
+    m_meanTmax += BwpCapacityMbps (m_config.bwpRbs[b], m_config.slotsPerSec);
+  }
+  m_meanTmax /= m_config.numBwps;
+
+  uint32_t numUes = m_config.numUes;
+  m_assignment.assign (numUes, 0);
+  m_traffic.SetSizeLimits (MIN_PKT_SIZE, MAX_PKT_SIZE);
+  m_capacity.assign (numUes, 0.0);
+  m_cqi.assign (numUes, 0.0);
+  m_avgThroughput.assign (numUes, 0.0);
+  m_holDelay.assign (numUes, 0);
+  m_channelQuality.assign (m_config.numBwps, 1.0);
+  m_lbtAttempts.assign (m_config.numBwps, 0);
+  m_lbtFailures.assign (m_config.numBwps, 0);
+  m_bwpStart.assign (m_config.numBwps + 1, 0);
+  m_bwpUes.reserve (numUes);
+  m_pfMetric.assign (numUes, 0.0);
+  m_pfOrder.reserve (numUes);
+  m_scheduled.assign (numUes, 0);
+}
+
+const NrUFastSimConfig&
+NrUFastSim::GetConfig (void) const
+{
+  return m_config;
+}
+
+void
+NrUFastSim::Reset (int32_t* state)
+{
+  std::uniform_real_distribution<double> pktSize (8.0, 20.0);
+  std::uniform_real_distribution<double> arrivalRate (0.1, 0.3);
+  std::uniform_real_distribution<double> cqi (0.7, 1.5);
+  std::uniform_int_distribution<uint32_t> bwp (0, m_config.numBwps - 1);
+  for (uint32_t ue = 0; ue < m_config.numUes; ++ue)
+  {
+    m_traffic.SetMeanSize (ue, pktSize (m_rng));
+    double rate = arrivalRate (m_rng);
+    if (!m_arrivalRates.empty ())
+    {
+      rate = m_arrivalRates[ue];
+    }
+    else if (m_config.arrivalRate > 0.0)
+    {
+      rate = m_config.arrivalRate;
+    }
+    m_traffic.SetRate (ue, rate);
+    m_cqi[ue] = cqi (m_rng);
+    m_capacity[ue] = 0.0;
+    m_avgThroughput[ue] = 1.0;
+    m_holDelay[ue] = 0;
+  }
+  m_queues.ClearAll ();
+  for (uint32_t ue = 0; ue < m_config.numUes; ++ue)
+  {
+    m_assignment[ue] = bwp (m_rng);
+  }
+  std::fill (m_channelQuality.begin (), m_channelQuality.end (), 1.0);
+  std::fill (m_lbtAttempts.begin (), m_lbtAttempts.end (), 0);
+  std::fill (m_lbtFailures.begin (), m_lbtFailures.end (), 0);
+  m_slot = 0;
+  m_traffic.Restart (m_slot);
+  GroupUesByBwp ();
+  GetState (state);
+}
+
+void
+NrUFastSim::SetArrivalRates (const double* rates)
+{
+  if (rates == nullptr)
+  {
+    m_arrivalRates.clear ();
+    return;
+  }
+  m_arrivalRates.assign (rates, rates + m_config.numUes);
+}
+
+void
+NrUFastSim::GroupUesByBwp (void)
+{
+  // Counting sort, stable so every BWP lists its UEs in UE order; UEs with
+  // an invalid BWP are left out, like the list comprehension of RL.py
+  uint32_t numBwps = m_config.numBwps;
+  std::fill (m_bwpStart.begin (), m_bwpStart.end (), 0);
+  for (uint32_t ue = 0; ue < m_config.numUes; ++ue)
+  {
+    if (m_assignment[ue] < numBwps)
+    {
+      m_bwpStart[m_assignment[ue] + 1]++;
+    }
+  }
+  for (uint32_t b = 0; b < numBwps; ++b)
+  {
+    m_bwpStart[b + 1] += m_bwpStart[b];
+  }
+  m_bwpUes.resize (m_bwpStart[numBwps]);
+  std::vector<uint32_t>& fill = m_pfOrder;
+  fill.assign (m_bwpStart.begin (), m_bwpStart.end () - 1);
+  for (uint32_t ue = 0; ue < m_config.numUes; ++ue)
+  {
+    if (m_assignment[ue] < numBwps)
+    {
+      m_bwpUes[fill[m_assignment[ue]]++] = ue;
+    }
+  }
+}
+
+uint32_t
+NrUFastSim::GenerateTraffic (uint32_t slot)
+{
+  m_traffic.Generate (m_arrivals);
+  const uint32_t* ues = m_arrivals.ues.data ();
+  const float* sizes = m_arrivals.sizes.data ();
+  uint32_t dropped = 0;
+  for (std::size_t i = 0; i < m_arrivals.ues.size (); ++i)
+  {
+    // Sizes are drawn for dropped packets too, as in RL.py
+    dropped += !m_queues.Enqueue (ues[i], slot, sizes[i]);
+  }
+  return dropped;
+}
+
+double
+NrUFastSim::ServeUe (uint32_t ue, bool served, uint32_t slot, double allocatedRbs, double channelQuality)
+{
+  m_holDelay[ue] = m_queues.GetHolDelay (ue, slot);
+  if (!served || m_queues.GetLength (ue) == 0)
+  {
+    return 0.0;
+  }
+
+  // Only the head packet is served in a slot, partially if needed
+  double transmittable = m_queues.ServeHead (ue, m_capacity[ue] * allocatedRbs * channelQuality);
+  m_avgThroughput[ue] = (1 - EMA_WEIGHT) * m_avgThroughput[ue] + EMA_WEIGHT * transmittable;
+  return transmittable;
+}
+
+bool
+NrUFastSim::Cat4Lbt (uint32_t bwp)
+{
+  std::uniform_real_distribution<double> uniform (0.0, 1.0);
+  double busy = m_config.wifiInterference[bwp];
+  if (uniform (m_rng) >= busy)
+  {
+    return true;
+  }
+
+  // Count down a random backoff; a busy slot doubles CW and restarts
+  uint32_t cw = LBT_INITIAL_CW;
+  for (uint32_t attempts = 0; attempts < LBT_MAX_ATTEMPTS; )
+  {
+    uint32_t backoff = std::uniform_int_distribution<uint32_t> (0, cw) (m_rng);
+    bool collided = false;
+    for (uint32_t i = 0; i < backoff; ++i)
+    {
+      if (uniform (m_rng) < busy)
+      {
+        cw = std::min (LBT_MAX_CW, cw * 2);
+        attempts++;
+        collided = true;
+        break;
+      }
+    }
+    if (!collided)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+NrUFastSimResult
+NrUFastSim::Step (const uint32_t* action, int32_t* state)
+{
+  std::copy (action, action + m_config.numUes, m_assignment.begin ());
+  GroupUesByBwp ();
+
+  std::normal_distribution<double> capacityStep (0.0, CAPACITY_STEP_STDDEV);
+  std::uniform_real_distribution<double> uniform (0.0, 1.0);
+  double totalThroughput = 0.0;
+  double totalDelay = 0.0;
+  uint32_t successfulTransmissions = 0;
+  uint64_t dropped = 0;
+  std::fill (m_lbtAttempts.begin (), m_lbtAttempts.end (), 0);
+  std::fill (m_lbtFailures.begin (), m_lbtFailures.end (), 0);
+
+  for (uint32_t s = 0; s < m_config.slotsPerWindow; ++s, ++m_slot)
+  {
+    uint32_t slot = m_slot;
+    dropped += GenerateTraffic (slot);
+    for (uint32_t ue = 0; ue < m_config.numUes; ++ue)
+    {
+      m_capacity[ue] = std::max (MIN_CAPACITY, std::min (MAX_CAPACITY, m_capacity[ue] + capacityStep (m_rng)));
+    }
+    for (uint32_t b = 0; b < m_config.numBwps; ++b)
+    {
+      // Rayleigh with unit scale, by inversion
+      double rayleigh = std::sqrt (-2.0 * std::log (1.0 - uniform (m_rng)));
+      double fading = 0.9 * m_channelQuality[b] + 0.1 * rayleigh * (1 - m_config.wifiInterference[b]);
+      m_channelQuality[b] = std::max (MIN_CHANNEL_QUALITY, std::min (MAX_CHANNEL_QUALITY, fading));
+    }
+
+    for (uint32_t b = 0; b < m_config.numBwps; ++b)
+    {
+      const uint32_t* first = m_bwpUes.data () + m_bwpStart[b];
+      uint32_t count = m_bwpStart[b + 1] - m_bwpStart[b];
+      if (count == 0)
+      {
+        continue;
+      }
+
+      m_lbtAttempts[b]++;
+      if (!Cat4Lbt (b))
+      {
+        m_lbtFailures[b]++;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+          ServeUe (first[i], false, slot, 0.0, 0.0);
+          totalDelay += m_holDelay[first[i]];
+        }
+        continue;
+      }
+      successfulTransmissions++;
+
+      // Proportional fair: the maxUesPerSlot best metrics, ties in UE
+      // order as with Python's stable sort. UEs are served independently,
+      // so only the selected set matters, not its order
+      double channelQuality = m_channelQuality[b];
+      m_pfOrder.clear ();
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        uint32_t ue = first[i];
+        m_pfMetric[ue] = channelQuality * m_cqi[ue] / (m_avgThroughput[ue] + 1e-5);
+        m_pfOrder.push_back (ue);
+      }
+      uint32_t numScheduled = std::min (count, m_config.maxUesPerSlot);
+      if (numScheduled < count)
+      {
+        std::nth_element (m_pfOrder.begin (), m_pfOrder.begin () + numScheduled, m_pfOrder.end (),
+                          [this] (uint32_t a, uint32_t c)
+                          {
+                            return m_pfMetric[a] > m_pfMetric[c]
+                                   || (m_pfMetric[a] == m_pfMetric[c] && a < c);
+                          });
+      }
+      double allocatedRbs = m_config.bwpRbs[b] / std::max (1u, numScheduled);
+
+      for (uint32_t i = 0; i < numScheduled; ++i)
+      {
+        uint32_t ue = m_pfOrder[i];
+        totalThroughput += ServeUe (ue, true, slot, allocatedRbs, channelQuality);
+        totalDelay += m_holDelay[ue];
+        m_scheduled[ue] = 1;
+      }
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        uint32_t ue = first[i];
+        if (m_scheduled[ue])
+        {
+          m_scheduled[ue] = 0;
+          continue;
+        }
+        ServeUe (ue, false, slot, 0.0, 0.0);
+        totalDelay += m_holDelay[ue];
+      }
+    }
+  }
+
+  NrUFastSimResult result;
+  double slots = std::max (1u, m_config.slotsPerWindow);
+  result.avgHolDelay = totalDelay / (std::max (1u, m_config.numUes) * slots);
+  result.throughput = totalThroughput / slots;
+  result.lbtSuccessRate = successfulTransmissions / slots;
+  result.droppedPackets = dropped;
+  result.reward = m_config.beta * result.throughput / m_meanTmax
+                  - m_config.alpha * result.avgHolDelay / m_config.maxDelayThreshold;
+  GetState (state);
+  return result;
+}
+
+void
+NrUFastSim::GetState (int32_t* state) const
+{
+  for (uint32_t b = 0; b < m_config.numBwps; ++b, state += 3)
+  {
+    uint32_t count = m_bwpStart[b + 1] - m_bwpStart[b];
+    if (count == 0)
+    {
+      state[0] = state[1] = state[2] = 0;
+      continue;
+    }
+    double delaySum = 0.0;
+    double cqiSum = 0.0;
+    uint64_t queued = 0;
+    for (uint32_t i = m_bwpStart[b]; i < m_bwpStart[b + 1]; ++i)
+    {
+      uint32_t ue = m_bwpUes[i];
+      delaySum += m_holDelay[ue];
+      cqiSum += m_cqi[ue];
+      queued += m_queues.GetLength (ue);
+    }
+    state[0] = std::min (10, static_cast<int32_t> (delaySum / count / 5));
+    state[1] = std::min (10, static_cast<int32_t> (cqiSum / count * 2));
+    state[2] = std::min<int32_t> (10, queued / 5);
+  }
+}
+
+void
+NrUFastSim::GetBwpState (double* lbtFailureRate, double* channelQuality) const
+{
+  for (uint32_t b = 0; b < m_config.numBwps; ++b)
+  {
+    lbtFailureRate[b] = m_lbtAttempts[b] > 0 ? double (m_lbtFailures[b]) / m_lbtAttempts[b] : -1.0;
+    channelQuality[b] = m_channelQuality[b];
+  }
+}
+
+void
+NrUFastSim::GetUeState (float* out) const
+{
+  for (uint32_t ue = 0; ue < m_config.numUes; ++ue, out += 4)
+  {
+    out[0] = m_queues.GetLength (ue);
+    out[1] = m_holDelay[ue];
+    out[2] = m_cqi[ue];
+    out[3] = m_avgThroughput[ue];
+  }
+}
+
+} // namespace ns3
+
+using ns3::NrUFastSim;
+
+NrUFastSim*
+nru_fast_sim_create (const ns3::NrUFastSimConfig* config)
+{
+  return new NrUFastSim (config ? *config : NrUFastSim::GetDefaultConfig ());
+}
+
+void
+nru_fast_sim_destroy (NrUFastSim* sim)
+{
+  delete sim;
+}
+
+void
+nru_fast_sim_default_config (ns3::NrUFastSimConfig* config)
+{
+  *config = NrUFastSim::GetDefaultConfig ();
+}
+
+void
+nru_fast_sim_reset (NrUFastSim* sim, int32_t* state)
+{
+  sim->Reset (state);
+}
+
+void
+nru_fast_sim_step (NrUFastSim* sim, const uint32_t* action, int32_t* state,
+                   ns3::NrUFastSimResult* result)
+{
+  *result = sim->Step (action, state);
+}
+
+void
+nru_fast_sim_ue_state (const NrUFastSim* sim, float* out)
+{
+  sim->GetUeState (out);
+}
+
+void
+nru_fast_sim_set_rates (NrUFastSim* sim, const double* rates)
+{
+  sim->SetArrivalRates (rates);
+}
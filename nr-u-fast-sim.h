@@ -0,0 +1,164 @@
+#ifndef NR_U_FAST_SIM_H
+#define NR_U_FAST_SIM_H
+
+#include "nr-u-packet-queue-pool.h"
+#include "nr-u-traffic-source.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace ns3 {
+
+/// Largest number of BWPs a fast simulation can hold
+#define NR_U_FAST_SIM_MAX_BWPS 16
+
+/**
+ * \brief Scenario of a fast simulation, defaults as in RL.py
+ *
+ * Plain C layout, shared with nr_u_fast_sim.py through ctypes.
+ */
+struct NrUFastSimConfig
+{
+  uint32_t numUes;                              ///< NUM_UES
+  uint32_t numBwps;                             ///< NUM_BWPS
+  uint32_t maxUesPerSlot;                       ///< MAX_UES_PER_SLOT
+  uint32_t slotsPerWindow;                      ///< SLOTS_PER_WINDOW
+  uint32_t maxQueueSize;                        ///< MAX_QUEUE_SIZE, packets
+  uint32_t slotsPerSec;                         ///< SLOTS_PER_SEC
+  double alpha;                                 ///< ALPHA, delay weight of the reward
+  double maxDelayThreshold;                     ///< MAX_DELAY_THRESHOLD, slots
+  double wifiInterference[NR_U_FAST_SIM_MAX_BWPS];   ///< WIFI_INTERFERENCE
+  uint32_t bwpRbs[NR_U_FAST_SIM_MAX_BWPS];      ///< BWP_RBS
+  uint64_t seed;                                ///< Seed of the generator
+  double arrivalRate;                           ///< Packets per UE and slot, 0 for U(0.1, 0.3) per UE
+  double beta;                                  ///< BETA, throughput weight of the reward
+};
+
+/// Outcome of one decision window, as returned by PythonNRUEnv.step
+struct NrUFastSimResult
+{
+  double reward;                                ///< beta * throughput / T_max - alpha * delay / D_max
+  double avgHolDelay;                           ///< Slots, per UE and slot
+  double throughput;                            ///< Per slot
+  double lbtSuccessRate;                        ///< Successful BWP accesses per slot
+  double droppedPackets;                        ///< Packets tail-dropped in the window
+};
+
+/**
+ * \brief Headless slot engine equivalent to RL.py's PythonNRUEnv
+ *
+ * Runs the same traffic, channel, Cat-4 LBT and proportional-fair model
+ * without ns-3, on flat per-UE and per-BWP arrays and pooled packet queues. UEs are grouped by BWP
+ * once per window rather than once per slot and BWP, arrivals of all UEs
+ * are drawn in one pass per slot (NrUTrafficSource), and nothing is
+ * allocated while stepping. The random streams differ from numpy's, so
+ * runs match RL.py statistically, not draw for draw.
+ *
+ * The C functions below expose the engine to the Python trainer
+ * (nr_u_fast_sim.py).
+ */
+class NrUFastSim
+{
+public:
+  /// \return the RL.py parameters
+  static NrUFastSimConfig GetDefaultConfig (void);
+
+  explicit NrUFastSim (const NrUFastSimConfig& config);
+
+  /**
+   * \brief Draw new UEs and channels and random BWP assignments
+   * \param state 3 x numBwps values, written (see GetState)
+   */
+  void Reset (int32_t* state);
+
+  /**
+   * \brief Run one decision window with the given BWP assignments
+   * \param action BWP of every UE; UEs with an invalid BWP are idle
+   * \param state 3 x numBwps values, written (see GetState)
+   * \return the window metrics
+   */
+  NrUFastSimResult Step (const uint32_t* action, int32_t* state);
+
+  /**
+   * \brief Discretized state of PythonNRUEnv.get_state: per BWP, average
+   *        HoL delay / 5, average CQI * 2 and queued packets / 5, capped at 10
+   * \param state 3 x numBwps values, written
+   */
+  void GetState (int32_t* state) const;
+
+  /**
+   * \brief Raw per-UE state for richer observations
+   * \param out numUes x 4 values, written: queued packets, HoL delay,
+   *        CQI and average throughput
+   */
+  void GetUeState (float* out) const;
+
+  /**
+   * \brief Per-BWP view of the last window, as the LCA heuristic sees it
+   * \param lbtFailureRate numBwps values, written: failed LBT attempts over
+   *        attempts, -1 for a BWP no UE used
+   * \param channelQuality numBwps values, written: current channel quality
+   */
+  void GetBwpState (double* lbtFailureRate, double* channelQuality) const;
+
+  const NrUFastSimConfig& GetConfig (void) const;
+
+  /**
+   * \brief Fix the arrival rate of every UE, kept across resets
+   * \param rates numUes packets per slot, or nullptr to go back to the
+   *        configured arrivalRate
+   */
+  void SetArrivalRates (const double* rates);
+
+private:
+  uint32_t GenerateTraffic (uint32_t slot);
+  double ServeUe (uint32_t ue, bool served, uint32_t slot, double allocatedRbs, double channelQuality);
+  bool Cat4Lbt (uint32_t bwp);
+  void GroupUesByBwp (void);
+
+  NrUFastSimConfig m_config;        ///< Scenario
+  double m_meanTmax;                ///< Mean BWP capacity, Mbit/s
+  std::mt19937_64 m_rng;            ///< Every draw of the engine
+  uint32_t m_slot;                  ///< Slots since Reset
+
+  // Per UE
+  std::vector<uint32_t> m_assignment;
+  std::vector<double> m_arrivalRates;   ///< Fixed rates, empty to draw them at Reset
+  std::vector<double> m_capacity;   ///< current_C
+  std::vector<double> m_cqi;
+  std::vector<double> m_avgThroughput;
+  std::vector<uint32_t> m_holDelay;
+
+  NrUPacketQueuePool m_queues;      ///< Per-UE FIFO, maxQueueSize packets each
+  NrUTrafficSource m_traffic;       ///< Arrivals of every UE
+  NrUTrafficSource::Batch m_arrivals;   ///< Packets of the current slot
+
+  // Per BWP
+  std::vector<double> m_channelQuality;
+  std::vector<uint32_t> m_lbtAttempts;   ///< In the last window
+  std::vector<uint32_t> m_lbtFailures;   ///< In the last window
+  std::vector<uint32_t> m_bwpStart;  ///< numBwps + 1 offsets into m_bwpUes
+  std::vector<uint32_t> m_bwpUes;    ///< UEs grouped by BWP, in UE order
+
+  // PF scratch
+  std::vector<double> m_pfMetric;
+  std::vector<uint32_t> m_pfOrder;
+  std::vector<uint8_t> m_scheduled;
+};
+
+} // namespace ns3
+
+extern "C" {
+
+ns3::NrUFastSim* nru_fast_sim_create (const ns3::NrUFastSimConfig* config);
+void nru_fast_sim_destroy (ns3::NrUFastSim* sim);
+void nru_fast_sim_default_config (ns3::NrUFastSimConfig* config);
+void nru_fast_sim_reset (ns3::NrUFastSim* sim, int32_t* state);
+void nru_fast_sim_step (ns3::NrUFastSim* sim, const uint32_t* action, int32_t* state,
+                        ns3::NrUFastSimResult* result);
+void nru_fast_sim_ue_state (const ns3::NrUFastSim* sim, float* out);
+void nru_fast_sim_set_rates (ns3::NrUFastSim* sim, const double* rates);
+
+}
+
+#endif /* NR_U_FAST_SIM_H */
@@ -21,9 +21,11 @@
 #include "nr-u-lbt.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
-#include "ns3/random-variable-stream.h"
+#include "ns3/nr-u-random-variable.h"
 #include "ns3/nr-u-phy.h"
+#include "ns3/nr-u-trace-ring.h"
 #include <algorithm>
+#include <numeric>
 
 namespace ns3 {
 
@@ -63,7 +65,7 @@ NrUeLbt::NrUeLbt ()
   : m_phy (nullptr)
 {
   NS_LOG_FUNCTION (this);
-  m_uniformRandom = CreateObject<UniformRandomVariable> ();
+  m_uniformRandom = CreateObject<NrUUniformRandomVariable> ();
 }
 
 NrUeLbt::~NrUeLbt ()
@@ -72,7 +74,7 @@ NrUeLbt::~NrUeLbt ()
 }
 
 void
-NrUeLbt::SetPhy (Ptr<NrUePhy> phy)
+NrUeLbt::SetPhy (Ptr<NrUPhy> phy)
 {
   NS_LOG_FUNCTION (this << phy);
   m_phy = phy;
@@ -99,6 +101,46 @@ NrUeLbt::AddBwp (uint16_t bwpId, double wifiPoissonMean)
   ScheduleWifiInterference (bwpId);
 }
 
+void
+NrUeLbt::AddBwps (const std::vector<uint16_t>& bwpIds,
+                  const std::vector<double>& wifiPoissonMeans)
+{
+  NS_LOG_FUNCTION (this << bwpIds.size ());
+  NS_ASSERT_MSG (bwpIds.size () == wifiPoissonMeans.size (),
+                 "Each BWP needs exactly one WiFi Poisson mean");
+ 
+  std::vector<std::size_t> order (bwpIds.size ());
+  std::iota (order.begin (), order.end (), 0);
+  std::sort (order.begin (), order.end (),
+             [&bwpIds] (std::size_t a, std::size_t b) { return bwpIds[a] < bwpIds[b]; });
+ 
+  Time now = Simulator::Now ();
+  auto hint = m_bwpStates.begin ();
+  for (std::size_t idx : order)
+  {
+    uint16_t bwpId = bwpIds[idx];
+    std::size_t before = m_bwpStates.size ();
+    hint = m_bwpStates.emplace_hint (hint, bwpId, BwpLbtState ());
+    if (m_bwpStates.size () != before)
+    {
+      BwpLbtState& state = hint->second;
+      state.bwpId = bwpId;
+      state.currentCw = m_cwMin;
+      state.wifiPoissonMean = wifiPoissonMeans[idx];
+      state.wifiOccupancy = 0.0;
+      state.lbtFailureRate = 0.0;
+      state.totalAttempts = 0;
+      state.totalFailures = 0;
+      state.lastUpdateTime = now;
+ 
+      state.wifiEvent = Simulator::Schedule (Seconds (1.0) / state.wifiPoissonMean,
+                                             &NrUeLbt::HandleWifiInterference, this, bwpId);
+    }
+    ++hint;
+  }
+  NS_LOG_INFO ("Added " << bwpIds.size () << " BWPs, " << m_bwpStates.size () << " in total");
+}
+
 void
 NrUeLbt::ScheduleWifiInterference (uint16_t bwpId)
 {
@@ -107,7 +149,7 @@ NrUeLbt::ScheduleWifiInterference (uint16_t bwpId)
   auto& state = m_bwpStates[bwpId];
   Time interval = Seconds (1.0) / state.wifiPoissonMean;
  
-  Simulator::Schedule (interval, &NrUeLbt::HandleWifiInterference, this, bwpId);
+  state.wifiEvent = Simulator::Schedule (interval, &NrUeLbt::HandleWifiInterference, this, bwpId);
 }
 
 void
@@ -118,7 +160,7 @@ NrUeLbt::HandleWifiInterference (uint16_t bwpId)
   auto& state = m_bwpStates[bwpId];
  
   // Mark channel as busy for random duration (1-5 slots)
-  uint16_t busySlots = 1 + (rand () % 5);
+  uint16_t busySlots = m_uniformRandom->GetInteger (1, 5);
   state.channelBusyUntil = Simulator::Now () + MilliSeconds (busySlots * 0.5); // 0.5ms slots
  
   // Update WiFi occupancy statistics
@@ -134,15 +176,16 @@ NrUeLbt::HandleWifiInterference (uint16_t bwpId)
 bool
 NrUeLbt::ChannelAccessRequest (uint16_t bwpId)
 {
-  NS_LOG_FUNCTION (this << bwpId);
- 
+  // Called per BWP and slot: traced to the binary ring rather than logged
   auto& state = m_bwpStates[bwpId];
   state.totalAttempts++;
+  int64_t now = Simulator::Now ().GetNanoSeconds ();
+  NrUTraceRing::Write (NrUTraceRing::LBT_ATTEMPT, now, bwpId, 0, state.currentCw, 0);
  
   // ICCA - Immediate check
   if (Simulator::Now () < state.channelBusyUntil)
   {
-    NS_LOG_DEBUG ("ICCA failed for BWP " << bwpId);
+    NrUTraceRing::Write (NrUTraceRing::LBT_OUTCOME, now, bwpId, 0, NrUTraceRing::LBT_ICCA_BUSY, 0);
     state.totalFailures++;
     UpdateFailureRate (bwpId);
     return false;
@@ -152,48 +195,41 @@ NrUeLbt::ChannelAccessRequest (uint16_t bwpId)
   uint16_t backoffSlots = m_uniformRandom->GetInteger (0, state.currentCw - 1);
   Time backoffTime = MilliSeconds (backoffSlots * 0.5); // 0.5ms slots
  
-  NS_LOG_DEBUG ("ECCA backoff for BWP " << bwpId << ": " << backoffSlots << " slots");
- 
   Time endTime = Simulator::Now () + backoffTime;
  
   // Check for interruptions during backoff
   if (endTime > state.channelBusyUntil)
   {
-    NS_LOG_DEBUG ("ECCA interrupted by WiFi for BWP " << bwpId);
+    NrUTraceRing::Write (NrUTraceRing::LBT_OUTCOME, now, bwpId, 0,
+                         NrUTraceRing::LBT_ECCA_INTERRUPTED, backoffSlots);
     state.totalFailures++;
     UpdateFailureRate (bwpId);
    
     // Double CW for next attempt (up to max)
-    state.currentCw = std::min (2 * state.currentCw, m_cwMax);
+    state.currentCw = std::min<uint16_t> (2 * state.currentCw, m_cwMax);
     return false;
   }
  
   // Success - reset CW and grant channel access
   state.currentCw = m_cwMin;
   state.channelOccupiedUntil = Simulator::Now () + MilliSeconds (m_mcotDuration);
- 
-  NS_LOG_DEBUG ("Channel access granted for BWP " << bwpId << " for " << m_mcotDuration << " slots");
+  NrUTraceRing::Write (NrUTraceRing::LBT_OUTCOME, now, bwpId, 0, NrUTraceRing::LBT_GRANTED, backoffSlots);
   return true;
 }
 
 void
 NrUeLbt::UpdateFailureRate (uint16_t bwpId)
 {
-  NS_LOG_FUNCTION (this << bwpId);
- 
   auto& state = m_bwpStates[bwpId];
  
   // Exponential moving average of failure rate
   double currentRate = (double)state.totalFailures / state.totalAttempts;
   state.lbtFailureRate = (0.9 * state.lbtFailureRate) + (0.1 * currentRate);
- 
-  NS_LOG_DEBUG ("Updated LBT failure rate for BWP " << bwpId << ": " << state.lbtFailureRate);
 }
 
 double
 NrUeLbt::GetFailureRate (uint16_t bwpId) const
 {
-  NS_LOG_FUNCTION (this << bwpId);
   auto it = m_bwpStates.find (bwpId);
   if (it != m_bwpStates.end ())
   {
@@ -205,7 +241,6 @@ NrUeLbt::GetFailureRate (uint16_t bwpId) const
 double
 NrUeLbt::GetWifiOccupancy (uint16_t bwpId) const
 {
-  NS_LOG_FUNCTION (this << bwpId);
   auto it = m_bwpStates.find (bwpId);
   if (it != m_bwpStates.end ())
   {
@@ -217,7 +252,6 @@ NrUeLbt::GetWifiOccupancy (uint16_t bwpId) const
 uint16_t
 NrUeLbt::GetContentionWindow (uint16_t bwpId) const
 {
-  NS_LOG_FUNCTION (this << bwpId);
   auto it = m_bwpStates.find (bwpId);
   if (it != m_bwpStates.end ())
   {
@@ -237,11 +271,71 @@ NrUeLbt::SetWifiInterference (uint16_t bwpId, double poissonMean)
   }
 }
 
+int64_t
+NrUeLbt::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_uniformRandom->SetStream (stream);
+  return 1;
+}
+
+void
+NrUeLbt::SaveState (Snapshot& snapshot) const
+{
+  NS_LOG_FUNCTION (this);
+  Time now = Simulator::Now ();
+  snapshot.bwpStates = m_bwpStates;
+  snapshot.wifiEventDelays.clear ();
+  for (auto& entry : snapshot.bwpStates)
+  {
+    BwpLbtState& state = entry.second;
+    state.channelBusyUntil -= now;
+    state.channelOccupiedUntil -= now;
+    state.lastUpdateTime -= now;
+    if (!state.wifiEvent.IsExpired ())
+    {
+      snapshot.wifiEventDelays[entry.first] = Simulator::GetDelayLeft (state.wifiEvent);
+    }
+    state.wifiEvent = EventId ();
+  }
+  m_uniformRandom->SaveState (snapshot.rng);
+}
+
+void
+NrUeLbt::RestoreState (const Snapshot& snapshot)
+{
+  NS_LOG_FUNCTION (this);
+  Time now = Simulator::Now ();
+  for (auto& entry : m_bwpStates)
+  {
+    entry.second.wifiEvent.Cancel ();
+  }
+  m_bwpStates = snapshot.bwpStates;
+  for (auto& entry : m_bwpStates)
+  {
+    BwpLbtState& state = entry.second;
+    state.channelBusyUntil += now;
+    state.channelOccupiedUntil += now;
+    state.lastUpdateTime += now;
+    auto delay = snapshot.wifiEventDelays.find (entry.first);
+    if (delay != snapshot.wifiEventDelays.end ())
+    {
+      state.wifiEvent = Simulator::Schedule (delay->second, &NrUeLbt::HandleWifiInterference,
+                                             this, entry.first);
+    }
+  }
+  m_uniformRandom->RestoreState (snapshot.rng);
+}
+
 void
 NrUeLbt::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
   m_phy = nullptr;
+  for (auto& entry : m_bwpStates)
+  {
+    entry.second.wifiEvent.Cancel ();
+  }
   m_bwpStates.clear ();
 }
 
@@ -3,12 +3,14 @@
 
 #include "ns3/object.h"
 #include "ns3/nstime.h"
-#include "ns3/random-variable-stream.h"
+#include "ns3/event-id.h"
+#include "ns3/nr-u-random-variable.h"
 #include <map>
+#include <vector>
 
 namespace ns3 {
 
-class NrUePhy;
+class NrUPhy;
 
 /**
  * \brief Implements Listen Before Talk (LBT) functionality for NR-U
@@ -18,6 +20,22 @@ class NrUePhy;
  */
 class NrUeLbt : public Object
 {
+private:
+  /// BWP-specific LBT state
+  struct BwpLbtState {
+    uint16_t bwpId;                 ///< BWP identifier
+    uint16_t currentCw;             ///< Current contention window size
+    double wifiPoissonMean;         ///< WiFi interference rate
+    double wifiOccupancy;           ///< Measured WiFi occupancy
+    double lbtFailureRate;          ///< LBT failure rate
+    uint32_t totalAttempts;         ///< Total access attempts
+    uint32_t totalFailures;         ///< Total access failures
+    Time channelBusyUntil;          ///< Time until channel is busy
+    Time channelOccupiedUntil;      ///< Time until we occupy channel
+    Time lastUpdateTime;            ///< Last statistics update time
+    EventId wifiEvent;              ///< Next WiFi interference event
+  };
+
 public:
   /**
    * \brief Get the type ID.
@@ -32,7 +50,7 @@ public:
    * \brief Set the PHY layer
    * \param phy The PHY layer
    */
-  void SetPhy (Ptr<NrUePhy> phy);
+  void SetPhy (Ptr<NrUPhy> phy);
 
   /**
    * \brief Add a BWP to manage LBT for
@@ -41,6 +59,18 @@ public:
    */
   void AddBwp (uint16_t bwpId, double wifiPoissonMean);
 
+  /**
+   * \brief Add several BWPs in one pass
+   *
+   * BWPs that are already managed are left untouched, so their WiFi
+   * interference process is not scheduled twice.
+   *
+   * \param bwpIds The BWP identifiers
+   * \param wifiPoissonMeans Mean interval for WiFi interference, one per BWP
+   */
+  void AddBwps (const std::vector<uint16_t>& bwpIds,
+                const std::vector<double>& wifiPoissonMeans);
+
   /**
    * \brief Request channel access
    * \param bwpId The BWP identifier
@@ -60,30 +90,50 @@ public:
    */
   void SetWifiInterference (uint16_t bwpId, double poissonMean);
 
+  /**
+   * \brief Assign a fixed random variable stream number to the random
+   * variables used by this model
+   * \param stream The first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \brief LBT state saved by SaveState
+   *
+   * Times are stored relative to the time of the snapshot, the random
+   * stream by the state of its generator.
+   */
+  struct Snapshot {
+    std::map<uint16_t, BwpLbtState> bwpStates;  ///< Per-BWP state, relative times
+    std::map<uint16_t, Time> wifiEventDelays;   ///< Delay of each pending WiFi event
+    NrUUniformRandomVariable::State rng;        ///< Generator state
+  };
+
+  /**
+   * \brief Save the LBT state
+   * \param snapshot The snapshot to fill, its storage is reused
+   */
+  void SaveState (Snapshot& snapshot) const;
+
+  /**
+   * \brief Restore a saved state, rebasing its times on the current time
+   * \param snapshot The snapshot to restore
+   */
+  void RestoreState (const Snapshot& snapshot);
+
 protected:
   virtual void DoDispose (void);
 
 private:
-  /// BWP-specific LBT state
-  struct BwpLbtState {
-    uint16_t bwpId;                 ///< BWP identifier
-    uint16_t currentCw;             ///< Current contention window size
-    double wifiPoissonMean;         ///< WiFi interference rate
-    double wifiOccupancy;           ///< Measured WiFi occupancy
-    double lbtFailureRate;          ///< LBT failure rate
-    uint32_t totalAttempts;         ///< Total access attempts
-    uint32_t totalFailures;         ///< Total access failures
-    Time channelBusyUntil;          ///< Time until channel is busy
-    Time channelOccupiedUntil;      ///< Time until we occupy channel
-    Time lastUpdateTime;            ///< Last statistics update time
-  };
+  friend class NrUBenchmark; ///< Times the private steps (nr-u-bench.cc)
 
   void ScheduleWifiInterference (uint16_t bwpId);
   void HandleWifiInterference (uint16_t bwpId);
   void UpdateFailureRate (uint16_t bwpId);
 
-  Ptr<NrUePhy> m_phy;                          ///< PHY layer
-  Ptr<UniformRandomVariable> m_uniformRandom;   ///< Random number generator
+  Ptr<NrUPhy> m_phy;                           ///< PHY layer
+  Ptr<NrUUniformRandomVariable> m_uniformRandom; ///< Random number generator
   std::map<uint16_t, BwpLbtState> m_bwpStates; ///< Per-BWP LBT state
 
   // Parameters
@@ -0,0 +1,381 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-metrics-writer.h"
+#include <cstring>
+
+#ifdef NR_U_METRICS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ns3 {
+
+namespace {
+
+const uint32_t CODEC_RAW = 0;
+const uint32_t CODEC_SHUFFLE_DEFLATE = 1;
+
+/// Chunks allowed to wait for the flush thread before Append blocks
+const std::size_t MAX_PENDING = 4;
+
+const uint8_t ZERO_PADDING[8] = {};
+
+std::size_t
+PaddingTo8 (std::size_t bytes)
+{
+  return (8 - bytes % 8) % 8;
+}
+
+template <typename T>
+void
+Store (uint8_t* dst, double value)
+{
+  T typed = static_cast<T> (value);
+  std::memcpy (dst, &typed, sizeof (T));
+}
+
+} // anonymous namespace
+
+NrUMetricsWriter::NrUMetricsWriter ()
+  : m_file (nullptr),
+    m_chunkRows (0),
+    m_compress (false),
+    m_rows (0),
+    m_stop (false),
+    m_good (true)
+{
+}
+
+NrUMetricsWriter::~NrUMetricsWriter ()
+{
+  Close ();
+}
+
+uint32_t
+NrUMetricsWriter::GetTypeSize (ColumnType type)
+{
+  switch (type)
+  {
+    case UINT32:
+    case FLOAT32:
+      return 4;
+    case UINT64:
+    case INT64:
+    case FLOAT64:
+      return 8;
+  }
+  return 0;
+}
+
+bool
+NrUMetricsWriter::HasCompression (void)
+{
+#ifdef NR_U_METRICS_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool
+NrUMetricsWriter::Open (const std::string& path, const std::vector<Column>& columns,
+                        uint32_t chunkRows, bool compress)
+{
+  Close ();
+  if (columns.empty () || columns.size () > 255 || chunkRows == 0)
+  {
+    return false;
+  }
+  for (const Column& column : columns)
+  {
+    if (column.name.size () > 255 || GetTypeSize (column.type) == 0)
+    {
+      return false;
+    }
+  }
+
+  m_file = std::fopen (path.c_str (), "wb");
+  if (m_file == nullptr)
+  {
+    return false;
+  }
+
+  std::vector<uint8_t> header;
+  auto put32 = [&header] (uint32_t value)
+  {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*> (&value);
+    header.insert (header.end (), bytes, bytes + 4);
+  };
+  put32 (MAGIC);
+  put32 (VERSION);
+  put32 (columns.size ());
+  put32 (0);
+  for (const Column& column : columns)
+  {
+    header.push_back (column.type);
+    header.push_back (column.name.size ());
+    header.insert (header.end (), column.name.begin (), column.name.end ());
+  }
+  header.resize (header.size () + PaddingTo8 (header.size ()), 0);
+  if (std::fwrite (header.data (), 1, header.size (), m_file) != header.size ())
+  {
+    std::fclose (m_file);
+    m_file = nullptr;
+    return false;
+  }
+
+  m_columns = columns;
+  m_widths.clear ();
+  for (const Column& column : columns)
+  {
+    m_widths.push_back (GetTypeSize (column.type));
+  }
+  m_chunkRows = chunkRows;
+  m_compress = compress && HasCompression ();
+  m_rows = 0;
+  m_stop = false;
+  m_good = true;
+  m_current = NewChunk ();
+  m_flusher = std::thread (&NrUMetricsWriter::FlushLoop, this);
+  return true;
+}
+
+void
+NrUMetricsWriter::Close (void)
+{
+  if (m_file == nullptr)
+  {
+    return;
+  }
+  Submit ();
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one ();
+  m_flusher.join ();
+  std::fclose (m_file);
+  m_file = nullptr;
+  m_current.reset ();
+  m_free.clear ();
+}
+
+bool
+NrUMetricsWriter::IsOpen (void) const
+{
+  return m_file != nullptr;
+}
+
+uint64_t
+NrUMetricsWriter::GetRows (void) const
+{
+  return m_rows;
+}
+
+bool
+NrUMetricsWriter::IsGood (void) const
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_good;
+}
+
+std::unique_ptr<NrUMetricsWriter::Chunk>
+NrUMetricsWriter::NewChunk (void)
+{
+  std::unique_ptr<Chunk> chunk (new Chunk);
+  chunk->columns.resize (m_columns.size ());
+  for (std::size_t c = 0; c < m_columns.size (); ++c)
+  {
+    chunk->columns[c].resize (static_cast<std::size_t> (m_chunkRows) * m_widths[c]);
+  }
+  return chunk;
+}
+
+void
+NrUMetricsWriter::Append (const double* row)
+{
+  if (m_file == nullptr)
+  {
+    return;
+  }
+  uint32_t r = m_current->rows;
+  for (std::size_t c = 0; c < m_columns.size (); ++c)
+  {
+    uint8_t* dst = m_current->columns[c].data () + static_cast<std::size_t> (r) * m_widths[c];
+    switch (m_columns[c].type)
+    {
+      case UINT32:
+        Store<uint32_t> (dst, row[c]);
+        break;
+      case UINT64:
+        Store<uint64_t> (dst, row[c]);
+        break;
+      case INT64:
+        Store<int64_t> (dst, row[c]);
+        break;
+      case FLOAT32:
+        Store<float> (dst, row[c]);
+        break;
+      case FLOAT64:
+        Store<double> (dst, row[c]);
+        break;
+    }
+  }
+  m_rows++;
+  if (++m_current->rows == m_chunkRows)
+  {
+    Submit ();
+  }
+}
+
+void
+NrUMetricsWriter::Append (std::initializer_list<double> row)
+{
+  if (row.size () == m_columns.size ())
+  {
+    Append (row.begin ());
+  }
+}
+
+void
+NrUMetricsWriter::Flush (void)
+{
+  if (m_file != nullptr)
+  {
+    Submit ();
+  }
+}
+
+void
+NrUMetricsWriter::Submit (void)
+{
+  if (m_current->rows == 0)
+  {
+    return;
+  }
+  std::unique_lock<std::mutex> lock (m_mutex);
+  // Back-pressure: the simulation waits rather than buffering without bound
+  m_room.wait (lock, [this] { return m_pending.size () < MAX_PENDING; });
+  m_pending.push_back (std::move (m_current));
+  if (!m_free.empty ())
+  {
+    m_current = std::move (m_free.back ());
+    m_free.pop_back ();
+  }
+  lock.unlock ();
+  m_wake.notify_one ();
+  if (!m_current)
+  {
+    m_current = NewChunk ();
+  }
+  m_current->rows = 0;
+}
+
+void
+NrUMetricsWriter::FlushLoop (void)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+  {
+    m_wake.wait (lock, [this] { return m_stop || !m_pending.empty (); });
+    if (m_pending.empty ())
+    {
+      return;
+    }
+    std::unique_ptr<Chunk> chunk = std::move (m_pending.front ());
+    m_pending.pop_front ();
+    lock.unlock ();
+
+    bool written = WriteChunk (*chunk);
+
+    lock.lock ();
+    if (m_pending.empty ())
+    {
+      // Idle: make the chunks so far visible to readers of a live run
+      std::fflush (m_file);
+    }
+    m_good = m_good && written;
+    m_free.push_back (std::move (chunk));
+    m_room.notify_one ();
+  }
+}
+
+bool
+NrUMetricsWriter::WriteChunk (const Chunk& chunk)
+{
+  struct ColumnEntry
+  {
+    uint32_t codec;
+    uint32_t reserved;
+    uint64_t bytes;
+  };
+  std::size_t numColumns = m_columns.size ();
+  std::vector<ColumnEntry> entries (numColumns);
+  std::vector<std::vector<uint8_t>> packed (numColumns);
+  for (std::size_t c = 0; c < numColumns; ++c)
+  {
+    std::size_t rawBytes = static_cast<std::size_t> (chunk.rows) * m_widths[c];
+    entries[c] = {CODEC_RAW, 0, rawBytes};
+#ifdef NR_U_METRICS_ZLIB
+    if (m_compress)
+    {
+      // Byte shuffle, then deflate at the fastest level
+      uint32_t width = m_widths[c];
+      const uint8_t* raw = chunk.columns[c].data ();
+      m_shuffled.resize (rawBytes);
+      for (uint32_t b = 0; b < width; ++b)
+      {
+        uint8_t* plane = m_shuffled.data () + static_cast<std::size_t> (b) * chunk.rows;
+        for (uint32_t i = 0; i < chunk.rows; ++i)
+        {
+          plane[i] = raw[static_cast<std::size_t> (i) * width + b];
+        }
+      }
+      uLongf packedBytes = compressBound (rawBytes);
+      packed[c].resize (packedBytes);
+      if (compress2 (packed[c].data (), &packedBytes, m_shuffled.data (), rawBytes, 1) == Z_OK
+          && packedBytes < rawBytes)
+      {
+        packed[c].resize (packedBytes);
+        entries[c] = {CODEC_SHUFFLE_DEFLATE, 0, packedBytes};
+      }
+      else
+      {
+        packed[c].clear ();
+      }
+    }
+#endif
+  }
+
+  uint32_t head[2] = {CHUNK_MAGIC, chunk.rows};
+  bool ok = std::fwrite (head, sizeof (head), 1, m_file) == 1
+            && std::fwrite (entries.data (), sizeof (ColumnEntry), numColumns, m_file) == numColumns;
+  for (std::size_t c = 0; c < numColumns && ok; ++c)
+  {
+    const uint8_t* payload = entries[c].codec == CODEC_RAW ? chunk.columns[c].data () : packed[c].data ();
+    std::size_t bytes = entries[c].bytes;
+    std::size_t padding = PaddingTo8 (bytes);
+    ok = std::fwrite (payload, 1, bytes, m_file) == bytes
+         && std::fwrite (ZERO_PADDING, 1, padding, m_file) == padding;
+  }
+  return ok;
+}
+
+} // namespace ns3
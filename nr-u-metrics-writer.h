@@ -0,0 +1,145 @@
+#ifndef NR_U_METRICS_WRITER_H
+#define NR_U_METRICS_WRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Streaming writer of a fixed-schema table in a columnar binary file
+ *
+ * Rows are appended into per-column typed buffers; every ChunkRows rows the
+ * buffers are handed to a background thread, which compresses and writes
+ * them while the simulation keeps filling a recycled set of buffers. No
+ * text is formatted on the simulation thread. The file is read by
+ * nr_u_metrics.py (and parse_ns3_logs.py through it), little endian:
+ *
+ *   header   "NRUM", version, numColumns, reserved (uint32 each), then per
+ *            column: type (uint8), name length (uint8), name; zero padded
+ *            to a multiple of 8 bytes
+ *   chunk    "CHNK", rows (uint32), then per column: codec (uint32),
+ *            reserved (uint32), stored bytes (uint64); then each column's
+ *            payload, zero padded to a multiple of 8 bytes
+ *
+ * A raw payload (codec 0) is the column's values back to back, so a reader
+ * can map the file and view it in place. A compressed payload (codec 1)
+ * is the byte-shuffled values (all first bytes, then all second bytes,
+ * ...) deflated, which compresses slowly varying numbers far better than
+ * deflating them as they are; it is only used when built with zlib
+ * (NR_U_METRICS_ZLIB) and when it saves space. Chunks are self-contained,
+ * so a file cut short by a crash is readable up to its last whole chunk.
+ */
+class NrUMetricsWriter
+{
+public:
+  /// Type of a column's values
+  enum ColumnType : uint8_t
+  {
+    UINT32 = 0,
+    UINT64 = 1,
+    INT64 = 2,
+    FLOAT32 = 3,
+    FLOAT64 = 4
+  };
+
+  /// Name and type of a column
+  struct Column
+  {
+    std::string name;
+    ColumnType type;
+  };
+
+  static constexpr uint32_t MAGIC = 0x4d55524e;         ///< "NRUM"
+  static constexpr uint32_t CHUNK_MAGIC = 0x4b4e4843;   ///< "CHNK"
+  static constexpr uint32_t VERSION = 1;                ///< Layout version
+
+  NrUMetricsWriter ();
+  ~NrUMetricsWriter ();
+
+  NrUMetricsWriter (const NrUMetricsWriter&) = delete;
+  NrUMetricsWriter& operator= (const NrUMetricsWriter&) = delete;
+
+  /**
+   * \brief Create the file, write its header and start the flush thread
+   * \param path The file, replaced if it exists
+   * \param columns The schema, at most 255 columns with names below 256 bytes
+   * \param chunkRows Rows per chunk
+   * \param compress Deflate the chunks when zlib is available
+   * \return false if the schema is invalid or the file cannot be created
+   */
+  bool Open (const std::string& path, const std::vector<Column>& columns,
+             uint32_t chunkRows = 16384, bool compress = true);
+
+  /// Write the rows still buffered, stop the flush thread and close the file
+  void Close (void);
+
+  bool IsOpen (void) const;
+
+  /**
+   * \brief Append a row
+   * \param row One value per column in schema order, converted to the
+   *        column types
+   */
+  void Append (const double* row);
+  void Append (std::initializer_list<double> row);
+
+  /// Hand the rows buffered so far to the flush thread without waiting
+  void Flush (void);
+
+  /// \return the rows appended since Open
+  uint64_t GetRows (void) const;
+
+  /// \return false if a chunk could not be written
+  bool IsGood (void) const;
+
+  /// \return true if chunks can be compressed (built with zlib)
+  static bool HasCompression (void);
+
+  /// \return the size in bytes of a value of a column type
+  static uint32_t GetTypeSize (ColumnType type);
+
+private:
+  /// Column buffers of ChunkRows rows
+  struct Chunk
+  {
+    uint32_t rows = 0;
+    std::vector<std::vector<uint8_t>> columns;
+  };
+
+  std::unique_ptr<Chunk> NewChunk (void);
+  void Submit (void);
+  void FlushLoop (void);
+  bool WriteChunk (const Chunk& chunk);
+
+  std::FILE* m_file;
+  std::vector<Column> m_columns;
+  std::vector<uint32_t> m_widths;        ///< Bytes per value of each column
+  uint32_t m_chunkRows;
+  bool m_compress;
+  uint64_t m_rows;
+
+  std::unique_ptr<Chunk> m_current;      ///< Chunk being filled
+  std::deque<std::unique_ptr<Chunk>> m_pending;   ///< Chunks waiting for the flush thread
+  std::vector<std::unique_ptr<Chunk>> m_free;     ///< Written chunks, reused
+  std::thread m_flusher;
+  mutable std::mutex m_mutex;            ///< Protects m_pending, m_free, m_stop, m_good
+  std::condition_variable m_wake;        ///< Signals pending chunks or stop
+  std::condition_variable m_room;        ///< Signals a chunk was written
+  bool m_stop;
+  bool m_good;
+
+  std::vector<uint8_t> m_shuffled;       ///< Scratch of the flush thread
+};
+
+} // namespace ns3
+
+#endif /* NR_U_METRICS_WRITER_H */
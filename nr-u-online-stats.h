@@ -0,0 +1,266 @@
+#ifndef NR_U_ONLINE_STATS_H
+#define NR_U_ONLINE_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Running mean and variance (Welford), without storing the samples
+ *
+ * Two accumulators over disjoint samples merge exactly (Chan et al.), so
+ * replications running on separate threads can each keep their own and
+ * combine them at the end.
+ */
+class NrUOnlineStats
+{
+public:
+  /// Add one sample
+  void Add (double x)
+  {
+    m_count++;
+    double delta = x - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (x - m_mean);
+  }
+
+  /// Fold in the samples of another accumulator
+  void Merge (const NrUOnlineStats& other)
+  {
+    if (other.m_count == 0)
+    {
+      return;
+    }
+    uint64_t count = m_count + other.m_count;
+    double delta = other.m_mean - m_mean;
+    m_mean += delta * other.m_count / count;
+    m_m2 += other.m_m2 + delta * delta * m_count * other.m_count / count;
+    m_count = count;
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  double GetMean (void) const
+  {
+    return m_mean;
+  }
+
+  /// \return the unbiased sample variance, 0 below two samples
+  double GetVariance (void) const
+  {
+    return m_count > 1 ? m_m2 / (m_count - 1) : 0.0;
+  }
+
+  double GetStdDev (void) const
+  {
+    return std::sqrt (GetVariance ());
+  }
+
+  /// \return the half-width of the 95% Student-t confidence interval of the mean
+  double GetCi95 (void) const
+  {
+    if (m_count < 2)
+    {
+      return 0.0;
+    }
+    return GetStudentT95 (m_count - 1) * GetStdDev () / std::sqrt (double (m_count));
+  }
+
+  /**
+   * \brief Two-sided 95% quantile of Student's t distribution
+   * \param dof Degrees of freedom, at least 1
+   * \return the quantile; tabulated up to 30, then the 1/dof series
+   */
+  static double GetStudentT95 (uint64_t dof)
+  {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                   2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                   2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                   2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (dof == 0)
+    {
+      return 0.0;
+    }
+    if (dof <= 30)
+    {
+      return table[dof - 1];
+    }
+    return 1.959964 + 2.372 / dof + 2.82 / (double (dof) * dof);
+  }
+
+private:
+  uint64_t m_count = 0;   ///< Samples
+  double m_mean = 0.0;    ///< Running mean
+  double m_m2 = 0.0;      ///< Sum of squared deviations from the mean
+};
+
+/**
+ * \brief Exponential moving average, m = m + weight * (x - m)
+ *
+ * The first sample sets the average.
+ */
+class NrUEma
+{
+public:
+  explicit NrUEma (double weight = 0.1)
+    : m_weight (weight)
+  {
+  }
+
+  void SetWeight (double weight)
+  {
+    m_weight = weight;
+  }
+
+  void Add (double x)
+  {
+    m_value = m_count++ == 0 ? x : m_value + m_weight * (x - m_value);
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  double GetValue (void) const
+  {
+    return m_value;
+  }
+
+private:
+  double m_weight;        ///< Weight of a new sample
+  double m_value = 0.0;   ///< Current average
+  uint64_t m_count = 0;   ///< Samples
+};
+
+/**
+ * \brief Mean of the last N samples, as pandas' rolling(window=N).mean ()
+ *
+ * The samples are kept in a ring of N values. The running sum is
+ * recomputed from the ring once per lap, so rounding errors do not build up.
+ */
+class NrURollingMean
+{
+public:
+  explicit NrURollingMean (std::size_t window = 10)
+  {
+    SetWindow (window);
+  }
+
+  /// Set N and forget the samples
+  void SetWindow (std::size_t window)
+  {
+    m_ring.assign (std::max<std::size_t> (window, 1), 0.0);
+    m_next = 0;
+    m_filled = 0;
+    m_sum = 0.0;
+  }
+
+  void Add (double x)
+  {
+    m_sum += x - m_ring[m_next];
+    m_ring[m_next] = x;
+    if (++m_next == m_ring.size ())
+    {
+      m_next = 0;
+      m_sum = std::accumulate (m_ring.begin (), m_ring.end (), 0.0);
+    }
+    m_filled = std::min (m_filled + 1, m_ring.size ());
+  }
+
+  /// \return true once N samples were added; pandas gives NaN before
+  bool IsFull (void) const
+  {
+    return m_filled == m_ring.size ();
+  }
+
+  /// \return the mean of the last min(N, samples) samples, 0 without any
+  double GetMean (void) const
+  {
+    return m_filled > 0 ? m_sum / m_filled : 0.0;
+  }
+
+private:
+  std::vector<double> m_ring;   ///< Last N samples, 0 where none yet
+  std::size_t m_next = 0;       ///< Slot of the next sample
+  std::size_t m_filled = 0;     ///< Samples in the ring
+  double m_sum = 0.0;           ///< Sum of the ring
+};
+
+/**
+ * \brief Streaming summary of one metric sampled once per decision window
+ *
+ * Keeps, without storing the samples, what the post-processing scripts
+ * computed from the full logs: mean and variance over the whole run and
+ * over its stable period (the scripts' "last half"), an EMA and a rolling
+ * mean.
+ */
+class NrUStreamingMetric
+{
+public:
+  /**
+   * \brief Set the smoothing and forget the samples
+   * \param emaWeight Weight of a new sample in the EMA
+   * \param rollingWindow Samples in the rolling mean
+   */
+  void Configure (double emaWeight, std::size_t rollingWindow)
+  {
+    m_all = NrUOnlineStats ();
+    m_stable = NrUOnlineStats ();
+    m_ema = NrUEma (emaWeight);
+    m_rolling.SetWindow (rollingWindow);
+  }
+
+  /**
+   * \brief Add the sample of a window
+   * \param x The sample
+   * \param stable Whether the window belongs to the stable period
+   */
+  void Add (double x, bool stable)
+  {
+    m_all.Add (x);
+    if (stable)
+    {
+      m_stable.Add (x);
+    }
+    m_ema.Add (x);
+    m_rolling.Add (x);
+  }
+
+  const NrUOnlineStats& GetAll (void) const
+  {
+    return m_all;
+  }
+
+  const NrUOnlineStats& GetStable (void) const
+  {
+    return m_stable;
+  }
+
+  const NrUEma& GetEma (void) const
+  {
+    return m_ema;
+  }
+
+  const NrURollingMean& GetRolling (void) const
+  {
+    return m_rolling;
+  }
+
+private:
+  NrUOnlineStats m_all;       ///< Every window
+  NrUOnlineStats m_stable;    ///< Windows of the stable period
+  NrUEma m_ema;               ///< Exponential moving average
+  NrURollingMean m_rolling;   ///< Mean of the last windows
+};
+
+} // namespace ns3
+
+#endif /* NR_U_ONLINE_STATS_H */
@@ -0,0 +1,269 @@
+#ifndef NR_U_PACKET_QUEUE_POOL_H
+#define NR_U_PACKET_QUEUE_POOL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Per-UE FIFO packet queues as fixed-capacity rings in one arena
+ *
+ * Queue q owns packets [q * capacity, (q + 1) * capacity) of a single
+ * array of (arrival slot, remaining size) pairs, 8 bytes each, and its
+ * head index, length and backlog live in flat per-queue arrays. Enqueue,
+ * service and the HoL delay are O(1); a packet arriving at a full queue
+ * is tail-dropped and counted. Memory is numQueues x capacity x 8 bytes,
+ * allocated when queues are added, never per packet: 100k UEs with
+ * RL.py's MAX_QUEUE_SIZE of 200 take 160 MB.
+ *
+ * Sizes are in whatever unit the owner uses (bits in NrUPhy, RL.py size
+ * units in NrUFastSim), slots are the owner's slot counter.
+ */
+class NrUPacketQueuePool
+{
+public:
+  /**
+   * \brief Create the pool
+   * \param numQueues Initial number of queues
+   * \param capacity Packets per queue (MAX_QUEUE_SIZE)
+   */
+  explicit NrUPacketQueuePool (uint32_t numQueues = 0, uint32_t capacity = 200)
+    : m_capacity (std::max (capacity, 1u))
+  {
+    Resize (numQueues);
+  }
+
+  /**
+   * \brief Change the number of queues; existing queues keep their packets
+   * \param numQueues The new number of queues
+   */
+  void Resize (uint32_t numQueues)
+  {
+    m_packets.resize (static_cast<std::size_t> (numQueues) * m_capacity);
+    m_head.resize (numQueues, 0);
+    m_length.resize (numQueues, 0);
+    m_backlog.resize (numQueues, 0.0);
+    m_drops.resize (numQueues, 0);
+  }
+
+  /**
+   * \brief Change the capacity of every queue, emptying them
+   * \param capacity Packets per queue
+   */
+  void SetCapacity (uint32_t capacity)
+  {
+    uint32_t numQueues = GetNumQueues ();
+    m_capacity = std::max (capacity, 1u);
+    m_packets.assign (static_cast<std::size_t> (numQueues) * m_capacity, Packet ());
+    ClearAll ();
+  }
+
+  uint32_t GetNumQueues (void) const
+  {
+    return m_head.size ();
+  }
+
+  uint32_t GetCapacity (void) const
+  {
+    return m_capacity;
+  }
+
+  /**
+   * \brief Append a packet, or drop it if the queue is full
+   * \param queue The queue
+   * \param slot The arrival slot
+   * \param size The packet size
+   * \return false if the packet was dropped
+   */
+  bool Enqueue (uint32_t queue, uint32_t slot, float size)
+  {
+    uint32_t length = m_length[queue];
+    if (length >= m_capacity)
+    {
+      m_drops[queue]++;
+      return false;
+    }
+    uint32_t tail = m_head[queue] + length;
+    tail = tail >= m_capacity ? tail - m_capacity : tail;
+    Packet& packet = m_packets[Offset (queue) + tail];
+    packet.arrival = slot;
+    packet.remaining = size;
+    m_length[queue] = length + 1;
+    m_backlog[queue] += size;
+    return true;
+  }
+
+  /**
+   * \brief Serve the head packet only, partially if the budget is short
+   * \param queue The queue
+   * \param budget The amount that can be sent
+   * \return the amount sent, at most the remaining size of the head packet
+   */
+  float ServeHead (uint32_t queue, float budget)
+  {
+    return ServeHead (queue, budget, [] (uint32_t) {});
+  }
+
+  /**
+   * \brief ServeHead, calling departed (arrival slot) if the packet leaves
+   * \param queue The queue
+   * \param budget The amount that can be sent
+   * \param departed Called with the arrival slot of a completed packet
+   * \return the amount sent
+   */
+  template <typename Departed>
+  float ServeHead (uint32_t queue, float budget, Departed&& departed)
+  {
+    if (m_length[queue] == 0)
+    {
+      return 0.0f;
+    }
+    Packet& packet = m_packets[Offset (queue) + m_head[queue]];
+    float sent = std::min (packet.remaining, budget);
+    if (packet.remaining <= sent)
+    {
+      departed (packet.arrival);
+      Pop (queue);
+    }
+    else
+    {
+      packet.remaining -= sent;
+      m_backlog[queue] -= sent;
+    }
+    return sent;
+  }
+
+  /**
+   * \brief Serve packets in order until the budget runs out, the last one
+   *        partially
+   * \param queue The queue
+   * \param budget The amount that can be sent
+   * \return the amount sent, at most the backlog
+   */
+  float Serve (uint32_t queue, float budget)
+  {
+    return Serve (queue, budget, [] (uint32_t) {});
+  }
+
+  /**
+   * \brief Serve, calling departed (arrival slot) for every completed
+   *        packet, e.g. to record its queueing delay
+   * \param queue The queue
+   * \param budget The amount that can be sent
+   * \param departed Called with the arrival slot of each completed packet
+   * \return the amount sent
+   */
+  template <typename Departed>
+  float Serve (uint32_t queue, float budget, Departed&& departed)
+  {
+    float sent = 0.0f;
+    while (m_length[queue] > 0 && sent < budget)
+    {
+      sent += ServeHead (queue, budget - sent, departed);
+    }
+    return sent;
+  }
+
+  /// \return the packets in a queue
+  uint32_t GetLength (uint32_t queue) const
+  {
+    return m_length[queue];
+  }
+
+  /// \return the size still to send in a queue
+  double GetBacklog (uint32_t queue) const
+  {
+    return m_length[queue] > 0 ? m_backlog[queue] : 0.0;
+  }
+
+  /**
+   * \brief Head-of-line delay
+   * \param queue The queue
+   * \param slot The current slot
+   * \return slots waited by the head packet, 0 if the queue is empty
+   */
+  uint32_t GetHolDelay (uint32_t queue, uint32_t slot) const
+  {
+    return m_length[queue] > 0 ? slot - m_packets[Offset (queue) + m_head[queue]].arrival : 0;
+  }
+
+  /// \return the packets tail-dropped from a queue since it was cleared
+  uint64_t GetDrops (uint32_t queue) const
+  {
+    return m_drops[queue];
+  }
+
+  /**
+   * \brief Move the arrival slot of every queued packet later
+   *
+   * Used to rebase queues restored at a later time, so their delays keep
+   * counting from the time of the snapshot.
+   *
+   * \param delta Slots to add
+   */
+  void ShiftArrivals (uint32_t delta)
+  {
+    for (uint32_t queue = 0; queue < m_length.size (); ++queue)
+    {
+      Packet* ring = &m_packets[Offset (queue)];
+      uint32_t index = m_head[queue];
+      for (uint32_t i = 0; i < m_length[queue]; ++i)
+      {
+        ring[index].arrival += delta;
+        index = index + 1 >= m_capacity ? 0 : index + 1;
+      }
+    }
+  }
+
+  /// Empty a queue and reset its drop count
+  void Clear (uint32_t queue)
+  {
+    m_head[queue] = 0;
+    m_length[queue] = 0;
+    m_backlog[queue] = 0.0;
+    m_drops[queue] = 0;
+  }
+
+  /// Empty every queue
+  void ClearAll (void)
+  {
+    std::fill (m_head.begin (), m_head.end (), 0);
+    std::fill (m_length.begin (), m_length.end (), 0);
+    std::fill (m_backlog.begin (), m_backlog.end (), 0.0);
+    std::fill (m_drops.begin (), m_drops.end (), 0);
+  }
+
+private:
+  /// One queued packet
+  struct Packet
+  {
+    uint32_t arrival = 0;   ///< Arrival slot
+    float remaining = 0;    ///< Size left to send
+  };
+
+  std::size_t Offset (uint32_t queue) const
+  {
+    return static_cast<std::size_t> (queue) * m_capacity;
+  }
+
+  void Pop (uint32_t queue)
+  {
+    uint32_t head = m_head[queue];
+    m_backlog[queue] -= m_packets[Offset (queue) + head].remaining;
+    m_head[queue] = head + 1 >= m_capacity ? 0 : head + 1;
+    m_length[queue]--;
+  }
+
+  uint32_t m_capacity;              ///< Packets per queue
+  std::vector<Packet> m_packets;    ///< numQueues x capacity rings
+  std::vector<uint32_t> m_head;     ///< Ring index of the head packet
+  std::vector<uint32_t> m_length;   ///< Packets queued
+  std::vector<double> m_backlog;    ///< Size queued
+  std::vector<uint64_t> m_drops;    ///< Tail drops
+};
+
+} // namespace ns3
+
+#endif /* NR_U_PACKET_QUEUE_POOL_H */
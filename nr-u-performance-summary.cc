@@ -0,0 +1,317 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-performance-summary.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+namespace {
+
+const char* const COLUMNS[] = {
+  "Algorithm", "Arrival Rate", "Windows", "Stable Windows",
+  "Avg HoL Delay", "Avg HoL Delay CI95", "Delay Improvement %",
+  "Total Throughput", "Total Throughput CI95", "Throughput Improvement %",
+  "Dropped", "Dropped CI95",
+  "Avg HoL Delay EMA", "Avg HoL Delay Rolling", "Total Throughput EMA", "Total Throughput Rolling"
+};
+const std::size_t NUM_COLUMNS = sizeof (COLUMNS) / sizeof (COLUMNS[0]);
+/// Leading columns a table must have; tables written before the EMA and
+/// rolling columns still load
+const std::size_t NUM_REQUIRED_COLUMNS = 12;
+
+std::vector<std::string>
+SplitCsv (const std::string& line)
+{
+  std::vector<std::string> fields;
+  std::stringstream ss (line);
+  std::string field;
+  while (std::getline (ss, field, ','))
+  {
+    fields.push_back (field);
+  }
+  return fields;
+}
+
+/// Rates written with 12 digits and read back compare equal to the original
+bool
+SameRate (double a, double b)
+{
+  return std::fabs (a - b) <= 1e-9 * std::max (std::fabs (a), std::fabs (b));
+}
+
+bool
+IsBaseline (const std::string& algorithm)
+{
+  std::string lower = algorithm;
+  std::transform (lower.begin (), lower.end (), lower.begin (), ::tolower);
+  return lower == "baseline";
+}
+
+std::string
+FormatImprovement (bool valid, double percent)
+{
+  if (!valid)
+  {
+    return "-";
+  }
+  char text[32];
+  std::snprintf (text, sizeof (text), "%.2f%%", percent);
+  return text;
+}
+
+/// \return the cells of a row in COLUMNS order
+std::vector<std::string>
+FormatRow (const NrUPerformanceSummary::Row& row, const NrUPerformanceSummary::Row* baseline,
+           int precision)
+{
+  auto number = [precision] (double value)
+  {
+    std::ostringstream os;
+    os.precision (precision);
+    os << value;
+    return os.str ();
+  };
+  bool compare = baseline != nullptr && baseline != &row;
+  bool delayValid = compare && baseline->holDelay != 0;
+  bool throughputValid = compare && baseline->throughput != 0;
+  return {
+    row.algorithm, number (row.arrivalRate), std::to_string (row.windows),
+    std::to_string (row.stableWindows),
+    number (row.holDelay), number (row.holDelayCi95),
+    FormatImprovement (delayValid,
+                       delayValid ? (baseline->holDelay - row.holDelay) / baseline->holDelay * 100 : 0),
+    number (row.throughput), number (row.throughputCi95),
+    FormatImprovement (throughputValid,
+                       throughputValid ? (row.throughput - baseline->throughput) / baseline->throughput * 100 : 0),
+    number (row.dropped), number (row.droppedCi95),
+    number (row.holDelayEma), number (row.holDelayRolling),
+    number (row.throughputEma), number (row.throughputRolling)
+  };
+}
+
+} // anonymous namespace
+
+bool
+NrUPerformanceSummary::Load (const std::string& path)
+{
+  m_rows.clear ();
+  std::ifstream file (path);
+  if (!file)
+  {
+    return true;
+  }
+  std::string line;
+  if (!std::getline (file, line))
+  {
+    return true;
+  }
+  std::map<std::string, std::size_t> index;
+  std::vector<std::string> header = SplitCsv (line);
+  for (std::size_t c = 0; c < header.size (); ++c)
+  {
+    index[header[c]] = c;
+  }
+  for (std::size_t c = 0; c < NUM_REQUIRED_COLUMNS; ++c)
+  {
+    if (index.find (COLUMNS[c]) == index.end ())
+    {
+      return false;
+    }
+  }
+
+  while (std::getline (file, line))
+  {
+    std::vector<std::string> fields = SplitCsv (line);
+    if (fields.size () < header.size ())
+    {
+      continue;
+    }
+    auto get = [&fields, &index] (const char* column) { return fields[index[column]]; };
+    auto optional = [&fields, &index] (const char* column)
+    {
+      auto it = index.find (column);
+      return it == index.end () ? std::nan ("") : std::stod (fields[it->second]);
+    };
+    Row row;
+    try
+    {
+      row.algorithm = get ("Algorithm");
+      row.arrivalRate = std::stod (get ("Arrival Rate"));
+      row.windows = std::stoull (get ("Windows"));
+      row.stableWindows = std::stoull (get ("Stable Windows"));
+      row.holDelay = std::stod (get ("Avg HoL Delay"));
+      row.holDelayCi95 = std::stod (get ("Avg HoL Delay CI95"));
+      row.throughput = std::stod (get ("Total Throughput"));
+      row.throughputCi95 = std::stod (get ("Total Throughput CI95"));
+      row.dropped = std::stod (get ("Dropped"));
+      row.droppedCi95 = std::stod (get ("Dropped CI95"));
+      row.holDelayEma = optional ("Avg HoL Delay EMA");
+      row.holDelayRolling = optional ("Avg HoL Delay Rolling");
+      row.throughputEma = optional ("Total Throughput EMA");
+      row.throughputRolling = optional ("Total Throughput Rolling");
+    }
+    catch (const std::exception&)
+    {
+      return false;
+    }
+    m_rows.push_back (row);
+  }
+  return true;
+}
+
+void
+NrUPerformanceSummary::SetRow (const Row& row)
+{
+  for (Row& existing : m_rows)
+  {
+    if (existing.algorithm == row.algorithm && SameRate (existing.arrivalRate, row.arrivalRate))
+    {
+      existing = row;
+      return;
+    }
+  }
+  m_rows.push_back (row);
+  // Rates in increasing order, the baseline first within a rate
+  std::stable_sort (m_rows.begin (), m_rows.end (), [] (const Row& a, const Row& b)
+  {
+    if (!SameRate (a.arrivalRate, b.arrivalRate))
+    {
+      return a.arrivalRate < b.arrivalRate;
+    }
+    return IsBaseline (a.algorithm) && !IsBaseline (b.algorithm);
+  });
+}
+
+const std::vector<NrUPerformanceSummary::Row>&
+NrUPerformanceSummary::GetRows (void) const
+{
+  return m_rows;
+}
+
+const NrUPerformanceSummary::Row*
+NrUPerformanceSummary::FindBaseline (const Row& row) const
+{
+  for (const Row& candidate : m_rows)
+  {
+    if (IsBaseline (candidate.algorithm) && SameRate (candidate.arrivalRate, row.arrivalRate))
+    {
+      return &candidate;
+    }
+  }
+  return nullptr;
+}
+
+bool
+NrUPerformanceSummary::Write (const std::string& path) const
+{
+  // Written aside and renamed, so a reader never sees half a table
+  std::string tmp = path + ".tmp";
+  std::ofstream csv (tmp);
+  for (std::size_t c = 0; c < NUM_COLUMNS; ++c)
+  {
+    csv << (c ? "," : "") << COLUMNS[c];
+  }
+  csv << "\n";
+  for (const Row& row : m_rows)
+  {
+    std::vector<std::string> cells = FormatRow (row, FindBaseline (row), 12);
+    for (std::size_t c = 0; c < cells.size (); ++c)
+    {
+      csv << (c ? "," : "") << cells[c];
+    }
+    csv << "\n";
+  }
+  csv.close ();
+  if (!csv || std::rename (tmp.c_str (), path.c_str ()) != 0)
+  {
+    return false;
+  }
+
+  std::string mdPath = path;
+  std::size_t dot = mdPath.find_last_of ('.');
+  if (dot != std::string::npos && mdPath.find ('/', dot) == std::string::npos)
+  {
+    mdPath.erase (dot);
+  }
+  mdPath += ".md";
+  std::ofstream md (mdPath);
+  md << "|";
+  for (const char* column : COLUMNS)
+  {
+    md << " " << column << " |";
+  }
+  md << "\n|";
+  for (std::size_t c = 0; c < NUM_COLUMNS; ++c)
+  {
+    md << ":---|";
+  }
+  md << "\n";
+  for (const Row& row : m_rows)
+  {
+    md << "|";
+    for (const std::string& cell : FormatRow (row, FindBaseline (row), 6))
+    {
+      md << " " << cell << " |";
+    }
+    md << "\n";
+  }
+  return static_cast<bool> (md);
+}
+
+bool
+NrUPerformanceSummary::Update (const std::string& path, const Row& row)
+{
+  if (row.algorithm.empty () || row.algorithm.find_first_of (",\n") != std::string::npos)
+  {
+    return false;
+  }
+  int lock = open ((path + ".lock").c_str (), O_RDWR | O_CREAT, 0644);
+  if (lock < 0 || flock (lock, LOCK_EX) != 0)
+  {
+    if (lock >= 0)
+    {
+      close (lock);
+    }
+    return false;
+  }
+  NrUPerformanceSummary summary;
+  bool ok = summary.Load (path);
+  if (ok)
+  {
+    summary.SetRow (row);
+    ok = summary.Write (path);
+  }
+  flock (lock, LOCK_UN);
+  close (lock);
+  return ok;
+}
+
+} // namespace ns3
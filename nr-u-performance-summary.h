@@ -0,0 +1,89 @@
+#ifndef NR_U_PERFORMANCE_SUMMARY_H
+#define NR_U_PERFORMANCE_SUMMARY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief The performance_summary table of parse_ns3_logs.py, kept across runs
+ *
+ * One row per algorithm and arrival rate with the stable-period means of
+ * the HoL delay, throughput and drops per window and their 95% confidence
+ * intervals, and the end-of-run EMA and rolling mean of the delay and
+ * throughput. Every run merges its own row into the table file, replacing
+ * an earlier row of the same algorithm and rate, so running Baseline, LCA
+ * and RLA one after the other leaves the full comparison. Improvements are
+ * computed against the "Baseline" row of the same rate, if there is one.
+ * Rates match within a relative 1e-9, so a rate read back from the table
+ * matches the value it was written from.
+ *
+ * The table is written as CSV and, next to it with the .md extension, as
+ * markdown.
+ */
+class NrUPerformanceSummary
+{
+public:
+  /// Results of one algorithm at one arrival rate
+  struct Row
+  {
+    std::string algorithm;        ///< Label, without commas
+    double arrivalRate;           ///< Packets per UE and slot, 0 if unknown
+    uint64_t windows;             ///< Decision windows of the run
+    uint64_t stableWindows;       ///< Windows of the stable period
+    double holDelay;              ///< Mean HoL delay per window
+    double holDelayCi95;          ///< Half-width of its 95% confidence interval
+    double throughput;            ///< Mean total throughput per window
+    double throughputCi95;        ///< Half-width of its 95% confidence interval
+    double dropped;               ///< Mean packets dropped per window
+    double droppedCi95;           ///< Half-width of its 95% confidence interval
+    double holDelayEma;           ///< HoL delay EMA at the end of the run
+    double holDelayRolling;       ///< HoL delay rolling mean at the end of the run
+    double throughputEma;         ///< Throughput EMA at the end of the run
+    double throughputRolling;     ///< Throughput rolling mean at the end of the run
+  };
+
+  /**
+   * \brief Read a table written by Write
+   * \param path The CSV file; a missing file reads as an empty table, and
+   *        the EMA and rolling columns may be missing (read as NaN)
+   * \return false if the file exists but is not such a table
+   */
+  bool Load (const std::string& path);
+
+  /// Add a row, replacing the row of the same algorithm and rate
+  void SetRow (const Row& row);
+
+  const std::vector<Row>& GetRows (void) const;
+
+  /**
+   * \brief Write the table as CSV and markdown
+   * \param path The CSV file; the markdown goes to the same path with .md
+   * \return false if a file cannot be written
+   */
+  bool Write (const std::string& path) const;
+
+  /**
+   * \brief Merge a row into the table file
+   *
+   * The file is locked for the read-modify-write, so runs finishing at the
+   * same time do not lose each other's rows.
+   *
+   * \param path The CSV file
+   * \param row The row
+   * \return false if the label has a comma, or the table cannot be read or written
+   */
+  static bool Update (const std::string& path, const Row& row);
+
+private:
+  /// \return the Baseline row at the rate of row, or nullptr
+  const Row* FindBaseline (const Row& row) const;
+
+  std::vector<Row> m_rows;
+};
+
+} // namespace ns3
+
+#endif /* NR_U_PERFORMANCE_SUMMARY_H */
@@ -1,12 +1,30 @@
 #include "nr-u-phy.h"
+#include "nr-u-tbs-table.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
 #include "ns3/double.h"
+#include "ns3/nr-u-trace-ring.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("NrUPhy");
 NS_OBJECT_ENSURE_REGISTERED (NrUPhy);
 
+/// Key of the transmit PSD cache: (txPower, numRbs, scs)
+typedef std::tuple<double, uint16_t, double> TxPsdKey;
+/// Transmit PSDs shared by every NrUPhy, see NrUPhy::GetTxPsd
+static std::map<TxPsdKey, Ptr<const SpectrumValue>> s_txPsdCache;
+/// Number of NrUPhy instances holding PSDs of s_txPsdCache
+static uint32_t s_txPsdUsers = 0;
+/// Guards s_txPsdCache, s_txPsdUsers and the reference counts of the PSDs
+static std::mutex s_txPsdMutex;
+
 TypeId
 NrUPhy::GetTypeId (void)
 {
@@ -17,11 +35,56 @@ NrUPhy::GetTypeId (void)
                   "Transmission power in dBm",
                   DoubleValue (30.0),
                   MakeDoubleAccessor (&NrUPhy::m_txPower),
-                  MakeDoubleChecker<double> ());
+                  MakeDoubleChecker<double> ())
+    .AddAttribute ("MaxScheduledUes",
+                  "Maximum number of UEs scheduled per slot and BWP",
+                  UintegerValue (16),
+                  MakeUintegerAccessor (&NrUPhy::m_maxScheduledUes),
+                  MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PfEmaWeight",
+                  "Weight of the current slot in the proportional-fair average throughput",
+                  DoubleValue (0.05),
+                  MakeDoubleAccessor (&NrUPhy::m_pfEmaWeight),
+                  MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("FullBuffer",
+                  "Every UE always has data, so allocations are not limited by the queues",
+                  BooleanValue (true),
+                  MakeBooleanAccessor (&NrUPhy::m_fullBuffer),
+                  MakeBooleanChecker ())
+    .AddAttribute ("MaxQueueSize",
+                  "Packets per UE queue; arrivals beyond it are tail-dropped",
+                  UintegerValue (200),
+                  MakeUintegerAccessor (&NrUPhy::m_maxQueueSize),
+                  MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("SlotDuration",
+                  "Slot length used to stamp arrivals and count HoL delays",
+                  TimeValue (MicroSeconds (500)),
+                  MakeTimeAccessor (&NrUPhy::m_slotDuration),
+                  MakeTimeChecker ())
+    .AddAttribute ("PerUeDelayHistograms",
+                  "Keep a queueing delay histogram per UE (832 bytes each) besides the per-BWP ones",
+                  BooleanValue (true),
+                  MakeBooleanAccessor (&NrUPhy::m_perUeDelayHistograms),
+                  MakeBooleanChecker ())
+    .AddTraceSource ("SlotAllocation",
+                     "Resources of a BWP have been allocated for a slot",
+                     MakeTraceSourceAccessor (&NrUPhy::m_slotAllocationTrace),
+                     "ns3::NrUPhy::SlotAllocationTracedCallback");
   return tid;
 }
 
-NrUPhy::NrUPhy () : m_txPower (30.0)
+NrUPhy::NrUPhy ()
+  : m_txPower (30.0),
+    m_maxScheduledUes (16),
+    m_pfEmaWeight (0.05),
+    m_numCqiRows (0),
+    m_cqiStride (0),
+    m_fullBuffer (true),
+    m_maxQueueSize (200),
+    m_slotDuration (MicroSeconds (500)),
+    m_queues (0, 200),
+    m_perUeDelayHistograms (true),
+    m_txPsdUser (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -31,30 +94,105 @@ NrUPhy::ConfigureBwp (uint16_t bwpId, uint16_t numerology, double scs, uint16_t
 {
   NS_LOG_FUNCTION (this << bwpId << numerology << scs << rbs);
   
-  if (bwpId >= m_bwpConfigs.size ())
   {
-    m_bwpConfigs.resize (bwpId + 1);
+    // Resizing copies the PSD pointers, whose reference counts are not atomic
+    std::lock_guard<std::mutex> lock (s_txPsdMutex);
+    if (bwpId >= m_bwpConfigs.size ())
+    {
+      m_bwpConfigs.resize (bwpId + 1);
+      m_bwpQueueingDelay.resize (bwpId + 1);
+    }
+ 
+    m_bwpConfigs[bwpId] = {
+      .numerology = numerology,
+      .subcarrierSpacing = scs,
+      .numRbs = rbs,
+      .txPower = GetTxPsd (m_txPower, rbs, scs),
+      .avgBitsPerRb = 0.0
+    };
+  }
+
+  if (rbs > m_cqiStride)
+  {
+    ResizeCqiRows (rbs);
   }
+}
 
-  m_bwpConfigs[bwpId] = {
-    .numerology = numerology,
-    .subcarrierSpacing = scs,
-    .numRbs = rbs,
-    .txPower = NrSpectrumValueHelper::CreateTxPowerSpectralDensity (m_txPower, rbs, scs)
-  };
+Ptr<const SpectrumValue>
+NrUPhy::GetTxPsd (double txPower, uint16_t numRbs, double scs)
+{
+  if (!m_txPsdUser)
+  {
+    m_txPsdUser = true;
+    s_txPsdUsers++;
+  }
+ 
+  TxPsdKey key (txPower, numRbs, scs);
+  auto it = s_txPsdCache.find (key);
+  if (it == s_txPsdCache.end ())
+  {
+    NS_LOG_LOGIC ("Creating TX PSD for " << txPower << " dBm, " << numRbs << " RBs, " << scs << " Hz");
+    Ptr<const SpectrumValue> psd =
+      NrSpectrumValueHelper::CreateTxPowerSpectralDensity (txPower, numRbs, scs);
+    it = s_txPsdCache.emplace (key, psd).first;
+  }
+  return it->second;
+}
+
+void
+NrUPhy::ResizeCqiRows (uint16_t stride)
+{
+  NS_LOG_FUNCTION (this << stride);
+
+  std::vector<float> matrix (static_cast<size_t> (m_numCqiRows) * stride, 0.0f);
+  for (uint32_t row = 0; row < m_numCqiRows; ++row)
+  {
+    std::copy_n (m_cqiMatrix.begin () + static_cast<size_t> (row) * m_cqiStride,
+                 m_cqiStride,
+                 matrix.begin () + static_cast<size_t> (row) * stride);
+  }
+  m_cqiMatrix.swap (matrix);
+  m_cqiStride = stride;
 }
 
 void
 NrUPhy::UpdateChannelQuality (uint16_t rnti, const std::vector<double>& cqi)
 {
   NS_LOG_FUNCTION (this << rnti);
-  m_cqiMap[rnti] = cqi;
+
+  // Rows are indexed by RB with a 16-bit stride, like the BWP sizes
+  NS_ABORT_MSG_IF (cqi.size () > std::numeric_limits<uint16_t>::max (),
+                   "CQI report of RNTI " << rnti << " has " << cqi.size () << " entries, more than "
+                   << std::numeric_limits<uint16_t>::max () << " RBs");
+  if (cqi.size () > m_cqiStride)
+  {
+    ResizeCqiRows (cqi.size ());
+  }
+
+  if (rnti >= m_cqiRow.size ())
+  {
+    m_cqiRow.resize (rnti + 1, NO_CQI_ROW);
+  }
+  if (m_cqiRow[rnti] == NO_CQI_ROW)
+  {
+    m_cqiRow[rnti] = m_numCqiRows++;
+    m_cqiMatrix.resize (static_cast<size_t> (m_numCqiRows) * m_cqiStride, 0.0f);
+    m_widebandCqi.resize (m_numCqiRows, 0.0f);
+    m_avgThroughput.resize (m_numCqiRows, 1.0f);
+    m_avgBitsPerRb.resize (m_numCqiRows, 0.0f);
+  }
+
+  uint32_t rowIdx = m_cqiRow[rnti];
+  float* row = m_cqiMatrix.data () + static_cast<size_t> (rowIdx) * m_cqiStride;
+  std::copy (cqi.begin (), cqi.end (), row);
+  std::fill (row + cqi.size (), row + m_cqiStride, 0.0f);
+  m_widebandCqi[rowIdx] = cqi.empty () ? 0.0f
+                          : std::accumulate (row, row + cqi.size (), 0.0f) / cqi.size ();
 }
 
 std::vector<uint16_t>
 NrUPhy::AllocateResources (uint16_t bwpId, const std::vector<uint16_t>& ues)
 {
-  NS_LOG_FUNCTION (this << bwpId);
   std::vector<uint16_t> allocatedRbs;
 
   if (bwpId >= m_bwpConfigs.size () || m_bwpConfigs[bwpId].numRbs == 0)
@@ -63,27 +201,287 @@ NrUPhy::AllocateResources (uint16_t bwpId, const std::vector<uint16_t>& ues)
     return allocatedRbs;
   }
 
-  // Simple round-robin allocation (replace with PF scheduler in real implementation)
-  uint16_t rbPerUe = m_bwpConfigs[bwpId].numRbs / std::max(1, (int)ues.size());
+  uint16_t numRbs = m_bwpConfigs[bwpId].numRbs;
+  allocatedRbs.assign (numRbs, 0);
+
+  // Gather the candidates that reported CQI and their wideband PF metric
+  // into contiguous arrays
+  m_candRow.clear ();
+  m_candRnti.clear ();
   for (uint16_t ue : ues)
   {
-    if (m_cqiMap.find(ue) != m_cqiMap.end())
+    if (ue < m_cqiRow.size () && m_cqiRow[ue] != NO_CQI_ROW)
     {
-      // Allocate best RBs based on CQI (simplified)
-      for (uint16_t rb = 0; rb < rbPerUe; ++rb)
+      m_candRow.push_back (m_cqiRow[ue]);
+      m_candRnti.push_back (ue);
+    }
+  }
+  uint32_t numCand = m_candRow.size ();
+  if (numCand == 0)
+  {
+    return allocatedRbs;
+  }
+
+  m_candInvAvg.resize (numCand);
+  m_candMetric.resize (numCand);
+  const uint32_t* candRow = m_candRow.data ();
+  float* invAvg = m_candInvAvg.data ();
+  float* metric = m_candMetric.data ();
+  for (uint32_t i = 0; i < numCand; ++i)
+  {
+    invAvg[i] = 1.0f / (m_avgThroughput[candRow[i]] + 1e-5f);
+    metric[i] = m_widebandCqi[candRow[i]] * invAvg[i];
+  }
+
+  // Partial selection of the best MaxScheduledUes candidates, linear in
+  // the number of candidates instead of a full sort
+  uint32_t numScheduled = std::min (m_maxScheduledUes, numCand);
+  m_candOrder.resize (numCand);
+  std::iota (m_candOrder.begin (), m_candOrder.end (), 0);
+  if (numScheduled < numCand)
+  {
+    std::nth_element (m_candOrder.begin (), m_candOrder.begin () + numScheduled,
+                      m_candOrder.end (),
+                      [metric] (uint32_t a, uint32_t b) { return metric[a] > metric[b]; });
+  }
+
+  // Per-RB PF argmax over the selected rows: each row is compared against
+  // the best metric seen so far on every RB, a branch-free select over
+  // contiguous floats that vectorizes across RBs
+  m_bestMetric.assign (numRbs, 0.0f);
+  m_bestCand.assign (numRbs, numCand);
+  float* bestMetric = m_bestMetric.data ();
+  uint32_t* bestCand = m_bestCand.data ();
+  for (uint32_t s = 0; s < numScheduled; ++s)
+  {
+    uint32_t cand = m_candOrder[s];
+    const float* cqi = m_cqiMatrix.data () + static_cast<size_t> (candRow[cand]) * m_cqiStride;
+    float weight = invAvg[cand];
+    for (uint16_t rb = 0; rb < numRbs; ++rb)
+    {
+      float pf = cqi[rb] * weight;
+      bool better = pf > bestMetric[rb];
+      bestMetric[rb] = better ? pf : bestMetric[rb];
+      bestCand[rb] = better ? cand : bestCand[rb];
+    }
+  }
+
+  // Hand out the RBs, then turn each UE's share into a TBS at the mean CQI
+  // of its RBs with a table lookup
+  m_candCqiSum.assign (numCand, 0.0f);
+  m_candRbs.assign (numCand, 0);
+  for (uint16_t rb = 0; rb < numRbs; ++rb)
+  {
+    uint32_t cand = bestCand[rb];
+    if (cand < numCand)
+    {
+      allocatedRbs[rb] = m_candRnti[cand];
+      m_candCqiSum[cand] += m_cqiMatrix[static_cast<size_t> (candRow[cand]) * m_cqiStride + rb];
+      m_candRbs[cand]++;
+    }
+  }
+
+  // PF average update for every candidate, unscheduled ones served nothing
+  float weight = m_pfEmaWeight;
+  uint32_t slot = GetCurrentSlot ();
+  int64_t now = Simulator::Now ().GetNanoSeconds ();
+  NrUDelayHistogram& bwpDelay = m_bwpQueueingDelay[bwpId];
+  uint64_t slotBits = 0;
+  uint64_t slotServed = 0;
+  uint32_t slotRbs = 0;
+  uint32_t slotUes = 0;
+  for (uint32_t i = 0; i < numCand; ++i)
+  {
+    uint32_t served = 0;
+    if (m_candRbs[i] > 0)
+    {
+      uint8_t cqi = NrUTbsTable::ToCqiIndex (m_candCqiSum[i] / m_candRbs[i]);
+      uint32_t tbs = NrUTbsTable::GetTbs (cqi, m_candRbs[i]);
+      float& ueBitsPerRb = m_avgBitsPerRb[candRow[i]];
+      ueBitsPerRb = 0.9f * ueBitsPerRb + 0.1f * tbs / m_candRbs[i];
+      slotBits += tbs;
+      slotRbs += m_candRbs[i];
+      // Bits per RB rate the channel; the throughput only counts queued data
+      served = tbs;
+      uint16_t rnti = m_candRnti[i];
+      if (!m_fullBuffer)
       {
-        allocatedRbs.push_back(rb);
+        NrUDelayHistogram* ueDelay = rnti < m_ueQueueingDelay.size () ? &m_ueQueueingDelay[rnti] : nullptr;
+        auto departed = [&] (uint32_t arrival)
+        {
+          uint32_t delay = slot - arrival;
+          bwpDelay.Record (delay);
+          m_recentQueueingDelay.Record (delay);
+          if (ueDelay)
+          {
+            ueDelay->Record (delay);
+          }
+        };
+        served = rnti < m_queues.GetNumQueues () ? m_queues.Serve (rnti, tbs, departed) : 0;
       }
+      slotServed += served;
+      slotUes++;
+      NrUTraceRing::Write (NrUTraceRing::ALLOCATION, now, bwpId, rnti, m_candRbs[i], served);
     }
+    float& avg = m_avgThroughput[candRow[i]];
+    avg = (1.0f - weight) * avg + weight * served;
   }
+  if (slotRbs > 0)
+  {
+    double& bwpBitsPerRb = m_bwpConfigs[bwpId].avgBitsPerRb;
+    bwpBitsPerRb = 0.9 * bwpBitsPerRb + 0.1 * static_cast<double> (slotBits) / slotRbs;
+  }
+  m_slotAllocationTrace (bwpId, slotUes, slotServed, slotRbs);
 
   return allocatedRbs;
 }
 
+double
+NrUPhy::GetAvgBitsPerRb (uint16_t bwpId) const
+{
+  if (bwpId < m_bwpConfigs.size ())
+  {
+    return m_bwpConfigs[bwpId].avgBitsPerRb;
+  }
+  return 0.0;
+}
+
+double
+NrUPhy::GetUeAvgBitsPerRb (uint16_t rnti) const
+{
+  if (rnti < m_cqiRow.size () && m_cqiRow[rnti] != NO_CQI_ROW)
+  {
+    return m_avgBitsPerRb[m_cqiRow[rnti]];
+  }
+  return 0.0;
+}
+
+bool
+NrUPhy::EnqueuePacket (uint16_t rnti, uint32_t bits)
+{
+  if (rnti >= m_queues.GetNumQueues ())
+  {
+    // Rings are added once per new RNTI, never per packet
+    m_queues.Resize (rnti + 1);
+    if (m_perUeDelayHistograms)
+    {
+      m_ueQueueingDelay.resize (rnti + 1);
+    }
+  }
+  if (!m_queues.Enqueue (rnti, GetCurrentSlot (), bits))
+  {
+    NS_LOG_LOGIC ("Queue of UE " << rnti << " full, packet dropped");
+    return false;
+  }
+  return true;
+}
+
+uint32_t
+NrUPhy::GetQueueSize (uint16_t rnti) const
+{
+  return rnti < m_queues.GetNumQueues () ? m_queues.GetLength (rnti) : 0;
+}
+
+double
+NrUPhy::GetHolDelay (uint16_t rnti) const
+{
+  return rnti < m_queues.GetNumQueues () ? m_queues.GetHolDelay (rnti, GetCurrentSlot ()) : 0.0;
+}
+
+double
+NrUPhy::GetThroughput (uint16_t rnti) const
+{
+  if (rnti < m_cqiRow.size () && m_cqiRow[rnti] != NO_CQI_ROW)
+  {
+    return m_avgThroughput[m_cqiRow[rnti]];
+  }
+  return 0.0;
+}
+
+uint64_t
+NrUPhy::GetDroppedPackets (uint16_t rnti) const
+{
+  return rnti < m_queues.GetNumQueues () ? m_queues.GetDrops (rnti) : 0;
+}
+
+const NrUDelayHistogram&
+NrUPhy::GetQueueingDelayHistogram (uint16_t rnti) const
+{
+  static const NrUDelayHistogram empty;
+  return rnti < m_ueQueueingDelay.size () ? m_ueQueueingDelay[rnti] : empty;
+}
+
+const NrUDelayHistogram&
+NrUPhy::GetBwpQueueingDelayHistogram (uint16_t bwpId) const
+{
+  static const NrUDelayHistogram empty;
+  return bwpId < m_bwpQueueingDelay.size () ? m_bwpQueueingDelay[bwpId] : empty;
+}
+
+void
+NrUPhy::CollectQueueingDelays (NrUDelayHistogram& histogram)
+{
+  histogram.Merge (m_recentQueueingDelay);
+  m_recentQueueingDelay.Reset ();
+}
+
+uint32_t
+NrUPhy::GetCurrentSlot (void) const
+{
+  return Simulator::Now ().GetInteger () / m_slotDuration.GetInteger ();
+}
+
+void
+NrUPhy::SaveState (Snapshot& snapshot) const
+{
+  NS_LOG_FUNCTION (this);
+  snapshot.bwpAvgBitsPerRb.resize (m_bwpConfigs.size ());
+  for (std::size_t i = 0; i < m_bwpConfigs.size (); ++i)
+  {
+    snapshot.bwpAvgBitsPerRb[i] = m_bwpConfigs[i].avgBitsPerRb;
+  }
+  snapshot.cqiMatrix = m_cqiMatrix;
+  snapshot.cqiRow = m_cqiRow;
+  snapshot.numCqiRows = m_numCqiRows;
+  snapshot.cqiStride = m_cqiStride;
+  snapshot.widebandCqi = m_widebandCqi;
+  snapshot.avgThroughput = m_avgThroughput;
+  snapshot.avgBitsPerRb = m_avgBitsPerRb;
+  snapshot.queues = m_queues;
+  snapshot.slot = GetCurrentSlot ();
+  snapshot.recentQueueingDelay = m_recentQueueingDelay;
+}
+
+void
+NrUPhy::RestoreState (const Snapshot& snapshot)
+{
+  NS_LOG_FUNCTION (this);
+  std::size_t numBwps = std::min (m_bwpConfigs.size (), snapshot.bwpAvgBitsPerRb.size ());
+  for (std::size_t i = 0; i < numBwps; ++i)
+  {
+    m_bwpConfigs[i].avgBitsPerRb = snapshot.bwpAvgBitsPerRb[i];
+  }
+  // Copy assignment keeps the capacity of our vectors, so restoring into a
+  // PHY of the same size does not allocate
+  m_cqiMatrix = snapshot.cqiMatrix;
+  m_cqiRow = snapshot.cqiRow;
+  m_numCqiRows = snapshot.numCqiRows;
+  m_cqiStride = snapshot.cqiStride;
+  m_widebandCqi = snapshot.widebandCqi;
+  m_avgThroughput = snapshot.avgThroughput;
+  m_avgBitsPerRb = snapshot.avgBitsPerRb;
+  m_queues = snapshot.queues;
+  // Arrival slots are absolute; rebased, the restored packets have waited
+  // as long as they had at the snapshot
+  m_queues.ShiftArrivals (GetCurrentSlot () - snapshot.slot);
+  m_recentQueueingDelay = snapshot.recentQueueingDelay;
+}
+
 void
 NrUPhy::DoInitialize ()
 {
   NS_LOG_FUNCTION (this);
+  m_queues.SetCapacity (m_maxQueueSize);
   NrPhy::DoInitialize ();
 }
 
@@ -91,8 +489,28 @@ void
 NrUPhy::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
-  m_bwpConfigs.clear ();
-  m_cqiMap.clear ();
+  {
+    std::lock_guard<std::mutex> lock (s_txPsdMutex);
+    m_bwpConfigs.clear ();
+    if (m_txPsdUser)
+    {
+      m_txPsdUser = false;
+      if (--s_txPsdUsers == 0)
+      {
+        NS_LOG_LOGIC ("Last PHY disposed, releasing " << s_txPsdCache.size () << " TX PSDs");
+        s_txPsdCache.clear ();
+      }
+    }
+  }
+  m_cqiMatrix.clear ();
+  m_cqiRow.clear ();
+  m_widebandCqi.clear ();
+  m_avgThroughput.clear ();
+  m_avgBitsPerRb.clear ();
+  m_queues.Resize (0);
+  m_ueQueueingDelay.clear ();
+  m_bwpQueueingDelay.clear ();
+  m_numCqiRows = 0;
   NrPhy::DoDispose ();
 }
 
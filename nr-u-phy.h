@@ -1,99 +1,271 @@
-//#include "nr-u-phy.h"
-#include "ns3/log.h"
-#include "ns3/double.h"
+#ifndef NR_U_PHY_H
+#define NR_U_PHY_H
 
-namespace ns3 {
+#include "ns3/nr-phy.h"
+#include "ns3/nr-spectrum-value-helper.h"
+#include "ns3/nr-u-delay-histogram.h"
+#include "ns3/nr-u-packet-queue-pool.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
-NS_LOG_COMPONENT_DEFINE ("NrUPhy");
-NS_OBJECT_ENSURE_REGISTERED (NrUPhy);
+namespace ns3 {
 
-TypeId
-NrUPhy::GetTypeId (void)
-{
-  static TypeId tid = TypeId ("ns3::NrUPhy")
-    .SetParent<NrPhy> ()
-    .AddConstructor<NrUPhy> ()
-    .AddAttribute ("TxPower",
-                  "Transmission power in dBm",
-                  DoubleValue (30.0),
-                  MakeDoubleAccessor (&NrUPhy::m_txPower),
-                  MakeDoubleChecker<double> ());
-  return tid;
-}
-
-NrUPhy::NrUPhy () : m_txPower (30.0)
+/**
+ * \brief NR-U PHY with per-BWP configuration and CQI-driven RB allocation
+ *
+ * Sub-band CQI reports are kept in one contiguous UE x RB matrix of floats
+ * (one row per RNTI), so allocation walks plain arrays instead of chasing
+ * a heap-allocated vector per UE.
+ *
+ * Unless FullBuffer is set, every UE has a FIFO packet queue (one ring of
+ * MaxQueueSize packets per RNTI in an NrUPacketQueuePool) fed through
+ * EnqueuePacket, and allocation serves at most the queued bits. The
+ * queueing delay of every packet served to completion (slots from arrival
+ * to its last bit) goes into per-UE and per-BWP delay histograms.
+ */
+class NrUPhy : public NrPhy
 {
-  NS_LOG_FUNCTION (this);
-}
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
 
-void
-NrUPhy::ConfigureBwp (uint16_t bwpId, uint16_t numerology, double scs, uint16_t rbs)
-{
-  NS_LOG_FUNCTION (this << bwpId << numerology << scs << rbs);
-  
-  if (bwpId >= m_bwpConfigs.size ())
-  {
-    m_bwpConfigs.resize (bwpId + 1);
-  }
-
-  m_bwpConfigs[bwpId] = {
-    .numerology = numerology,
-    .subcarrierSpacing = scs,
-    .numRbs = rbs,
-    .txPower = NrSpectrumValueHelper::CreateTxPowerSpectralDensity (m_txPower, rbs, scs)
+  NrUPhy ();
+
+  /**
+   * \brief Configure a BWP
+   * \param bwpId The BWP identifier
+   * \param numerology The NR numerology
+   * \param scs Subcarrier spacing in Hz
+   * \param rbs Number of RBs in the BWP
+   */
+  void ConfigureBwp (uint16_t bwpId, uint16_t numerology, double scs, uint16_t rbs);
+
+  /**
+   * \brief Store the sub-band CQI report of a UE
+   * \param cqi One CQI value per RB of the UE's BWP, at most 65535
+   * \param cqi One CQI value per RB of the UE's BWP
+   */
+  void UpdateChannelQuality (uint16_t rnti, const std::vector<double>& cqi);
+
+  /**
+   * \brief Proportional-fair, frequency-selective allocation of a BWP
+   *
+   * The MaxScheduledUes candidates with the highest wideband PF metric
+   * (mean CQI over average throughput) are selected, then every RB goes to
+   * the selected UE with the highest per-RB PF metric. The data served to
+   * each UE is the TBS of its RBs at their mean CQI (see NrUTbsTable), and
+   * average throughputs of all candidates are updated afterwards. UEs
+   * without a CQI report are skipped.
+   *
+   * \param bwpId The BWP identifier
+   * \param ues Candidate UE RNTIs
+   * \return the RNTI owning each RB of the BWP (0 when no UE can use the
+   *         RB), or an empty vector if the BWP is not configured
+   */
+  std::vector<uint16_t> AllocateResources (uint16_t bwpId, const std::vector<uint16_t>& ues);
+
+  /**
+   * \brief Average bits carried per allocated RB of a BWP
+   * \param bwpId The BWP identifier
+   * \return the moving average of bits per RB, 0 for an unknown BWP
+   */
+  double GetAvgBitsPerRb (uint16_t bwpId) const;
+
+  /**
+   * \brief Average bits carried per RB allocated to a UE
+   * \param rnti The UE RNTI
+   * \return the moving average of bits per RB, 0 for an unknown UE
+   */
+  double GetUeAvgBitsPerRb (uint16_t rnti) const;
+
+  /**
+   * \brief Queue a packet for a UE, tail-dropping it if the queue is full
+   * \param rnti The UE RNTI
+   * \param bits The packet size in bits
+   * \return false if the packet was dropped
+   */
+  bool EnqueuePacket (uint16_t rnti, uint32_t bits);
+
+  /**
+   * \brief Packets queued for a UE
+   * \param rnti The UE RNTI
+   * \return the queue length, 0 for an unknown UE
+   */
+  uint32_t GetQueueSize (uint16_t rnti) const;
+
+  /**
+   * \brief Head-of-line delay of a UE
+   * \param rnti The UE RNTI
+   * \return the slots (of SlotDuration) waited by the head packet, 0 if
+   *         the queue is empty
+   */
+  double GetHolDelay (uint16_t rnti) const;
+
+  /**
+   * \brief Proportional-fair average throughput of a UE
+   * \param rnti The UE RNTI
+   * \return the moving average of served bits per slot, 0 for an unknown UE
+   */
+  double GetThroughput (uint16_t rnti) const;
+
+  /**
+   * \brief Packets tail-dropped for a UE
+   * \param rnti The UE RNTI
+   * \return the number of drops, 0 for an unknown UE
+   */
+  uint64_t GetDroppedPackets (uint16_t rnti) const;
+
+  /**
+   * \brief Queueing delays of the packets served to a UE
+   * \param rnti The UE RNTI
+   * \return the histogram in slots, empty for an unknown UE or without
+   *         PerUeDelayHistograms
+   */
+  const NrUDelayHistogram& GetQueueingDelayHistogram (uint16_t rnti) const;
+
+  /**
+   * \brief Queueing delays of the packets served on a BWP
+   * \param bwpId The BWP identifier
+   * \return the histogram in slots, empty for an unknown BWP
+   */
+  const NrUDelayHistogram& GetBwpQueueingDelayHistogram (uint16_t bwpId) const;
+
+  /**
+   * \brief Hand over the queueing delays of all UEs since the last call
+   * \param histogram Merged with the delays, which are then forgotten here
+   */
+  void CollectQueueingDelays (NrUDelayHistogram& histogram);
+
+  /// CQI, PF and queue state saved by SaveState (the allocation scratch is not)
+  struct Snapshot {
+    std::vector<double> bwpAvgBitsPerRb;  ///< Per-BWP bits per RB average
+    std::vector<float> cqiMatrix;         ///< UE x RB CQI
+    std::vector<uint32_t> cqiRow;         ///< RNTI to CQI row
+    uint32_t numCqiRows;                  ///< Rows in use
+    uint16_t cqiStride;                   ///< RBs per row
+    std::vector<float> widebandCqi;       ///< Per-row mean CQI
+    std::vector<float> avgThroughput;     ///< Per-row PF average throughput
+    std::vector<float> avgBitsPerRb;      ///< Per-row bits per RB average
+    NrUPacketQueuePool queues;            ///< Per-RNTI packet queues
+    uint32_t slot;                        ///< Slot of the snapshot, arrivals are relative to it
+    NrUDelayHistogram recentQueueingDelay; ///< Delays not yet collected
   };
-}
 
-void
-NrUPhy::UpdateChannelQuality (uint16_t rnti, const std::vector<double>& cqi)
-{
-  NS_LOG_FUNCTION (this << rnti);
-  m_cqiMap[rnti] = cqi;
-}
+  /**
+   * \brief Save the CQI, PF and queue state
+   * \param snapshot The snapshot to fill, its storage is reused
+   */
+  void SaveState (Snapshot& snapshot) const;
 
-std::vector<uint16_t>
-NrUPhy::AllocateResources (uint16_t bwpId, const std::vector<uint16_t>& ues)
-{
-  NS_LOG_FUNCTION (this << bwpId);
-  std::vector<uint16_t> allocatedRbs;
-
-  if (bwpId >= m_bwpConfigs.size () || m_bwpConfigs[bwpId].numRbs == 0)
-  {
-    NS_LOG_WARN ("Invalid BWP ID or no RBs configured");
-    return allocatedRbs;
-  }
-
-  // Simple round-robin allocation (replace with PF scheduler in real implementation)
-  uint16_t rbPerUe = m_bwpConfigs[bwpId].numRbs / std::max(1, (int)ues.size());
-  for (uint16_t ue : ues)
-  {
-    if (m_cqiMap.find(ue) != m_cqiMap.end())
-    {
-      // Allocate best RBs based on CQI (simplified)
-      for (uint16_t rb = 0; rb < rbPerUe; ++rb)
-      {
-        allocatedRbs.push_back(rb);
-      }
-    }
-  }
-
-  return allocatedRbs;
-}
-
-void
-NrUPhy::DoInitialize ()
-{
-  NS_LOG_FUNCTION (this);
-  NrPhy::DoInitialize ();
-}
+  /**
+   * \brief Restore a saved state; BWP configurations are kept
+   * \param snapshot The snapshot to restore
+   */
+  void RestoreState (const Snapshot& snapshot);
 
-void
-NrUPhy::DoDispose ()
-{
-  NS_LOG_FUNCTION (this);
-  m_bwpConfigs.clear ();
-  m_cqiMap.clear ();
-  NrPhy::DoDispose ();
-}
+  /**
+   * TracedCallback signature for the allocation of a slot on a BWP.
+   * \param [in] bwpId The BWP
+   * \param [in] scheduledUes UEs given at least one RB
+   * \param [in] bits Bits served from the queues (the TBS with a full buffer)
+   * \param [in] rbs RBs allocated
+   */
+  typedef void (* SlotAllocationTracedCallback)(uint16_t bwpId, uint32_t scheduledUes,
+                                                 uint64_t bits, uint32_t rbs);
+
+protected:
+  virtual void DoInitialize (void);
+  virtual void DoDispose (void);
+
+private:
+  /// Per-BWP PHY configuration
+  struct BwpConfig {
+    uint16_t numerology;              ///< NR numerology
+    double subcarrierSpacing;         ///< Subcarrier spacing in Hz
+    uint16_t numRbs;                  ///< Number of RBs
+    Ptr<const SpectrumValue> txPower; ///< Transmit power spectral density (shared)
+    double avgBitsPerRb;              ///< Moving average of bits per allocated RB
+  };
+
+  /**
+   * \brief Get the transmit PSD of a configuration, creating it only once
+   *
+   * The PSD objects live in a cache shared by the BWPs of all the PHYs,
+   * so they must be treated as read-only. The caller holds the cache
+   * mutex. The cache keeps one entry per configuration ever requested
+   * and is emptied when the last PHY that used it is disposed.
+   *
+   * \param txPower Transmit power in dBm
+   * \param numRbs Number of RBs
+   * \param scs Subcarrier spacing in Hz
+   * \return the shared transmit PSD
+   */
+  Ptr<const SpectrumValue> GetTxPsd (double txPower, uint16_t numRbs, double scs);
+
+  /// Row index marking an RNTI without a CQI report
+  static constexpr uint32_t NO_CQI_ROW = UINT32_MAX;
+
+  /**
+   * \brief Widen the CQI matrix rows, keeping the stored reports
+   * \param stride The new number of RBs per row
+   */
+  void ResizeCqiRows (uint16_t stride);
+
+  /// \return the current slot, counted in SlotDuration since time 0
+  uint32_t GetCurrentSlot (void) const;
+
+  double m_txPower;                       ///< Transmit power in dBm
+  std::vector<BwpConfig> m_bwpConfigs;    ///< Per-BWP configuration
+
+  uint32_t m_maxScheduledUes;             ///< Max UEs scheduled per slot
+  double m_pfEmaWeight;                   ///< Weight of the last slot in the PF average
+
+  std::vector<float> m_cqiMatrix;         ///< UE x RB CQI, row-major
+  std::vector<uint32_t> m_cqiRow;         ///< RNTI to row of m_cqiMatrix
+  uint32_t m_numCqiRows;                  ///< Rows in use
+  uint16_t m_cqiStride;                   ///< RBs per row (widest BWP)
+
+  // Per-row PF state, indexed like the rows of m_cqiMatrix
+  std::vector<float> m_widebandCqi;       ///< Mean CQI of the last report
+  std::vector<float> m_avgThroughput;     ///< PF average throughput in bits per slot
+  std::vector<float> m_avgBitsPerRb;      ///< Moving average of bits per allocated RB
+
+  // Traffic model
+  bool m_fullBuffer;                      ///< Every UE always has data to send
+  uint32_t m_maxQueueSize;                ///< Packets per UE queue
+  Time m_slotDuration;                    ///< Unit of arrival slots and HoL delays
+  NrUPacketQueuePool m_queues;            ///< One queue per RNTI
+
+  // Queueing delay histograms, in slots
+  bool m_perUeDelayHistograms;            ///< Keep one histogram per RNTI
+  std::vector<NrUDelayHistogram> m_ueQueueingDelay;  ///< Per RNTI
+  std::vector<NrUDelayHistogram> m_bwpQueueingDelay; ///< Per BWP
+  NrUDelayHistogram m_recentQueueingDelay; ///< All UEs since CollectQueueingDelays
+
+  bool m_txPsdUser;                       ///< Whether this PHY is counted in the PSD cache users
+
+  /// Fired at the end of every AllocateResources call
+  TracedCallback<uint16_t, uint32_t, uint64_t, uint32_t> m_slotAllocationTrace;
+
+  // Allocation scratch, kept across slots to avoid reallocation
+  std::vector<uint32_t> m_candRow;        ///< Candidate rows
+  std::vector<uint16_t> m_candRnti;       ///< Candidate RNTIs
+  std::vector<float> m_candInvAvg;        ///< 1 / average throughput per candidate
+  std::vector<float> m_candMetric;        ///< Wideband PF metric per candidate
+  std::vector<float> m_candCqiSum;        ///< CQI summed over the RBs of a candidate
+  std::vector<uint16_t> m_candRbs;        ///< RBs allocated per candidate
+  std::vector<uint32_t> m_candOrder;      ///< Candidate indices, best PF first
+  std::vector<float> m_bestMetric;        ///< Best per-RB PF metric so far
+  std::vector<uint32_t> m_bestCand;       ///< Candidate owning each RB
+};
 
 } // namespace ns3
+
+#endif /* NR_U_PHY_H */
@@ -0,0 +1,365 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-policy.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NR_U_POLICY_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ns3 {
+
+namespace {
+
+const uint32_t POLICY_MAGIC = 0x5055524e;   // "NRUP"
+const uint32_t POLICY_VERSION = 1;
+
+/// Padding of the int8 rows, one AVX-512 register
+const uint32_t QUANT_ALIGN = 64;
+
+/// Int8 dot-product kernels, picked once from the CPU running the simulation
+enum Kernel
+{
+  KERNEL_SCALAR,
+  KERNEL_AVX2,
+  KERNEL_VNNI
+};
+
+int32_t
+DotInt8Scalar (const int8_t* a, const int8_t* w, uint32_t n)
+{
+  int32_t acc = 0;
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    acc += static_cast<int32_t> (a[i]) * w[i];
+  }
+  return acc;
+}
+
+#if defined(NR_U_POLICY_X86)
+
+__attribute__ ((target ("avx512f,avx512bw,avx512vnni"))) int32_t
+DotInt8Vnni (const uint8_t* a, const int8_t* w, uint32_t n)
+{
+  // a is the activation shifted by +128; the caller removes 128 * sum (w)
+  __m512i acc = _mm512_setzero_si512 ();
+  for (uint32_t i = 0; i < n; i += 64)
+  {
+    __m512i va = _mm512_loadu_si512 (a + i);
+    __m512i vw = _mm512_loadu_si512 (w + i);
+    acc = _mm512_dpbusd_epi32 (acc, va, vw);
+  }
+  return _mm512_reduce_add_epi32 (acc);
+}
+
+__attribute__ ((target ("avx2"))) int32_t
+DotInt8Avx2 (const int8_t* a, const int8_t* w, uint32_t n)
+{
+  // Widen to int16 and multiply-add pairs: exact, unlike maddubs which
+  // saturates on large products
+  __m256i acc = _mm256_setzero_si256 ();
+  for (uint32_t i = 0; i < n; i += 16)
+  {
+    __m256i va = _mm256_cvtepi8_epi16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (a + i)));
+    __m256i vw = _mm256_cvtepi8_epi16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (w + i)));
+    acc = _mm256_add_epi32 (acc, _mm256_madd_epi16 (va, vw));
+  }
+  __m128i sum = _mm_add_epi32 (_mm256_castsi256_si128 (acc), _mm256_extracti128_si256 (acc, 1));
+  sum = _mm_add_epi32 (sum, _mm_shuffle_epi32 (sum, _MM_SHUFFLE (1, 0, 3, 2)));
+  sum = _mm_add_epi32 (sum, _mm_shuffle_epi32 (sum, _MM_SHUFFLE (2, 3, 0, 1)));
+  return _mm_cvtsi128_si32 (sum);
+}
+
+#endif
+
+Kernel
+SelectKernel (void)
+{
+#if defined(NR_U_POLICY_X86)
+  // The library is built for the baseline ISA, so the wider kernels are
+  // only entered when the CPU (and the OS, for the AVX state) supports them
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512bw")
+      && __builtin_cpu_supports ("avx512vnni"))
+  {
+    return KERNEL_VNNI;
+  }
+  if (__builtin_cpu_supports ("avx2"))
+  {
+    return KERNEL_AVX2;
+  }
+#endif
+  return KERNEL_SCALAR;
+}
+
+Kernel
+GetKernel (void)
+{
+  static const Kernel kernel = SelectKernel ();
+  return kernel;
+}
+
+uint32_t
+ArgMax (const float* q, uint32_t n)
+{
+  return std::max_element (q, q + n) - q;
+}
+
+} // anonymous namespace
+
+NrUPolicyNet::NrUPolicyNet ()
+{
+}
+
+const char*
+NrUPolicyNet::GetKernelName (void)
+{
+  switch (GetKernel ())
+  {
+    case KERNEL_VNNI:
+      return "avx512-vnni";
+    case KERNEL_AVX2:
+      return "avx2";
+    default:
+      return "scalar";
+  }
+}
+
+bool
+NrUPolicyNet::Load (const std::string& path)
+{
+  m_layers.clear ();
+  std::ifstream file (path, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+
+  uint32_t header[3];
+  if (!file.read (reinterpret_cast<char*> (header), sizeof (header))
+      || header[0] != POLICY_MAGIC || header[1] != POLICY_VERSION || header[2] == 0)
+  {
+    return false;
+  }
+
+  std::vector<Layer> layers (header[2]);
+  uint32_t widest = 0;
+  for (uint32_t l = 0; l < layers.size (); ++l)
+  {
+    Layer& layer = layers[l];
+    uint32_t dims[2];
+    if (!file.read (reinterpret_cast<char*> (dims), sizeof (dims)) || dims[0] == 0 || dims[1] == 0
+        || (l > 0 && dims[0] != layers[l - 1].outputs))
+    {
+      return false;
+    }
+    layer.inputs = dims[0];
+    layer.outputs = dims[1];
+    layer.weights.resize (static_cast<std::size_t> (layer.inputs) * layer.outputs);
+    layer.bias.resize (layer.outputs);
+    if (!file.read (reinterpret_cast<char*> (layer.weights.data ()), layer.weights.size () * sizeof (float))
+        || !file.read (reinterpret_cast<char*> (layer.bias.data ()), layer.bias.size () * sizeof (float)))
+    {
+      return false;
+    }
+    Quantize (layer);
+    widest = std::max ({widest, layer.stride, layer.outputs});
+  }
+
+  m_layers.swap (layers);
+  m_act[0].assign (widest, 0.0f);
+  m_act[1].assign (widest, 0.0f);
+  m_qInput.assign (widest, 0);
+  m_qFloat.assign (GetOutputSize (), 0.0f);
+  m_qInt8.assign (GetOutputSize (), 0.0f);
+  return true;
+}
+
+void
+NrUPolicyNet::Quantize (Layer& layer)
+{
+  layer.stride = (layer.inputs + QUANT_ALIGN - 1) / QUANT_ALIGN * QUANT_ALIGN;
+  layer.qWeights.assign (static_cast<std::size_t> (layer.outputs) * layer.stride, 0);
+  layer.qScales.resize (layer.outputs);
+  layer.qRowSums.resize (layer.outputs);
+
+  // Symmetric per output channel: the largest weight of a row maps to 127
+  for (uint32_t o = 0; o < layer.outputs; ++o)
+  {
+    const float* row = &layer.weights[static_cast<std::size_t> (o) * layer.inputs];
+    float maxAbs = 0.0f;
+    for (uint32_t i = 0; i < layer.inputs; ++i)
+    {
+      maxAbs = std::max (maxAbs, std::fabs (row[i]));
+    }
+    float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+    int8_t* qRow = &layer.qWeights[static_cast<std::size_t> (o) * layer.stride];
+    int32_t rowSum = 0;
+    for (uint32_t i = 0; i < layer.inputs; ++i)
+    {
+      qRow[i] = static_cast<int8_t> (std::lround (row[i] / scale));
+      rowSum += qRow[i];
+    }
+    layer.qScales[o] = scale;
+    layer.qRowSums[o] = rowSum;
+  }
+}
+
+bool
+NrUPolicyNet::IsLoaded (void) const
+{
+  return !m_layers.empty ();
+}
+
+uint32_t
+NrUPolicyNet::GetInputSize (void) const
+{
+  return m_layers.empty () ? 0 : m_layers.front ().inputs;
+}
+
+uint32_t
+NrUPolicyNet::GetOutputSize (void) const
+{
+  return m_layers.empty () ? 0 : m_layers.back ().outputs;
+}
+
+void
+NrUPolicyNet::ForwardLayerFloat (const Layer& layer, const float* in, float* out, bool relu) const
+{
+  for (uint32_t o = 0; o < layer.outputs; ++o)
+  {
+    const float* row = &layer.weights[static_cast<std::size_t> (o) * layer.inputs];
+    float acc = layer.bias[o];
+    for (uint32_t i = 0; i < layer.inputs; ++i)
+    {
+      acc += row[i] * in[i];
+    }
+    out[o] = relu ? std::max (acc, 0.0f) : acc;
+  }
+}
+
+void
+NrUPolicyNet::ForwardLayerInt8 (const Layer& layer, const float* in, float* out, bool relu)
+{
+  // Dynamic per-tensor activation scale; the padding stays zero
+  float maxAbs = 0.0f;
+  for (uint32_t i = 0; i < layer.inputs; ++i)
+  {
+    maxAbs = std::max (maxAbs, std::fabs (in[i]));
+  }
+  float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+  float invScale = 1.0f / scale;
+  int8_t* q = m_qInput.data ();
+  for (uint32_t i = 0; i < layer.inputs; ++i)
+  {
+    q[i] = static_cast<int8_t> (std::lround (in[i] * invScale));
+  }
+  std::fill (q + layer.inputs, q + layer.stride, 0);
+
+  Kernel kernel = GetKernel ();
+#if defined(NR_U_POLICY_X86)
+  if (kernel == KERNEL_VNNI)
+  {
+    // vpdpbusd multiplies unsigned by signed bytes, so the activations are
+    // shifted by 128 in place and the shift is taken back with the row sums
+    uint8_t* u = reinterpret_cast<uint8_t*> (q);
+    for (uint32_t i = 0; i < layer.stride; ++i)
+    {
+      u[i] = static_cast<uint8_t> (q[i] + 128);
+    }
+  }
+#endif
+
+  for (uint32_t o = 0; o < layer.outputs; ++o)
+  {
+    const int8_t* row = &layer.qWeights[static_cast<std::size_t> (o) * layer.stride];
+    int32_t acc;
+    switch (kernel)
+    {
+#if defined(NR_U_POLICY_X86)
+      case KERNEL_VNNI:
+        acc = DotInt8Vnni (reinterpret_cast<const uint8_t*> (q), row, layer.stride) - 128 * layer.qRowSums[o];
+        break;
+      case KERNEL_AVX2:
+        acc = DotInt8Avx2 (q, row, layer.stride);
+        break;
+#endif
+      default:
+        acc = DotInt8Scalar (q, row, layer.stride);
+        break;
+    }
+    float y = acc * scale * layer.qScales[o] + layer.bias[o];
+    out[o] = relu ? std::max (y, 0.0f) : y;
+  }
+}
+
+void
+NrUPolicyNet::Forward (const float* obs, float* q, Precision precision)
+{
+  const float* in = obs;
+  for (std::size_t l = 0; l < m_layers.size (); ++l)
+  {
+    bool last = (l + 1 == m_layers.size ());
+    float* out = last ? q : m_act[l % 2].data ();
+    if (precision == INT8)
+    {
+      ForwardLayerInt8 (m_layers[l], in, out, !last);
+    }
+    else
+    {
+      ForwardLayerFloat (m_layers[l], in, out, !last);
+    }
+    in = out;
+  }
+}
+
+void
+NrUPolicyNet::SelectActions (const float* obs, uint32_t numBwps, uint32_t* actions, Precision precision)
+{
+  float* q = (precision == INT8) ? m_qInt8.data () : m_qFloat.data ();
+  Forward (obs, q, precision);
+  uint32_t slots = GetOutputSize () / numBwps;
+  for (uint32_t s = 0; s < slots; ++s)
+  {
+    actions[s] = ArgMax (q + s * numBwps, numBwps);
+  }
+}
+
+double
+NrUPolicyNet::CheckAgreement (const float* obs, uint32_t count, uint32_t numBwps)
+{
+  uint32_t slots = GetOutputSize () / numBwps;
+  uint64_t agree = 0;
+  for (uint32_t n = 0; n < count; ++n, obs += GetInputSize ())
+  {
+    Forward (obs, m_qFloat.data (), FLOAT);
+    Forward (obs, m_qInt8.data (), INT8);
+    for (uint32_t s = 0; s < slots; ++s)
+    {
+      agree += ArgMax (&m_qFloat[s * numBwps], numBwps) == ArgMax (&m_qInt8[s * numBwps], numBwps);
+    }
+  }
+  return (count == 0 || slots == 0) ? 1.0 : static_cast<double> (agree) / (static_cast<uint64_t> (count) * slots);
+}
+
+} // namespace ns3
@@ -0,0 +1,107 @@
+#ifndef NR_U_POLICY_H
+#define NR_U_POLICY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief In-process feed-forward policy for the RLA scheduler
+ *
+ * A stack of dense layers (ReLU between layers, linear output) producing
+ * one Q-value per (action slot, BWP). Weights are loaded from the file
+ * written by nr_u_policy.py:
+ *
+ *   uint32 magic "NRUP", uint32 version, uint32 numLayers, then per layer
+ *   uint32 inputs, uint32 outputs, float weights[outputs][inputs],
+ *   float bias[outputs]                                   (little endian)
+ *
+ * The same weights run either in float or in int8: weights are quantized
+ * symmetrically per output channel at load time, activations per tensor
+ * before every layer, and the dot products accumulate in int32 with
+ * AVX-512 VNNI or AVX2 kernels when the CPU supports them, scalar code
+ * otherwise; the kernel is picked at run time, so a baseline build still
+ * uses the wide ones. CheckAgreement measures how often both paths pick the same
+ * actions. Scratch buffers are shared, so one instance serves one thread.
+ */
+class NrUPolicyNet
+{
+public:
+  /// Arithmetic used by Forward and SelectActions
+  enum Precision {
+    FLOAT,  ///< Float weights and activations
+    INT8    ///< Int8 weights and activations, int32 accumulation
+  };
+
+  NrUPolicyNet ();
+
+  /**
+   * \brief Load the weights and prepare the int8 copy
+   * \param path The weight file
+   * \return false if the file is missing, truncated or inconsistent
+   */
+  bool Load (const std::string& path);
+
+  bool IsLoaded (void) const;
+  uint32_t GetInputSize (void) const;
+  uint32_t GetOutputSize (void) const;
+
+  /**
+   * \brief Compute the Q-values of an observation
+   * \param obs GetInputSize () floats
+   * \param q GetOutputSize () floats, written
+   * \param precision Arithmetic to use
+   */
+  void Forward (const float* obs, float* q, Precision precision);
+
+  /**
+   * \brief Pick the best BWP of every action slot
+   * \param obs GetInputSize () floats
+   * \param numBwps Q-values per action slot
+   * \param actions GetOutputSize () / numBwps values, written
+   * \param precision Arithmetic to use
+   */
+  void SelectActions (const float* obs, uint32_t numBwps, uint32_t* actions, Precision precision);
+
+  /**
+   * \brief Fraction of action slots where the int8 and float paths agree
+   * \param obs count observations, back to back
+   * \param count Number of observations
+   * \param numBwps Q-values per action slot
+   * \return the agreement in [0, 1], 1 if count is 0
+   */
+  double CheckAgreement (const float* obs, uint32_t count, uint32_t numBwps);
+
+  /// \return the name of the int8 dot-product kernel selected for this CPU
+  static const char* GetKernelName (void);
+
+private:
+  /// One dense layer, float and int8 forms
+  struct Layer
+  {
+    uint32_t inputs;                ///< Input width
+    uint32_t outputs;               ///< Output width
+    uint32_t stride;                ///< Input width padded for the kernels
+    std::vector<float> weights;     ///< outputs x inputs
+    std::vector<float> bias;        ///< outputs
+    std::vector<int8_t> qWeights;   ///< outputs x stride, zero padded
+    std::vector<float> qScales;     ///< Per output channel
+    std::vector<int32_t> qRowSums;  ///< Per output channel, for unsigned kernels
+  };
+
+  void Quantize (Layer& layer);
+  void ForwardLayerFloat (const Layer& layer, const float* in, float* out, bool relu) const;
+  void ForwardLayerInt8 (const Layer& layer, const float* in, float* out, bool relu);
+
+  std::vector<Layer> m_layers;      ///< Input to output
+  std::vector<float> m_act[2];      ///< Ping-pong activations
+  std::vector<int8_t> m_qInput;     ///< Quantized layer input, padded
+  std::vector<float> m_qFloat;      ///< Q-values of the float path in CheckAgreement
+  std::vector<float> m_qInt8;       ///< Q-values of the int8 path in CheckAgreement
+};
+
+} // namespace ns3
+
+#endif /* NR_U_POLICY_H */
@@ -0,0 +1,51 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-random-variable.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (NrUUniformRandomVariable);
+
+TypeId
+NrUUniformRandomVariable::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrUUniformRandomVariable")
+    .SetParent<UniformRandomVariable> ()
+    .AddConstructor<NrUUniformRandomVariable> ();
+  return tid;
+}
+
+void
+NrUUniformRandomVariable::SaveState (State& state) const
+{
+  state.assign (1, *Peek ());
+}
+
+void
+NrUUniformRandomVariable::RestoreState (const State& state)
+{
+  if (!state.empty ())
+  {
+    *Peek () = state.front ();
+  }
+}
+
+} // namespace ns3
@@ -0,0 +1,41 @@
+#ifndef NR_U_RANDOM_VARIABLE_H
+#define NR_U_RANDOM_VARIABLE_H
+
+#include "ns3/random-variable-stream.h"
+#include "ns3/rng-stream.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Uniform random variable whose generator state can be saved
+ *
+ * A checkpoint copies the state of the underlying RngStream (six
+ * doubles) and a restore copies it back, in constant time whatever the
+ * number of draws made since the stream was assigned. Streams not
+ * assigned through AssignStreams are restored just the same.
+ */
+class NrUUniformRandomVariable : public UniformRandomVariable
+{
+public:
+  /// Generator state, empty until saved
+  typedef std::vector<RngStream> State;
+
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Copy the generator state
+   * \param state The state to fill, its storage is reused
+   */
+  void SaveState (State& state) const;
+
+  /**
+   * \brief Continue from a saved generator state; an empty one is ignored
+   * \param state The state to restore
+   */
+  void RestoreState (const State& state);
+};
+
+} // namespace ns3
+
+#endif /* NR_U_RANDOM_VARIABLE_H */
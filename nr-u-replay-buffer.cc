@@ -0,0 +1,303 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-replay-buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ns3 {
+
+namespace {
+
+/// Keeps zero-error transitions sampleable
+const double PRIORITY_EPSILON = 1e-6;
+
+} // anonymous namespace
+
+NrUReplayBuffer::NrUReplayBuffer (uint32_t capacity, uint32_t obsSize, uint32_t actionSize,
+                                  double alpha, uint64_t seed)
+  : m_capacity (std::max (capacity, 1u)),
+    m_obsSize (obsSize),
+    m_actionSize (actionSize),
+    m_alpha (alpha),
+    m_size (0),
+    m_next (0),
+    m_maxPriority (1.0),
+    m_leafBase (1),
+    m_treeUpdates (0),
+    m_rng (seed)
+{
+  std::size_t rows = m_capacity;
+  m_obs.assign (rows * m_obsSize, 0.0f);
+  m_actions.assign (rows * m_actionSize, 0);
+  m_rewards.assign (rows, 0.0f);
+  m_nextObs.assign (rows * m_obsSize, 0.0f);
+  m_dones.assign (rows, 0);
+
+  // Leaves at [m_leafBase, 2 * m_leafBase), each node holds the sum of its children
+  while (m_leafBase < m_capacity)
+  {
+    m_leafBase <<= 1;
+  }
+  m_tree.assign (2 * m_leafBase, 0.0);
+
+  m_batch.size = 0;
+  m_batch.seqLen = 0;
+}
+
+std::size_t
+NrUReplayBuffer::GetTransitionBytes (uint32_t obsSize, uint32_t actionSize)
+{
+  // Two observations, the action, reward, done flag and the sum-tree leaf;
+  // the inner tree nodes add at most one more double per transition
+  return 2 * obsSize * sizeof (float) + actionSize * sizeof (uint32_t)
+         + sizeof (float) + sizeof (uint8_t) + 2 * sizeof (double);
+}
+
+uint32_t
+NrUReplayBuffer::Add (const float* obs, const uint32_t* action, float reward, bool done,
+                      const float* nextObs)
+{
+  uint32_t index = m_next;
+  std::size_t row = index;
+  std::memcpy (&m_obs[row * m_obsSize], obs, m_obsSize * sizeof (float));
+  std::memcpy (&m_actions[row * m_actionSize], action, m_actionSize * sizeof (uint32_t));
+  std::memcpy (&m_nextObs[row * m_obsSize], nextObs, m_obsSize * sizeof (float));
+  m_rewards[row] = reward;
+  m_dones[row] = done ? 1 : 0;
+
+  // New transitions are sampled at least once before their error is known
+  SetPriority (index, m_maxPriority);
+
+  m_next = (m_next + 1) % m_capacity;
+  m_size = std::min (m_size + 1, m_capacity);
+  return index;
+}
+
+void
+NrUReplayBuffer::SetPriority (uint32_t index, double priority)
+{
+  uint32_t node = m_leafBase + index;
+  double delta = priority - m_tree[node];
+  for (; node >= 1; node >>= 1)
+  {
+    m_tree[node] += delta;
+  }
+  // Adding deltas accumulates rounding error in the parents; rebuilding
+  // them from the leaves every leafBase updates keeps it bounded at O(1)
+  // amortized cost
+  if (++m_treeUpdates >= m_leafBase)
+  {
+    RebuildTree ();
+  }
+}
+
+void
+NrUReplayBuffer::RebuildTree (void)
+{
+  for (uint32_t node = m_leafBase - 1; node >= 1; --node)
+  {
+    m_tree[node] = m_tree[2 * node] + m_tree[2 * node + 1];
+  }
+  m_treeUpdates = 0;
+}
+
+uint32_t
+NrUReplayBuffer::FindPrefixSum (double mass) const
+{
+  uint32_t node = 1;
+  while (node < m_leafBase)
+  {
+    uint32_t left = 2 * node;
+    if (mass < m_tree[left] || m_tree[left + 1] <= 0.0)
+    {
+      node = left;
+    }
+    else
+    {
+      mass -= m_tree[left];
+      node = left + 1;
+    }
+  }
+  // Rounding can land past the last stored leaf
+  return std::min (node - m_leafBase, m_size - 1);
+}
+
+void
+NrUReplayBuffer::PrepareBatch (uint32_t batchSize, uint32_t seqLen)
+{
+  // Storage only grows, so steady-state sampling does not allocate
+  std::size_t rows = static_cast<std::size_t> (batchSize) * seqLen;
+  m_batch.size = batchSize;
+  m_batch.seqLen = seqLen;
+  m_batch.indices.resize (batchSize);
+  m_batch.weights.resize (batchSize);
+  m_batch.obs.resize (rows * m_obsSize);
+  m_batch.actions.resize (rows * m_actionSize);
+  m_batch.rewards.resize (rows);
+  m_batch.nextObs.resize (rows * m_obsSize);
+  m_batch.dones.resize (rows);
+}
+
+void
+NrUReplayBuffer::Gather (uint32_t row, uint32_t index)
+{
+  std::size_t dst = row;
+  std::size_t src = index;
+  std::memcpy (&m_batch.obs[dst * m_obsSize], &m_obs[src * m_obsSize],
+               m_obsSize * sizeof (float));
+  std::memcpy (&m_batch.actions[dst * m_actionSize], &m_actions[src * m_actionSize],
+               m_actionSize * sizeof (uint32_t));
+  std::memcpy (&m_batch.nextObs[dst * m_obsSize], &m_nextObs[src * m_obsSize],
+               m_obsSize * sizeof (float));
+  m_batch.rewards[dst] = m_rewards[src];
+  m_batch.dones[dst] = m_dones[src];
+}
+
+const NrUReplayBuffer::Batch&
+NrUReplayBuffer::Sample (uint32_t batchSize, double beta)
+{
+  if (m_size == 0)
+  {
+    PrepareBatch (0, 1);
+    return m_batch;
+  }
+  PrepareBatch (batchSize, 1);
+
+  // One draw per equal slice of the total priority
+  double total = m_tree[1];
+  double segment = total / batchSize;
+  std::uniform_real_distribution<double> uniform (0.0, 1.0);
+  double maxWeight = 0.0;
+  for (uint32_t i = 0; i < batchSize; ++i)
+  {
+    uint32_t index = FindPrefixSum ((i + uniform (m_rng)) * segment);
+    double probability = m_tree[m_leafBase + index] / total;
+    double weight = std::pow (m_size * probability, -beta);
+    maxWeight = std::max (maxWeight, weight);
+    m_batch.indices[i] = index;
+    m_batch.weights[i] = weight;
+    Gather (i, index);
+  }
+  for (uint32_t i = 0; i < batchSize; ++i)
+  {
+    m_batch.weights[i] /= maxWeight;
+  }
+  return m_batch;
+}
+
+const NrUReplayBuffer::Batch&
+NrUReplayBuffer::SampleSequences (uint32_t batchSize, uint32_t seqLen)
+{
+  if (seqLen == 0 || m_size < seqLen)
+  {
+    PrepareBatch (0, std::max (seqLen, 1u));
+    return m_batch;
+  }
+  PrepareBatch (batchSize, seqLen);
+
+  // Runs are drawn in age order starting from the oldest transition, so
+  // none wraps from the newest transition to the oldest one
+  uint32_t oldest = (m_size < m_capacity) ? 0 : m_next;
+  std::uniform_int_distribution<uint32_t> start (0, m_size - seqLen);
+  for (uint32_t i = 0; i < batchSize; ++i)
+  {
+    uint32_t first = (oldest + start (m_rng)) % m_capacity;
+    m_batch.indices[i] = first;
+    m_batch.weights[i] = 1.0f;
+    for (uint32_t t = 0; t < seqLen; ++t)
+    {
+      Gather (i * seqLen + t, (first + t) % m_capacity);
+    }
+  }
+  return m_batch;
+}
+
+void
+NrUReplayBuffer::UpdatePriorities (const uint32_t* indices, const float* tdErrors, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (indices[i] >= m_size)
+    {
+      continue;
+    }
+    double priority = std::pow (std::fabs (tdErrors[i]) + PRIORITY_EPSILON, m_alpha);
+    m_maxPriority = std::max (m_maxPriority, priority);
+    SetPriority (indices[i], priority);
+  }
+}
+
+uint32_t
+NrUReplayBuffer::GetSize (void) const
+{
+  return m_size;
+}
+
+uint32_t
+NrUReplayBuffer::GetCapacity (void) const
+{
+  return m_capacity;
+}
+
+uint32_t
+NrUReplayBuffer::GetObsSize (void) const
+{
+  return m_obsSize;
+}
+
+uint32_t
+NrUReplayBuffer::GetActionSize (void) const
+{
+  return m_actionSize;
+}
+
+const float*
+NrUReplayBuffer::GetObsData (void) const
+{
+  return m_obs.data ();
+}
+
+const uint32_t*
+NrUReplayBuffer::GetActionData (void) const
+{
+  return m_actions.data ();
+}
+
+const float*
+NrUReplayBuffer::GetRewardData (void) const
+{
+  return m_rewards.data ();
+}
+
+const float*
+NrUReplayBuffer::GetNextObsData (void) const
+{
+  return m_nextObs.data ();
+}
+
+const uint8_t*
+NrUReplayBuffer::GetDoneData (void) const
+{
+  return m_dones.data ();
+}
+
+} // namespace ns3
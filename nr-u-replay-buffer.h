@@ -0,0 +1,147 @@
+#ifndef NR_U_REPLAY_BUFFER_H
+#define NR_U_REPLAY_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Prioritized experience replay for the RLA agent
+ *
+ * Transitions (obs, action, reward, next obs, done) live in preallocated
+ * contiguous arrays, one per field, so a transition costs exactly
+ * GetTransitionBytes () and nothing is allocated once the buffer is built.
+ * When full, the oldest transition is overwritten.
+ *
+ * Sample draws a prioritized batch through a sum-tree over the
+ * transition priorities (p = (|td| + eps)^alpha, new transitions get the
+ * largest priority seen) and returns importance-sampling weights
+ * normalized by the batch maximum. SampleSequences draws uniform runs of
+ * consecutive transitions for recurrent (DRQN) training; runs never
+ * straddle the write position, and dones inside a run are returned so the
+ * learner can mask across episode boundaries.
+ *
+ * Batches are gathered into buffers owned by the replay buffer and reused
+ * across calls. In-process consumers can read them, or the arena itself,
+ * through the raw pointers without further copies.
+ */
+class NrUReplayBuffer
+{
+public:
+  /// Sampled batch, row-major; valid until the next Sample call
+  struct Batch
+  {
+    uint32_t size;                  ///< Rows (transitions or sequences)
+    uint32_t seqLen;                ///< Transitions per row
+    std::vector<uint32_t> indices;  ///< Arena index of each row (first transition)
+    std::vector<float> weights;     ///< Importance-sampling weight per row
+    std::vector<float> obs;         ///< size x seqLen x obsSize
+    std::vector<uint32_t> actions;  ///< size x seqLen x actionSize
+    std::vector<float> rewards;     ///< size x seqLen
+    std::vector<float> nextObs;     ///< size x seqLen x obsSize
+    std::vector<uint8_t> dones;     ///< size x seqLen
+  };
+
+  /**
+   * \brief Allocate the arena
+   * \param capacity Maximum number of transitions
+   * \param obsSize Floats per observation
+   * \param actionSize Values per action
+   * \param alpha Prioritization exponent (0 for uniform sampling)
+   * \param seed Seed of the sampling generator
+   */
+  NrUReplayBuffer (uint32_t capacity, uint32_t obsSize, uint32_t actionSize,
+                   double alpha = 0.6, uint64_t seed = 1);
+
+  /**
+   * \brief Bytes stored per transition
+   * \param obsSize Floats per observation
+   * \param actionSize Values per action
+   * \return the arena bytes per transition, priorities included
+   */
+  static std::size_t GetTransitionBytes (uint32_t obsSize, uint32_t actionSize);
+
+  /**
+   * \brief Store a transition
+   * \param obs The observation
+   * \param action The action taken after obs
+   * \param reward The reward of the step
+   * \param done Whether next obs ended the episode
+   * \param nextObs The next observation
+   * \return the arena index of the transition
+   */
+  uint32_t Add (const float* obs, const uint32_t* action, float reward, bool done,
+                const float* nextObs);
+
+  /**
+   * \brief Draw a prioritized batch of transitions (stratified over the
+   *        total priority)
+   * \param batchSize Number of transitions
+   * \param beta Importance-sampling exponent
+   * \return the batch, empty if the buffer is empty
+   */
+  const Batch& Sample (uint32_t batchSize, double beta);
+
+  /**
+   * \brief Draw a batch of runs of consecutive transitions
+   * \param batchSize Number of runs
+   * \param seqLen Transitions per run
+   * \return the batch, empty if fewer than seqLen transitions are stored
+   */
+  const Batch& SampleSequences (uint32_t batchSize, uint32_t seqLen);
+
+  /**
+   * \brief Set new priorities from TD errors
+   * \param indices Arena indices, as returned in Batch::indices
+   * \param tdErrors TD error per index
+   * \param count Number of indices
+   */
+  void UpdatePriorities (const uint32_t* indices, const float* tdErrors, uint32_t count);
+
+  uint32_t GetSize (void) const;
+  uint32_t GetCapacity (void) const;
+  uint32_t GetObsSize (void) const;
+  uint32_t GetActionSize (void) const;
+
+  // Raw arena access, capacity rows each
+  const float* GetObsData (void) const;
+  const uint32_t* GetActionData (void) const;
+  const float* GetRewardData (void) const;
+  const float* GetNextObsData (void) const;
+  const uint8_t* GetDoneData (void) const;
+
+private:
+  void SetPriority (uint32_t index, double priority);
+  void RebuildTree (void);
+  uint32_t FindPrefixSum (double mass) const;
+  void PrepareBatch (uint32_t batchSize, uint32_t seqLen);
+  void Gather (uint32_t row, uint32_t index);
+
+  uint32_t m_capacity;                  ///< Maximum transitions
+  uint32_t m_obsSize;                   ///< Floats per observation
+  uint32_t m_actionSize;                ///< Values per action
+  double m_alpha;                       ///< Prioritization exponent
+  uint32_t m_size;                      ///< Stored transitions
+  uint32_t m_next;                      ///< Arena index of the next write
+  double m_maxPriority;                 ///< Largest priority seen
+
+  std::vector<float> m_obs;             ///< capacity x obsSize
+  std::vector<uint32_t> m_actions;      ///< capacity x actionSize
+  std::vector<float> m_rewards;         ///< capacity
+  std::vector<float> m_nextObs;         ///< capacity x obsSize
+  std::vector<uint8_t> m_dones;         ///< capacity
+
+  uint32_t m_leafBase;                  ///< First leaf of the sum-tree
+  std::vector<double> m_tree;           ///< Sum-tree, root at 1
+  uint32_t m_treeUpdates;               ///< Leaf updates since the last rebuild
+
+  std::mt19937_64 m_rng;                ///< Sampling generator
+  Batch m_batch;                        ///< Reused batch storage
+};
+
+} // namespace ns3
+
+#endif /* NR_U_REPLAY_BUFFER_H */
@@ -0,0 +1,516 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Scaling stress harness: synthetic scenarios from a few UEs to 100k, run
+ * for a fixed number of decision windows each:
+ *
+ *   ./ns3 run "nr-u-scale --ues=24,1536,24576,100000 --bwps=3,12 --output=scaling.csv"
+ *   python3 plot_scaling.py scaling.csv
+ *
+ * Every slot, Poisson arrivals are queued at the PHY, each BWP runs LBT and
+ * a granted BWP is allocated among its UEs; the scheduler takes its LCA
+ * decision every window. Per scenario, the CSV reports the wall time per
+ * simulated second split into phases, the peak RSS and the size of the
+ * event queue. The "other" time is the rest of Simulator::Run: decision
+ * windows, WiFi interference, BWP switch notifications and the event
+ * queue itself. Each scenario runs in its own child process, so its peak
+ * RSS is its own.
+ *
+ * RNTIs are 16 bits, so a cell holds at most 65534 UEs; larger scenarios
+ * are split into independent cells of UesPerCell UEs, each with its own
+ * PHY, LBT, BWP manager and scheduler.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/nr-u-bwp-manager.h"
+#include "ns3/nr-u-lbt.h"
+#include "ns3/nr-u-phy.h"
+#include "ns3/nr-u-scheduler-ai.h"
+#include "nr-u-traffic-source.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("NrUScale");
+
+namespace ns3 {
+
+/**
+ * \brief Map scheduler that keeps count of the events it holds
+ *
+ * Cancelled events are counted until they are removed, as they still
+ * occupy the queue.
+ */
+class NrUCountingScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  virtual void Insert (const Scheduler::Event& ev);
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event& ev);
+
+  /// \return the events in the queue
+  static uint64_t GetSize (void);
+
+  /// \return the most events the queue has held
+  static uint64_t GetPeakSize (void);
+
+private:
+  static uint64_t s_size;
+  static uint64_t s_peakSize;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (NrUCountingScheduler);
+
+uint64_t NrUCountingScheduler::s_size = 0;
+uint64_t NrUCountingScheduler::s_peakSize = 0;
+
+TypeId
+NrUCountingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrUCountingScheduler")
+    .SetParent<MapScheduler> ()
+    .AddConstructor<NrUCountingScheduler> ();
+  return tid;
+}
+
+void
+NrUCountingScheduler::Insert (const Scheduler::Event& ev)
+{
+  MapScheduler::Insert (ev);
+  s_peakSize = std::max (s_peakSize, ++s_size);
+}
+
+Scheduler::Event
+NrUCountingScheduler::RemoveNext (void)
+{
+  s_size--;
+  return MapScheduler::RemoveNext ();
+}
+
+void
+NrUCountingScheduler::Remove (const Scheduler::Event& ev)
+{
+  s_size--;
+  MapScheduler::Remove (ev);
+}
+
+uint64_t
+NrUCountingScheduler::GetSize (void)
+{
+  return s_size;
+}
+
+uint64_t
+NrUCountingScheduler::GetPeakSize (void)
+{
+  return s_peakSize;
+}
+
+} // namespace ns3
+
+namespace {
+
+/// Phases of a slot timed by the harness
+enum Phase
+{
+  TRAFFIC,      ///< Drawing arrivals and queueing them at the PHY
+  CANDIDATES,   ///< Listing the UEs of every BWP after a decision window
+  LBT,          ///< ChannelAccessRequest of every BWP
+  ALLOCATION,   ///< AllocateResources of the granted BWPs
+  NUM_PHASES
+};
+
+const char* PHASE_NAMES[NUM_PHASES] = {"traffic", "candidates", "lbt", "allocation"};
+
+/// Packet sizes are drawn in the units of RL.py, kbit
+const double BITS_PER_SIZE_UNIT = 1000.0;
+
+/// Outcome of a scenario, passed from the child process as raw bytes
+struct ScaleResult
+{
+  double setupSeconds;              ///< Building the scenario
+  double wallSeconds;               ///< Simulator::Run
+  double simSeconds;                ///< Simulated time
+  double phaseSeconds[NUM_PHASES];  ///< Wall time of each slot phase
+  uint64_t events;                  ///< Events executed
+  uint64_t peakEventQueue;          ///< Most events queued at once
+  double meanEventQueue;            ///< Events queued, averaged over slots
+  uint64_t arrivals;                ///< Packets arrived
+  uint64_t drops;                   ///< Packets tail-dropped
+};
+
+/**
+ * \brief numUes UEs over cells of uesPerCell UEs, each cell with numBwps
+ * BWPs, driven slot by slot
+ */
+class ScaleScenario
+{
+public:
+  ScaleScenario (uint32_t numUes, uint16_t numBwps, uint32_t uesPerCell,
+                 uint32_t windowSize, double rate, uint64_t seed);
+
+  /**
+   * \brief Simulate a number of decision windows
+   * \param windows Windows to simulate
+   * \param result Filled, except for setupSeconds
+   */
+  void Run (uint32_t windows, ScaleResult& result);
+
+private:
+  struct Cell
+  {
+    Ptr<NrUPhy> phy;
+    Ptr<NrUeLbt> lbt;
+    Ptr<NrUeBwpManager> bwpManager;
+    Ptr<NrUeAiScheduler> scheduler;
+    std::vector<std::vector<uint16_t>> bwpUes;  ///< Candidates of each BWP
+  };
+
+  void Slot (void);
+
+  uint16_t m_numBwps;
+  uint32_t m_uesPerCell;
+  uint32_t m_windowSize;
+  std::vector<Cell> m_cells;
+  std::vector<uint8_t> m_granted;   ///< LBT outcome of every cell and BWP
+  NrUTrafficSource m_traffic;       ///< Arrivals of all UEs, numbered across cells
+  NrUTrafficSource::Batch m_arrivals;
+  uint64_t m_slot;
+  double m_queueSum;                ///< Event queue size summed over slots
+  ScaleResult* m_result;
+};
+
+ScaleScenario::ScaleScenario (uint32_t numUes, uint16_t numBwps, uint32_t uesPerCell,
+                              uint32_t windowSize, double rate, uint64_t seed)
+  : m_numBwps (numBwps),
+    m_uesPerCell (uesPerCell),
+    m_windowSize (windowSize),
+    m_traffic (numUes, seed),
+    m_slot (0),
+    m_queueSum (0),
+    m_result (nullptr)
+{
+  static const uint16_t bwpRbs[] = {50, 70, 100};
+  std::mt19937 rng (seed);
+  std::uniform_real_distribution<double> cqiDist (1.0, 15.0);
+  std::uniform_real_distribution<double> sizeDist (8.0, 20.0);
+
+  uint32_t numCells = (numUes + uesPerCell - 1) / uesPerCell;
+  m_cells.resize (numCells);
+  m_granted.assign (numCells * numBwps, 0);
+  for (uint32_t c = 0; c < numCells; ++c)
+  {
+    Cell& cell = m_cells[c];
+    uint32_t cellUes = std::min (uesPerCell, numUes - c * uesPerCell);
+
+    cell.phy = CreateObject<NrUPhy> ();
+    cell.phy->SetAttribute ("FullBuffer", BooleanValue (false));
+    cell.lbt = CreateObject<NrUeLbt> ();
+    cell.lbt->SetPhy (cell.phy);
+    cell.bwpManager = CreateObject<NrUeBwpManager> ();
+
+    std::vector<uint16_t> bwpIds;
+    std::vector<uint16_t> numRbs;
+    std::vector<double> wifiMeans;
+    for (uint16_t b = 0; b < numBwps; ++b)
+    {
+      bwpIds.push_back (b);
+      numRbs.push_back (bwpRbs[b % 3]);
+      wifiMeans.push_back (0.2 + 0.2 * (b % 3));
+      cell.phy->ConfigureBwp (b, 1, 30e3, numRbs.back ());
+    }
+    cell.bwpManager->AddBwps (bwpIds, numRbs);
+    cell.lbt->AddBwps (bwpIds, wifiMeans);
+
+    std::vector<uint16_t> ueIds;
+    std::vector<double> cqi;
+    for (uint32_t rnti = 1; rnti <= cellUes; ++rnti)
+    {
+      ueIds.push_back (rnti);
+      cqi.resize (*std::max_element (numRbs.begin (), numRbs.end ()));
+      for (double& value : cqi)
+      {
+        value = cqiDist (rng);
+      }
+      cell.phy->UpdateChannelQuality (rnti, cqi);
+    }
+    cell.bwpManager->AddUes (ueIds);
+
+    cell.scheduler = CreateObject<NrUeAiScheduler> ();
+    cell.scheduler->SetAttribute ("AlgorithmType", EnumValue (NrUeAiScheduler::LCA));
+    cell.scheduler->SetAttribute ("TimeWindowSize", UintegerValue (windowSize));
+    cell.scheduler->SetBwpManager (cell.bwpManager);
+    cell.scheduler->SetLbt (cell.lbt);
+    cell.scheduler->SetPhy (cell.phy);
+    cell.scheduler->Initialize ();
+    cell.bwpUes.resize (numBwps);
+  }
+
+  m_traffic.SetSizeLimits (0, 30);
+  for (uint32_t ue = 0; ue < numUes; ++ue)
+  {
+    m_traffic.SetRate (ue, rate);
+    m_traffic.SetMeanSize (ue, sizeDist (rng));
+  }
+  m_traffic.Restart (0);
+}
+
+void
+ScaleScenario::Run (uint32_t windows, ScaleResult& result)
+{
+  m_result = &result;
+  Time duration = MicroSeconds (500 * static_cast<uint64_t> (windows) * m_windowSize);
+  Simulator::Schedule (Seconds (0), &ScaleScenario::Slot, this);
+  Simulator::Stop (duration);
+
+  auto start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  result.wallSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  result.simSeconds = duration.GetSeconds ();
+  result.events = Simulator::GetEventCount ();
+  result.peakEventQueue = NrUCountingScheduler::GetPeakSize ();
+  result.meanEventQueue = m_slot > 0 ? m_queueSum / m_slot : 0;
+}
+
+void
+ScaleScenario::Slot (void)
+{
+  typedef std::chrono::steady_clock Clock;
+  Simulator::Schedule (MicroSeconds (500), &ScaleScenario::Slot, this);
+  Clock::time_point t0 = Clock::now ();
+
+  m_traffic.Generate (m_arrivals);
+  for (std::size_t i = 0; i < m_arrivals.ues.size (); ++i)
+  {
+    uint32_t ue = m_arrivals.ues[i];
+    uint16_t rnti = ue % m_uesPerCell + 1;
+    uint32_t bits = m_arrivals.sizes[i] * BITS_PER_SIZE_UNIT;
+    if (!m_cells[ue / m_uesPerCell].phy->EnqueuePacket (rnti, bits))
+    {
+      m_result->drops++;
+    }
+  }
+  m_result->arrivals += m_arrivals.ues.size ();
+  Clock::time_point t1 = Clock::now ();
+
+  // The window's LCA decision runs before the first slot of the window
+  if (m_slot % m_windowSize == 0)
+  {
+    for (Cell& cell : m_cells)
+    {
+      for (auto& ues : cell.bwpUes)
+      {
+        ues.clear ();
+      }
+      for (const auto& ue : cell.bwpManager->GetUeMap ())
+      {
+        cell.bwpUes[ue.second].push_back (ue.first);
+      }
+    }
+  }
+  Clock::time_point t2 = Clock::now ();
+
+  for (std::size_t c = 0; c < m_cells.size (); ++c)
+  {
+    for (uint16_t b = 0; b < m_numBwps; ++b)
+    {
+      m_granted[c * m_numBwps + b] = m_cells[c].lbt->ChannelAccessRequest (b);
+    }
+  }
+  Clock::time_point t3 = Clock::now ();
+
+  for (std::size_t c = 0; c < m_cells.size (); ++c)
+  {
+    for (uint16_t b = 0; b < m_numBwps; ++b)
+    {
+      if (m_granted[c * m_numBwps + b] && !m_cells[c].bwpUes[b].empty ())
+      {
+        m_cells[c].phy->AllocateResources (b, m_cells[c].bwpUes[b]);
+      }
+    }
+  }
+  Clock::time_point t4 = Clock::now ();
+
+  m_result->phaseSeconds[TRAFFIC] += std::chrono::duration<double> (t1 - t0).count ();
+  m_result->phaseSeconds[CANDIDATES] += std::chrono::duration<double> (t2 - t1).count ();
+  m_result->phaseSeconds[LBT] += std::chrono::duration<double> (t3 - t2).count ();
+  m_result->phaseSeconds[ALLOCATION] += std::chrono::duration<double> (t4 - t3).count ();
+  m_queueSum += NrUCountingScheduler::GetSize ();
+  m_slot++;
+}
+
+template <typename T>
+bool
+ParseList (const std::string& text, std::vector<T>& out)
+{
+  out.clear ();
+  std::stringstream ss (text);
+  std::string item;
+  while (std::getline (ss, item, ','))
+  {
+    std::stringstream is (item);
+    T value;
+    if (!(is >> value))
+    {
+      return false;
+    }
+    out.push_back (value);
+  }
+  return !out.empty ();
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char* argv[])
+{
+  std::string ues = "24,96,384,1536,6144,24576,100000";
+  std::string bwps = "3,12";
+  uint32_t windows = 4;
+  uint32_t windowSize = 500;
+  uint32_t uesPerCell = 65534;
+  double rate = 0.005;
+  uint64_t seed = 1;
+  std::string output;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("ues", "Comma-separated UE counts", ues);
+  cmd.AddValue ("bwps", "Comma-separated BWP counts per cell", bwps);
+  cmd.AddValue ("windows", "Decision windows simulated per scenario", windows);
+  cmd.AddValue ("windowSize", "Slots per decision window", windowSize);
+  cmd.AddValue ("uesPerCell", "UEs per cell, at most 65534", uesPerCell);
+  cmd.AddValue ("rate", "Packets per UE and slot", rate);
+  cmd.AddValue ("seed", "Seed of the traffic and channel draws", seed);
+  cmd.AddValue ("output", "Results CSV, stdout if empty", output);
+  cmd.Parse (argc, argv);
+
+  std::vector<uint32_t> ueCounts;
+  std::vector<uint32_t> bwpCounts;
+  if (!ParseList (ues, ueCounts) || !ParseList (bwps, bwpCounts))
+  {
+    NS_FATAL_ERROR ("Bad UE or BWP count list");
+  }
+  NS_ABORT_MSG_IF (uesPerCell == 0 || uesPerCell > 65534, "UesPerCell must be in 1..65534");
+  NS_ABORT_MSG_IF (windows == 0 || windowSize == 0, "Windows and WindowSize must be positive");
+  NS_ABORT_MSG_IF (rate < 0 || rate > 32, "Rate must be in 0..32");
+
+  std::ofstream file;
+  if (!output.empty ())
+  {
+    file.open (output);
+    if (!file)
+    {
+      NS_FATAL_ERROR ("Cannot write " << output);
+    }
+  }
+  std::ostream& os = output.empty () ? std::cout : file;
+  os << "ues,bwps,cells,windows,sim_seconds,setup_seconds,wall_seconds,wall_per_sim_second,"
+        "peak_rss_mb,events,peak_event_queue,mean_event_queue,arrivals,drops";
+  for (const char* name : PHASE_NAMES)
+  {
+    os << "," << name << "_seconds";
+  }
+  os << ",other_seconds\n";
+
+  for (uint32_t numBwps : bwpCounts)
+  {
+    for (uint32_t numUes : ueCounts)
+    {
+      NS_ABORT_MSG_IF (numUes == 0 || numBwps == 0 || numBwps > 1024, "Bad scenario size");
+
+      int fds[2];
+      if (pipe (fds) != 0)
+      {
+        NS_FATAL_ERROR ("Cannot create a pipe");
+      }
+      pid_t pid = fork ();
+      if (pid < 0)
+      {
+        NS_FATAL_ERROR ("Cannot fork");
+      }
+      if (pid == 0)
+      {
+        // Child: build and run the scenario, send the result, and leave
+        // without tearing the scenario down
+        close (fds[0]);
+        ObjectFactory factory;
+        factory.SetTypeId ("ns3::NrUCountingScheduler");
+        Simulator::SetScheduler (factory);
+
+        ScaleResult result = {};
+        auto start = std::chrono::steady_clock::now ();
+        ScaleScenario scenario (numUes, numBwps, uesPerCell, windowSize, rate, seed);
+        result.setupSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+        scenario.Run (windows, result);
+
+        bool sent = write (fds[1], &result, sizeof (result)) == sizeof (result);
+        _exit (sent ? 0 : 1);
+      }
+
+      close (fds[1]);
+      ScaleResult result;
+      ssize_t received = read (fds[0], &result, sizeof (result));
+      close (fds[0]);
+      int status = 0;
+      struct rusage usage = {};
+      wait4 (pid, &status, 0, &usage);
+      if (received != sizeof (result) || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+      {
+        std::cerr << "Scenario ues=" << numUes << " bwps=" << numBwps << " failed\n";
+        continue;
+      }
+
+      double otherSeconds = result.wallSeconds;
+      for (double seconds : result.phaseSeconds)
+      {
+        otherSeconds -= seconds;
+      }
+      uint32_t cells = (numUes + uesPerCell - 1) / uesPerCell;
+      double peakRssMb = usage.ru_maxrss / 1024.0;   // kB on Linux
+      os << numUes << "," << numBwps << "," << cells << "," << windows << "," << result.simSeconds
+         << "," << result.setupSeconds << "," << result.wallSeconds << ","
+         << result.wallSeconds / result.simSeconds << "," << peakRssMb << "," << result.events
+         << "," << result.peakEventQueue << "," << result.meanEventQueue << "," << result.arrivals
+         << "," << result.drops;
+      for (double seconds : result.phaseSeconds)
+      {
+        os << "," << seconds;
+      }
+      os << "," << otherSeconds << "\n";
+      os.flush ();
+      std::cerr << "ues=" << numUes << " bwps=" << numBwps << ": "
+                << result.wallSeconds / result.simSeconds << " s per simulated s, "
+                << peakRssMb << " MB\n";
+    }
+  }
+  return 0;
+}
@@ -24,10 +24,16 @@
 #include "ns3/nr-u-phy.h"
 #include "ns3/nr-amc.h"
 #include "ns3/nr-mac-scheduler.h"
-#include "ns3/gym-bwp-rl-env.h"
+#include "ns3/bwp-rl-env.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/nr-u-random-variable.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include "ns3/nr-u-performance-summary.h"
+#include "ns3/nr-u-trace-ring.h"
 #include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 
@@ -45,7 +51,8 @@ NrUeAiScheduler::GetTypeId (void)
                    EnumValue (RLA),
                    MakeEnumAccessor (&NrUeAiScheduler::m_algorithmType),
                    MakeEnumChecker (LCA, "LCA",
-                                    RLA, "RLA"))
+                                    RLA, "RLA",
+                                    EXTERNAL, "External"))
     .AddAttribute ("TimeWindowSize",
                    "Size of decision time window in slots",
                    UintegerValue (500),
@@ -70,17 +77,97 @@ NrUeAiScheduler::GetTypeId (void)
                    "Epsilon decay rate for RLA",
                    DoubleValue (0.995),
                    MakeDoubleAccessor (&NrUeAiScheduler::m_epsilonDecay),
-                   MakeDoubleChecker<double> ());
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("MetricsFile",
+                   "Prefix of the binary metrics files (<prefix>.window.nrum and, when enabled, "
+                   "<prefix>.ue.nrum and <prefix>.slot.nrum); empty to write none",
+                   StringValue (""),
+                   MakeStringAccessor (&NrUeAiScheduler::m_metricsFile),
+                   MakeStringChecker ())
+    .AddAttribute ("MetricsPerUe",
+                   "Write one metrics row per UE and decision window",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrUeAiScheduler::m_metricsPerUe),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MetricsPerSlot",
+                   "Write one metrics row per BWP and slot",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrUeAiScheduler::m_metricsPerSlot),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PerUeDelayHistograms",
+                   "Keep a HoL delay histogram per UE (832 bytes each) besides the per-BWP ones",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&NrUeAiScheduler::m_perUeDelayHistograms),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SummaryFile",
+                   "CSV performance_summary table the run merges its row into at the end "
+                   "(a markdown copy is written next to it); empty to write none",
+                   StringValue (""),
+                   MakeStringAccessor (&NrUeAiScheduler::m_summaryFile),
+                   MakeStringChecker ())
+    .AddAttribute ("SummaryLabel",
+                   "Algorithm column of the summary row, the algorithm name if empty; "
+                   "\"Baseline\" rows are the reference of the improvements",
+                   StringValue (""),
+                   MakeStringAccessor (&NrUeAiScheduler::m_summaryLabel),
+                   MakeStringChecker ())
+    .AddAttribute ("SummaryArrivalRate",
+                   "Arrival Rate column of the summary row",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrUeAiScheduler::m_summaryArrivalRate),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("SummaryStableStart",
+                   "Windows from this time on form the stable period summarized in the table "
+                   "(half the simulation time for the scripts' last-half average)",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NrUeAiScheduler::m_summaryStableStart),
+                   MakeTimeChecker ())
+    .AddAttribute ("SummaryEmaWeight",
+                   "Weight of the last window in the exponential moving averages of the summary row",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&NrUeAiScheduler::m_summaryEmaWeight),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("SummaryRollingWindows",
+                   "Windows averaged by the rolling means of the summary row",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&NrUeAiScheduler::m_summaryRollingWindows),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TraceFile",
+                   "Enable the binary slot trace (NrUTraceRing) and dump it to this file at "
+                   "the end, on a crash or on SIGUSR1 (decoded by nr_u_trace.py); empty for none. "
+                   "The trace rings are process-wide: only one scheduler at a time can set it",
+                   StringValue (""),
+                   MakeStringAccessor (&NrUeAiScheduler::m_traceFile),
+                   MakeStringChecker ())
+    .AddAttribute ("TraceCapacity",
+                   "Trace records kept per thread (32 bytes each), the oldest are overwritten",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&NrUeAiScheduler::m_traceCapacity),
+                   MakeUintegerChecker<uint32_t> (1, NrUTraceRing::MAX_CAPACITY))
+    .AddTraceSource ("WindowCollected",
+                     "Statistics of a decision window have been collected",
+                     MakeTraceSourceAccessor (&NrUeAiScheduler::m_windowCollectedTrace),
+                     "ns3::NrUeAiScheduler::WindowCollectedTracedCallback");
   return tid;
 }
 
 NrUeAiScheduler::NrUeAiScheduler ()
-  : m_currentTimeSlot (0),
+  : m_rlEnv (nullptr),
+    m_currentTimeSlot (0),
     m_currentWindow (0),
     m_algorithmType (RLA),
-    m_rlEnv (nullptr)
+    m_windowTotals (),
+    m_perUeDelayHistograms (true),
+    m_metricsPerUe (false),
+    m_metricsPerSlot (false),
+    m_droppedPackets (0),
+    m_summaryArrivalRate (0.0),
+    m_summaryEmaWeight (0.1),
+    m_summaryRollingWindows (10),
+    m_traceCapacity (1 << 20)
 {
   NS_LOG_FUNCTION (this);
+  m_uniformRandom = CreateObject<NrUUniformRandomVariable> ();
 }
 
 NrUeAiScheduler::~NrUeAiScheduler ()
@@ -103,7 +190,7 @@ NrUeAiScheduler::SetLbt (Ptr<NrUeLbt> lbt)
 }
 
 void
-NrUeAiScheduler::SetPhy (Ptr<NrUePhy> phy)
+NrUeAiScheduler::SetPhy (Ptr<NrUPhy> phy)
 {
   NS_LOG_FUNCTION (this << phy);
   m_phy = phy;
@@ -116,6 +203,125 @@ NrUeAiScheduler::SetGymEnv (Ptr<GymBwpRlEnv> rlEnv)
   m_rlEnv = rlEnv;
 }
 
+const std::vector<NrUeAiScheduler::UeStats>&
+NrUeAiScheduler::GetUeStats (void) const
+{
+  return m_ueStats;
+}
+
+const std::vector<NrUeAiScheduler::BwpStats>&
+NrUeAiScheduler::GetBwpStats (void) const
+{
+  return m_bwpStats;
+}
+
+const NrUeAiScheduler::WindowTotals&
+NrUeAiScheduler::GetWindowTotals (void) const
+{
+  return m_windowTotals;
+}
+
+const NrUDelayHistogram&
+NrUeAiScheduler::GetHolDelayHistogram (uint16_t ueId) const
+{
+  static const NrUDelayHistogram empty;
+  return ueId < m_ueHolDelay.size () ? m_ueHolDelay[ueId] : empty;
+}
+
+const NrUDelayHistogram&
+NrUeAiScheduler::GetBwpHolDelayHistogram (uint16_t bwpId) const
+{
+  static const NrUDelayHistogram empty;
+  return bwpId < m_bwpHolDelay.size () ? m_bwpHolDelay[bwpId] : empty;
+}
+
+const NrUStreamingMetric&
+NrUeAiScheduler::GetSummaryMetric (SummaryMetric metric) const
+{
+  return m_summary[metric];
+}
+
+uint32_t
+NrUeAiScheduler::GetNumUes (void) const
+{
+  return m_bwpManager->GetUeMap ().size ();
+}
+
+uint16_t
+NrUeAiScheduler::GetNumBwps (void) const
+{
+  return m_bwpManager->GetNumBwps ();
+}
+
+uint16_t
+NrUeAiScheduler::GetNumRbs (uint16_t bwpId) const
+{
+  return m_bwpManager->GetNumRbs (bwpId);
+}
+
+void
+NrUeAiScheduler::SwitchBwp (uint16_t ueId, uint16_t bwpId)
+{
+  NS_LOG_FUNCTION (this << ueId << bwpId);
+  m_bwpManager->SwitchBwp (ueId, bwpId);
+}
+
+void
+NrUeAiScheduler::SwitchBwps (const std::vector<uint16_t>& ueIds, const std::vector<uint16_t>& bwpIds)
+{
+  NS_LOG_FUNCTION (this << ueIds.size ());
+  m_bwpManager->SwitchBwps (ueIds, bwpIds);
+}
+
+int64_t
+NrUeAiScheduler::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_uniformRandom->SetStream (stream);
+  return 1 + m_lbt->AssignStreams (stream + 1);
+}
+
+void
+NrUeAiScheduler::SaveState (Snapshot& snapshot) const
+{
+  NS_LOG_FUNCTION (this);
+  snapshot.currentTimeSlot = m_currentTimeSlot;
+  snapshot.currentWindow = m_currentWindow;
+  snapshot.epsilon = m_epsilon;
+  snapshot.bwpStats = m_bwpStats;
+  snapshot.ueStats = m_ueStats;
+  snapshot.windowTotals = m_windowTotals;
+  snapshot.droppedPackets = m_droppedPackets;
+  snapshot.windowEventDelay = Simulator::GetDelayLeft (m_windowEvent);
+  m_uniformRandom->SaveState (snapshot.rng);
+  m_bwpManager->SaveState (snapshot.bwpManager);
+  m_lbt->SaveState (snapshot.lbt);
+  m_phy->SaveState (snapshot.phy);
+}
+
+void
+NrUeAiScheduler::RestoreState (const Snapshot& snapshot)
+{
+  NS_LOG_FUNCTION (this);
+  m_currentTimeSlot = snapshot.currentTimeSlot;
+  m_currentWindow = snapshot.currentWindow;
+  m_epsilon = snapshot.epsilon;
+  m_bwpStats = snapshot.bwpStats;
+  m_ueStats = snapshot.ueStats;
+  m_windowTotals = snapshot.windowTotals;
+  m_droppedPackets = snapshot.droppedPackets;
+ 
+  m_windowEvent.Cancel ();
+  m_windowEvent = Simulator::Schedule (snapshot.windowEventDelay,
+                                       &NrUeAiScheduler::RunDecisionWindow, this);
+ 
+  m_uniformRandom->RestoreState (snapshot.rng);
+  m_bwpManager->RestoreState (snapshot.bwpManager);
+  m_lbt->RestoreState (snapshot.lbt);
+  m_phy->RestoreState (snapshot.phy);
+  NS_LOG_INFO ("Restored window " << m_currentWindow);
+}
+
 void
 NrUeAiScheduler::DoInitialize ()
 {
@@ -123,6 +329,7 @@ NrUeAiScheduler::DoInitialize ()
  
   // Initialize BWP statistics
   uint16_t numBwps = m_bwpManager->GetNumBwps ();
+  m_bwpStats.reserve (numBwps);
   for (uint16_t i = 0; i < numBwps; ++i)
   {
     BwpStats stats;
@@ -135,9 +342,34 @@ NrUeAiScheduler::DoInitialize ()
     stats.totalCollisions = 0;
     m_bwpStats.push_back (stats);
   }
+  m_bwpHolDelay.assign (numBwps, NrUDelayHistogram ());
+ 
+  for (auto& metric : m_summary)
+  {
+    metric.Configure (m_summaryEmaWeight, m_summaryRollingWindows);
+  }
+ 
+  if (!m_metricsFile.empty ())
+  {
+    OpenMetrics ();
+  }
+ 
+  if (!m_traceFile.empty ())
+  {
+    // Another scheduler's events would land in the same rings and file
+    if (NrUTraceRing::IsEnabled ())
+    {
+      NS_FATAL_ERROR ("TraceFile is already set on another scheduler, the trace rings are shared");
+    }
+    NrUTraceRing::Enable (m_traceCapacity);
+    if (!NrUTraceRing::InstallSignalHandlers (m_traceFile))
+    {
+      NS_LOG_WARN ("Trace " << m_traceFile << " will not be dumped on crash");
+    }
+  }
  
   // Schedule first decision window
-  Simulator::Schedule (MilliSeconds (0), &NrUeAiScheduler::RunDecisionWindow, this);
+  m_windowEvent = Simulator::Schedule (MilliSeconds (0), &NrUeAiScheduler::RunDecisionWindow, this);
 }
 
 void
@@ -145,26 +377,41 @@ NrUeAiScheduler::RunDecisionWindow ()
 {
   NS_LOG_FUNCTION (this);
  
+  // Schedule next decision window first, so a snapshot taken while the
+  // agent is stepped sees it pending
+  m_windowEvent = Simulator::Schedule (MilliSeconds (m_timeWindowSize * 0.5), // Assuming 0.5ms slots
+                                       &NrUeAiScheduler::RunDecisionWindow, this);
+ 
   // Collect statistics over the window
   CollectWindowStatistics ();
+  UpdateSummary ();
+  m_windowCollectedTrace (m_currentWindow);
+  if (m_windowMetrics.IsOpen ())
+  {
+    WriteWindowMetrics ();
+  }
  
   // Make BWP assignment decision
+  NrUTraceRing::Write (NrUTraceRing::DECISION, Simulator::Now ().GetNanoSeconds (), 0,
+                       m_ueStats.size (), m_currentWindow, m_algorithmType);
   if (m_algorithmType == LCA)
   {
     AssignBwpsLca ();
   }
-  else
+  else if (m_algorithmType == RLA)
   {
     AssignBwpsRla ();
   }
+  else if (m_rlEnv)
+  {
+    // External agent: hand over the window state and apply its action
+    m_rlEnv->NotifyCurrentState ();
+  }
  
   // Reset window statistics
   ResetWindowStatistics ();
  
-  // Schedule next decision window
   m_currentWindow++;
-  Simulator::Schedule (MilliSeconds (m_timeWindowSize * 0.5), // Assuming 0.5ms slots
-                      &NrUeAiScheduler::RunDecisionWindow, this);
 }
 
 void
@@ -184,9 +431,12 @@ NrUeAiScheduler::CollectWindowStatistics ()
                         0.1 * m_phy->GetAvgBitsPerRb (stats.bwpId);
   }
  
-  // Collect UE statistics
+  // Collect UE statistics, summing the reward terms on the same pass
   m_ueStats.clear ();
-  auto ueMap = m_bwpManager->GetUeMap ();
+  m_windowTotals = WindowTotals ();
+  m_windowHolDelay.Reset ();
+  uint64_t dropped = 0;
+  const auto& ueMap = m_bwpManager->GetUeMap ();
   for (const auto& uePair : ueMap)
   {
     UeStats stats;
@@ -197,7 +447,48 @@ NrUeAiScheduler::CollectWindowStatistics ()
     stats.throughput = m_phy->GetThroughput (uePair.first);
     stats.avgBitsPerRb = m_phy->GetUeAvgBitsPerRb (uePair.first);
     m_ueStats.push_back (stats);
+ 
+    m_windowTotals.holDelaySum += stats.holDelay;
+    m_windowTotals.maxHolDelay = std::max (m_windowTotals.maxHolDelay, stats.holDelay);
+    m_windowTotals.throughputSum += stats.throughput;
+    m_windowTotals.queueSizeSum += stats.queueSize;
+    dropped += m_phy->GetDroppedPackets (uePair.first);
+ 
+    // HoL delays are whole slots
+    uint32_t holDelay = static_cast<uint32_t> (stats.holDelay);
+    m_windowHolDelay.Record (holDelay);
+    if (stats.currentBwp < m_bwpHolDelay.size ())
+    {
+      m_bwpHolDelay[stats.currentBwp].Record (holDelay);
+    }
+    if (m_perUeDelayHistograms)
+    {
+      if (stats.ueId >= m_ueHolDelay.size ())
+      {
+        m_ueHolDelay.resize (stats.ueId + 1);
+      }
+      m_ueHolDelay[stats.ueId].Record (holDelay);
+    }
   }
+  m_windowTotals.numUes = m_ueStats.size ();
+  m_windowTotals.holDelayP50 = m_windowHolDelay.GetValueAtPercentile (50);
+  m_windowTotals.holDelayP95 = m_windowHolDelay.GetValueAtPercentile (95);
+  m_windowTotals.holDelayP99 = m_windowHolDelay.GetValueAtPercentile (99);
+ 
+  m_windowQueueingDelay.Reset ();
+  m_phy->CollectQueueingDelays (m_windowQueueingDelay);
+  m_windowTotals.queueingDelayP50 = m_windowQueueingDelay.GetValueAtPercentile (50);
+  m_windowTotals.queueingDelayP95 = m_windowQueueingDelay.GetValueAtPercentile (95);
+  m_windowTotals.queueingDelayP99 = m_windowQueueingDelay.GetValueAtPercentile (99);
+  NS_LOG_INFO ("Window " << m_currentWindow << " HoL delay p50/p95/p99 "
+               << m_windowTotals.holDelayP50 << "/" << m_windowTotals.holDelayP95 << "/"
+               << m_windowTotals.holDelayP99 << ", queueing delay p50/p95/p99 "
+               << m_windowTotals.queueingDelayP50 << "/" << m_windowTotals.queueingDelayP95 << "/"
+               << m_windowTotals.queueingDelayP99 << " slots");
+ 
+  // Tail drops are cumulative in the PHY; the window gets the increase
+  m_windowTotals.dropped = dropped >= m_droppedPackets ? dropped - m_droppedPackets : 0;
+  m_droppedPackets = dropped;
 }
 
 void
@@ -294,37 +585,191 @@ NrUeAiScheduler::AssignBwpsRla ()
   Ptr<OpenGymSpace> currentState = m_rlEnv->GetObservationSpace ();
  
   // Get action from RL agent (epsilon-greedy)
-  Ptr<OpenGymDataContainer> actionContainer;
-  if ((rand () / (double)RAND_MAX) < m_epsilon)
+  if (m_uniformRandom->GetValue () < m_epsilon)
   {
-    // Random action
-    actionContainer = m_rlEnv->GetActionSpace ()->Sample ();
+    // Random action: a uniformly drawn BWP per entry of the action space
+    std::vector<uint32_t> choices (m_rlEnv->GetActionSize ());
+    uint32_t numBwps = m_bwpManager->GetNumBwps ();
+    for (auto& choice : choices)
+    {
+      choice = m_uniformRandom->GetInteger (0, numBwps > 0 ? numBwps - 1 : 0);
+    }
+    m_rlEnv->ApplyActions (choices.data (), choices.size ());
     NS_LOG_INFO ("RLA taking random action (exploration)");
   }
   else
   {
     // Greedy action from RL model
-    actionContainer = m_rlEnv->GetOptimalAction (currentState);
+    m_rlEnv->ExecuteActions (m_rlEnv->GetOptimalAction (currentState));
     NS_LOG_INFO ("RLA taking optimal action (exploitation)");
   }
  
-  // Execute action (assign BWPs)
-  std::vector<uint16_t> assignments = m_rlEnv->ExecuteAction (actionContainer);
- 
   // Update epsilon
   m_epsilon = std::max (m_epsilon * m_epsilonDecay, m_epsilonMin);
  
   // Log assignments
-  for (size_t i = 0; i < assignments.size (); ++i)
+  for (const auto& ue : m_ueStats)
   {
-    NS_LOG_DEBUG ("RLA assigned UE " << m_ueStats[i].ueId << " to BWP " << assignments[i]);
+    NS_LOG_DEBUG ("RLA assigned UE " << ue.ueId << " to BWP " << m_bwpManager->GetUeBwp (ue.ueId));
   }
 }
 
+void
+NrUeAiScheduler::OpenMetrics ()
+{
+  NS_LOG_FUNCTION (this);
+ 
+  typedef NrUMetricsWriter W;
+  bool opened = m_windowMetrics.Open (m_metricsFile + ".window.nrum",
+                                      {{"Window", W::UINT32}, {"Time", W::FLOAT64},
+                                       {"NumUes", W::UINT32}, {"AvgHolDelay", W::FLOAT64},
+                                       {"MaxHolDelay", W::FLOAT64}, {"TotalThroughput", W::FLOAT64},
+                                       {"QueuedPackets", W::FLOAT64}, {"Dropped", W::UINT64},
+                                       {"HolDelayP50", W::UINT32}, {"HolDelayP95", W::UINT32},
+                                       {"HolDelayP99", W::UINT32}, {"QueueingDelayP50", W::UINT32},
+                                       {"QueueingDelayP95", W::UINT32}, {"QueueingDelayP99", W::UINT32},
+                                       {"Reward", W::FLOAT64}},
+                                      1024);
+  if (opened && m_metricsPerUe)
+  {
+    opened = m_ueMetrics.Open (m_metricsFile + ".ue.nrum",
+                               {{"Window", W::UINT32}, {"Ue", W::UINT32}, {"Bwp", W::UINT32},
+                                {"QueuedPackets", W::UINT32}, {"HolDelay", W::FLOAT32},
+                                {"Throughput", W::FLOAT32}, {"BitsPerRb", W::FLOAT32}});
+  }
+  if (opened && m_metricsPerSlot)
+  {
+    opened = m_slotMetrics.Open (m_metricsFile + ".slot.nrum",
+                                 {{"Time", W::FLOAT64}, {"Bwp", W::UINT32}, {"ScheduledUes", W::UINT32},
+                                  {"Bits", W::UINT64}, {"Rbs", W::UINT32}});
+    m_phy->TraceConnectWithoutContext ("SlotAllocation",
+                                       MakeCallback (&NrUeAiScheduler::RecordSlotMetrics, this));
+  }
+  if (!opened)
+  {
+    NS_FATAL_ERROR ("Cannot create the metrics files " << m_metricsFile << ".*.nrum");
+  }
+}
+
+void
+NrUeAiScheduler::WriteWindowMetrics ()
+{
+  const WindowTotals& totals = m_windowTotals;
+  double avgHolDelay = totals.numUes > 0 ? totals.holDelaySum / totals.numUes : 0.0;
+  // The reward the environment hands the agent for this window, NaN without one
+  double reward = m_rlEnv ? m_rlEnv->GetReward () : std::nan ("");
+  m_windowMetrics.Append ({double (m_currentWindow), Simulator::Now ().GetSeconds (),
+                           double (totals.numUes), avgHolDelay, totals.maxHolDelay,
+                           totals.throughputSum, totals.queueSizeSum, double (totals.dropped),
+                           totals.holDelayP50, totals.holDelayP95, totals.holDelayP99,
+                           totals.queueingDelayP50, totals.queueingDelayP95, totals.queueingDelayP99,
+                           reward});
+ 
+  if (m_ueMetrics.IsOpen ())
+  {
+    for (const auto& ue : m_ueStats)
+    {
+      m_ueMetrics.Append ({double (m_currentWindow), double (ue.ueId), double (ue.currentBwp),
+                           double (ue.queueSize), ue.holDelay, ue.throughput, ue.avgBitsPerRb});
+    }
+  }
+}
+
+void
+NrUeAiScheduler::RecordSlotMetrics (uint16_t bwpId, uint32_t scheduledUes, uint64_t bits, uint32_t rbs)
+{
+  m_slotMetrics.Append ({Simulator::Now ().GetSeconds (), double (bwpId), double (scheduledUes),
+                         double (bits), double (rbs)});
+}
+
+void
+NrUeAiScheduler::LogDelayPercentiles () const
+{
+  for (uint16_t bwpId = 0; bwpId < m_bwpHolDelay.size (); ++bwpId)
+  {
+    const NrUDelayHistogram& hol = m_bwpHolDelay[bwpId];
+    const NrUDelayHistogram& queueing = m_phy->GetBwpQueueingDelayHistogram (bwpId);
+    NS_LOG_INFO ("BWP " << bwpId << " HoL delay p50/p95/p99 "
+                 << hol.GetValueAtPercentile (50) << "/" << hol.GetValueAtPercentile (95) << "/"
+                 << hol.GetValueAtPercentile (99) << " over " << hol.GetCount ()
+                 << " samples, queueing delay p50/p95/p99 "
+                 << queueing.GetValueAtPercentile (50) << "/" << queueing.GetValueAtPercentile (95)
+                 << "/" << queueing.GetValueAtPercentile (99) << " over " << queueing.GetCount ()
+                 << " packets");
+  }
+}
+
+void
+NrUeAiScheduler::UpdateSummary ()
+{
+  const WindowTotals& totals = m_windowTotals;
+  bool stable = Simulator::Now () >= m_summaryStableStart;
+  double avgHolDelay = totals.numUes > 0 ? totals.holDelaySum / totals.numUes : 0.0;
+  m_summary[SUMMARY_HOL_DELAY].Add (avgHolDelay, stable);
+  m_summary[SUMMARY_THROUGHPUT].Add (totals.throughputSum, stable);
+  m_summary[SUMMARY_DROPPED].Add (totals.dropped, stable);
+}
+
+void
+NrUeAiScheduler::WriteSummary ()
+{
+  NS_LOG_FUNCTION (this);
+ 
+  static const char* algorithmNames[] = {"LCA", "RLA", "External"};
+  const NrUOnlineStats& delay = m_summary[SUMMARY_HOL_DELAY].GetStable ();
+  const NrUOnlineStats& throughput = m_summary[SUMMARY_THROUGHPUT].GetStable ();
+  const NrUOnlineStats& dropped = m_summary[SUMMARY_DROPPED].GetStable ();
+ 
+  NrUPerformanceSummary::Row row;
+  row.algorithm = m_summaryLabel.empty () ? algorithmNames[m_algorithmType] : m_summaryLabel;
+  row.arrivalRate = m_summaryArrivalRate;
+  row.windows = m_summary[SUMMARY_HOL_DELAY].GetAll ().GetCount ();
+  row.stableWindows = delay.GetCount ();
+  row.holDelay = delay.GetMean ();
+  row.holDelayCi95 = delay.GetCi95 ();
+  row.throughput = throughput.GetMean ();
+  row.throughputCi95 = throughput.GetCi95 ();
+  row.dropped = dropped.GetMean ();
+  row.droppedCi95 = dropped.GetCi95 ();
+  row.holDelayEma = m_summary[SUMMARY_HOL_DELAY].GetEma ().GetValue ();
+  row.holDelayRolling = m_summary[SUMMARY_HOL_DELAY].GetRolling ().GetMean ();
+  row.throughputEma = m_summary[SUMMARY_THROUGHPUT].GetEma ().GetValue ();
+  row.throughputRolling = m_summary[SUMMARY_THROUGHPUT].GetRolling ().GetMean ();
+  if (!NrUPerformanceSummary::Update (m_summaryFile, row))
+  {
+    NS_LOG_ERROR ("Cannot update the summary table " << m_summaryFile);
+    return;
+  }
+  NS_LOG_INFO (row.algorithm << ": HoL delay " << row.holDelay << " +- " << row.holDelayCi95
+               << " (EMA " << row.holDelayEma << "), throughput "
+               << row.throughput << " +- " << row.throughputCi95
+               << " (EMA " << row.throughputEma << ") over "
+               << row.stableWindows << " stable windows");
+}
+
 void
 NrUeAiScheduler::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
+  if (!m_summaryFile.empty ())
+  {
+    WriteSummary ();
+  }
+  if (m_phy)
+  {
+    LogDelayPercentiles ();
+  }
+  if (!m_traceFile.empty ())
+  {
+    if (!NrUTraceRing::Dump (m_traceFile.c_str ()))
+    {
+      NS_LOG_ERROR ("Cannot write the trace " << m_traceFile);
+    }
+    NrUTraceRing::Disable ();
+  }
+  m_windowMetrics.Close ();
+  m_ueMetrics.Close ();
+  m_slotMetrics.Close ();
   m_bwpManager = nullptr;
   m_lbt = nullptr;
   m_phy = nullptr;
@@ -23,15 +23,23 @@
 
 #include "ns3/object.h"
 #include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include "ns3/event-id.h"
+#include "ns3/nr-u-bwp-manager.h"
+#include "ns3/nr-u-lbt.h"
+#include "ns3/nr-u-random-variable.h"
+#include "ns3/nr-u-phy.h"
+#include "ns3/nr-u-metrics-writer.h"
+#include "ns3/nr-u-online-stats.h"
+#include "ns3/nr-u-delay-histogram.h"
 #include <vector>
 #include <map>
+#include <string>
 
 namespace ns3 {
 
-class NrUeBwpManager;
-class NrUeLbt;
-class NrUePhy;
 class GymBwpRlEnv;
+class UniformRandomVariable;
 
 /**
  * \brief AI-based scheduler for NR-U Bandwidth Part assignment
@@ -48,7 +56,8 @@ public:
    */
   enum AlgorithmType {
     LCA,  ///< Least Collision Assignment
-    RLA   ///< Reinforcement Learning Assignment
+    RLA,  ///< Reinforcement Learning Assignment
+    EXTERNAL ///< Assignment left to an external agent (statistics only)
   };
 
   /**
@@ -76,7 +85,7 @@ public:
    * \brief Set the PHY layer
    * \param phy The PHY layer
    */
-  void SetPhy (Ptr<NrUePhy> phy);
+  void SetPhy (Ptr<NrUPhy> phy);
 
   /**
    * \brief Set the RL environment
@@ -84,11 +93,6 @@ public:
    */
   void SetGymEnv (Ptr<GymBwpRlEnv> rlEnv);
 
-protected:
-  virtual void DoInitialize (void);
-  virtual void DoDispose (void);
-
-private:
   /**
    * \brief BWP statistics structure
    */
@@ -114,6 +118,164 @@ private:
     double avgBitsPerRb;        ///< UE-specific bits per RB
   };
 
+  /**
+   * \brief Reward terms of a decision window, summed while the UE
+   * statistics are collected
+   */
+  struct WindowTotals {
+    uint32_t numUes;            ///< UEs in the window
+    double holDelaySum;         ///< Sum of HoL delays
+    double maxHolDelay;         ///< Largest HoL delay
+    double throughputSum;       ///< Total throughput
+    double queueSizeSum;        ///< Sum of queue sizes
+    uint64_t dropped;           ///< Packets tail-dropped in the window
+    double holDelayP50;         ///< Median HoL delay over the UEs
+    double holDelayP95;         ///< 95th percentile HoL delay over the UEs
+    double holDelayP99;         ///< 99th percentile HoL delay over the UEs
+    double queueingDelayP50;    ///< Median queueing delay of the packets served
+    double queueingDelayP95;    ///< 95th percentile queueing delay
+    double queueingDelayP99;    ///< 99th percentile queueing delay
+  };
+
+  /**
+   * \brief Get the UE statistics of the last decision window
+   * \return the per-UE statistics, valid until the next window
+   */
+  const std::vector<UeStats>& GetUeStats (void) const;
+
+  /**
+   * \brief Get the BWP statistics of the last decision window
+   * \return the per-BWP statistics, valid until the next window
+   */
+  const std::vector<BwpStats>& GetBwpStats (void) const;
+
+  /**
+   * \brief Get the reward terms of the last decision window
+   * \return the window totals, valid until the next window
+   */
+  const WindowTotals& GetWindowTotals (void) const;
+
+  /**
+   * \brief Get the HoL delays of a UE, one sample per decision window
+   * \param ueId The UE identifier
+   * \return the histogram in slots, empty for an unknown UE or without
+   *         PerUeDelayHistograms
+   */
+  const NrUDelayHistogram& GetHolDelayHistogram (uint16_t ueId) const;
+
+  /**
+   * \brief Get the HoL delays of the UEs of a BWP, one sample per UE and
+   * decision window
+   * \param bwpId The BWP identifier
+   * \return the histogram in slots, empty for an unknown BWP
+   */
+  const NrUDelayHistogram& GetBwpHolDelayHistogram (uint16_t bwpId) const;
+
+  /// Per-window metrics summarized while the simulation runs
+  enum SummaryMetric {
+    SUMMARY_HOL_DELAY,          ///< Average HoL delay of the window
+    SUMMARY_THROUGHPUT,         ///< Total throughput of the window
+    SUMMARY_DROPPED,            ///< Packets tail-dropped in the window
+    NUM_SUMMARY_METRICS
+  };
+
+  /**
+   * \brief Get the streaming summary of a per-window metric
+   * \param metric The metric
+   * \return its statistics over the windows so far
+   */
+  const NrUStreamingMetric& GetSummaryMetric (SummaryMetric metric) const;
+
+  /**
+   * \brief Get the number of attached UEs
+   * \return the number of UEs
+   */
+  uint32_t GetNumUes (void) const;
+
+  /**
+   * \brief Get the number of BWPs
+   * \return the number of BWPs
+   */
+  uint16_t GetNumBwps (void) const;
+
+  /**
+   * \brief Get the number of RBs of a BWP
+   * \param bwpId The BWP identifier
+   * \return the number of RBs
+   */
+  uint16_t GetNumRbs (uint16_t bwpId) const;
+
+  /**
+   * \brief Move a UE to another BWP
+   * \param ueId The UE identifier
+   * \param bwpId The new BWP identifier
+   */
+  void SwitchBwp (uint16_t ueId, uint16_t bwpId);
+
+  /**
+   * \brief Move several UEs to new BWPs in one batch
+   * \param ueIds The UE identifiers
+   * \param bwpIds The new BWP identifier of each UE
+   */
+  void SwitchBwps (const std::vector<uint16_t>& ueIds, const std::vector<uint16_t>& bwpIds);
+
+  /**
+   * \brief Assign fixed random variable stream numbers to the random
+   * variables used by the scheduler and its LBT component
+   * \param stream The first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * TracedCallback signature for the end of statistics collection.
+   * \param [in] window The index of the decision window
+   */
+  typedef void (* WindowCollectedTracedCallback)(uint32_t window);
+
+  /**
+   * \brief Scheduler state together with the state of its BWP manager, LBT
+   * and PHY, as saved by SaveState
+   */
+  struct Snapshot {
+    uint32_t currentTimeSlot;               ///< Current time slot
+    uint32_t currentWindow;                 ///< Current decision window
+    double epsilon;                         ///< Exploration rate
+    std::vector<BwpStats> bwpStats;         ///< BWP statistics
+    std::vector<UeStats> ueStats;           ///< UE statistics
+    WindowTotals windowTotals;              ///< Reward terms of the window
+    uint64_t droppedPackets;                ///< Tail drops up to the window
+    Time windowEventDelay;                  ///< Delay of the next decision window
+    NrUUniformRandomVariable::State rng;    ///< Exploration generator state
+    NrUeBwpManager::Snapshot bwpManager;    ///< BWP manager state
+    NrUeLbt::Snapshot lbt;                  ///< LBT state
+    NrUPhy::Snapshot phy;                   ///< PHY state
+  };
+
+  /**
+   * \brief Save the state of the scheduler and its components
+   *
+   * Pending events (next decision window, WiFi interference, BWP switch
+   * notifications) are saved with their remaining delay, random streams
+   * by the state of their generators.
+   *
+   * \param snapshot The snapshot to fill, its storage is reused
+   */
+  void SaveState (Snapshot& snapshot) const;
+
+  /**
+   * \brief Restore a saved state at the current simulation time
+   * \param snapshot The snapshot to restore
+   */
+  void RestoreState (const Snapshot& snapshot);
+
+protected:
+  virtual void DoInitialize (void);
+  virtual void DoDispose (void);
+
+private:
+  friend class NrUBenchmark; ///< Times the private steps (nr-u-bench.cc)
+
   // Core methods
   void RunDecisionWindow (void);
   void CollectWindowStatistics (void);
@@ -121,10 +283,22 @@ private:
   void AssignBwpsLca (void);
   void AssignBwpsRla (void);
 
+  // Binary metrics (MetricsFile)
+  void OpenMetrics (void);
+  void WriteWindowMetrics (void);
+  void RecordSlotMetrics (uint16_t bwpId, uint32_t scheduledUes, uint64_t bits, uint32_t rbs);
+
+  /// Log the delay percentiles of every BWP
+  void LogDelayPercentiles (void) const;
+
+  // Streaming summary (SummaryFile)
+  void UpdateSummary (void);
+  void WriteSummary (void);
+
   // Member variables
   Ptr<NrUeBwpManager> m_bwpManager; ///< BWP manager
   Ptr<NrUeLbt> m_lbt;               ///< LBT component
-  Ptr<NrUePhy> m_phy;               ///< PHY layer
+  Ptr<NrUPhy> m_phy;                ///< PHY layer
   Ptr<GymBwpRlEnv> m_rlEnv;         ///< RL environment
 
   uint32_t m_currentTimeSlot;       ///< Current time slot
@@ -137,9 +311,40 @@ private:
   double m_epsilon;                 ///< Exploration rate
   double m_epsilonMin;              ///< Minimum exploration rate
   double m_epsilonDecay;            ///< Exploration rate decay
+  Ptr<NrUUniformRandomVariable> m_uniformRandom; ///< Exploration draws
+  EventId m_windowEvent;            ///< Next decision window
+
+  /// Fired once the statistics of a decision window are collected
+  TracedCallback<uint32_t> m_windowCollectedTrace;
 
   std::vector<BwpStats> m_bwpStats; ///< BWP statistics
   std::vector<UeStats> m_ueStats;   ///< UE statistics
+  WindowTotals m_windowTotals;      ///< Reward terms of the last window
+
+  bool m_perUeDelayHistograms;      ///< Keep one HoL delay histogram per UE
+  std::vector<NrUDelayHistogram> m_ueHolDelay;  ///< Per UE identifier
+  std::vector<NrUDelayHistogram> m_bwpHolDelay; ///< Per BWP
+  NrUDelayHistogram m_windowHolDelay;           ///< HoL delays of the last window
+  NrUDelayHistogram m_windowQueueingDelay;      ///< Queueing delays of the last window
+
+  std::string m_metricsFile;        ///< Prefix of the metrics files, empty for none
+  bool m_metricsPerUe;              ///< Also write one row per UE and window
+  bool m_metricsPerSlot;            ///< Also write one row per BWP and slot
+  NrUMetricsWriter m_windowMetrics; ///< <prefix>.window.nrum
+  NrUMetricsWriter m_ueMetrics;     ///< <prefix>.ue.nrum
+  NrUMetricsWriter m_slotMetrics;   ///< <prefix>.slot.nrum
+  uint64_t m_droppedPackets;        ///< Tail drops up to the last window
+
+  std::string m_summaryFile;        ///< performance_summary table, empty for none
+  std::string m_summaryLabel;       ///< Algorithm column, the algorithm name if empty
+  double m_summaryArrivalRate;      ///< Arrival Rate column
+  Time m_summaryStableStart;        ///< Start of the stable period
+  double m_summaryEmaWeight;        ///< Weight of a window in the EMAs
+  uint32_t m_summaryRollingWindows; ///< Windows of the rolling means
+  NrUStreamingMetric m_summary[NUM_SUMMARY_METRICS]; ///< Per-window metric summaries
+
+  std::string m_traceFile;          ///< Dump file of the trace rings, empty for no tracing
+  uint32_t m_traceCapacity;         ///< Records per thread ring
 };
 
 } // namespace ns3
@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-shm-transport.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+namespace ns3 {
+
+static_assert (sizeof (std::atomic<uint32_t>) == sizeof (uint32_t)
+               && std::atomic<uint32_t>::is_always_lock_free,
+               "Futex words must be plain lock-free 32-bit integers");
+
+namespace {
+
+uint32_t
+SlotStride (uint32_t payloadBytes)
+{
+  // Slot header plus payload, rounded up to a cache line
+  return (16 + payloadBytes + 63) & ~63u;
+}
+
+} // anonymous namespace
+
+NrUShmTransport::NrUShmTransport ()
+  : m_base (nullptr),
+    m_bytes (0),
+    m_header (nullptr)
+{
+  static_assert (sizeof (Header) <= HEADER_BYTES, "Header does not fit its reserved space");
+}
+
+NrUShmTransport::~NrUShmTransport ()
+{
+  Close ();
+}
+
+bool
+NrUShmTransport::Open (const std::string& name, uint32_t obsSize, uint32_t actionSize, uint32_t depth)
+{
+  Close ();
+  if (depth == 0)
+  {
+    return false;
+  }
+
+  uint32_t obsStride = SlotStride (obsSize * sizeof (float));
+  uint32_t actStride = SlotStride (actionSize * sizeof (uint32_t));
+  std::size_t bytes = HEADER_BYTES + static_cast<std::size_t> (depth) * (obsStride + actStride);
+
+  std::string path = "/" + name;
+  shm_unlink (path.c_str ());
+  int fd = shm_open (path.c_str (), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0)
+  {
+    return false;
+  }
+  if (ftruncate (fd, bytes) != 0)
+  {
+    ::close (fd);
+    shm_unlink (path.c_str ());
+    return false;
+  }
+  void* base = mmap (nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close (fd);
+  if (base == MAP_FAILED)
+  {
+    shm_unlink (path.c_str ());
+    return false;
+  }
+
+  m_name = name;
+  m_base = static_cast<uint8_t*> (base);
+  m_bytes = bytes;
+  std::memset (m_base, 0, bytes);
+
+  // The segment starts zeroed, so the atomics are valid without construction;
+  // the magic is written last and tells the agent the layout is complete
+  m_header = reinterpret_cast<Header*> (m_base);
+  m_header->version = VERSION;
+  m_header->obsSize = obsSize;
+  m_header->actionSize = actionSize;
+  m_header->depth = depth;
+  m_header->obsStride = obsStride;
+  m_header->actStride = actStride;
+  std::atomic_thread_fence (std::memory_order_release);
+  m_header->magic = MAGIC;
+  return true;
+}
+
+void
+NrUShmTransport::Close (void)
+{
+  if (!m_base)
+  {
+    return;
+  }
+  m_header->closed.store (1, std::memory_order_release);
+  FutexWake (&m_header->obsSeq);
+  FutexWake (&m_header->actSeq);
+
+  munmap (m_base, m_bytes);
+  shm_unlink (("/" + m_name).c_str ());
+  m_base = nullptr;
+  m_header = nullptr;
+  m_bytes = 0;
+}
+
+bool
+NrUShmTransport::IsOpen (void) const
+{
+  return m_base != nullptr;
+}
+
+uint32_t
+NrUShmTransport::GetObsSize (void) const
+{
+  return m_header ? m_header->obsSize : 0;
+}
+
+uint32_t
+NrUShmTransport::GetActionSize (void) const
+{
+  return m_header ? m_header->actionSize : 0;
+}
+
+uint32_t
+NrUShmTransport::GetDepth (void) const
+{
+  return m_header ? m_header->depth : 0;
+}
+
+NrUShmTransport::SlotHeader*
+NrUShmTransport::ObsSlot (uint32_t seq) const
+{
+  std::size_t index = (seq - 1) % m_header->depth;
+  return reinterpret_cast<SlotHeader*> (m_base + HEADER_BYTES + index * m_header->obsStride);
+}
+
+NrUShmTransport::SlotHeader*
+NrUShmTransport::ActSlot (uint32_t seq) const
+{
+  std::size_t index = (seq - 1) % m_header->depth;
+  std::size_t actBase = HEADER_BYTES + static_cast<std::size_t> (m_header->depth) * m_header->obsStride;
+  return reinterpret_cast<SlotHeader*> (m_base + actBase + index * m_header->actStride);
+}
+
+float*
+NrUShmTransport::BeginObservation (void)
+{
+  uint32_t next = m_header->obsSeq.load (std::memory_order_relaxed) + 1;
+  return reinterpret_cast<float*> (ObsSlot (next) + 1);
+}
+
+uint32_t
+NrUShmTransport::CommitObservation (float reward, bool gameOver, uint32_t appliedSeq)
+{
+  uint32_t next = m_header->obsSeq.load (std::memory_order_relaxed) + 1;
+  SlotHeader* slot = ObsSlot (next);
+  slot->seq = next;
+  slot->flags = gameOver ? 1 : 0;
+  slot->reward = reward;
+  slot->appliedSeq = appliedSeq;
+  m_header->obsSeq.store (next, std::memory_order_release);
+  FutexWake (&m_header->obsSeq);
+  return next;
+}
+
+const uint32_t*
+NrUShmTransport::WaitAction (uint32_t seq, uint32_t timeoutMs)
+{
+  auto deadline = std::chrono::steady_clock::now () + std::chrono::milliseconds (timeoutMs);
+  while (true)
+  {
+    uint32_t current = m_header->actSeq.load (std::memory_order_acquire);
+    if (static_cast<int32_t> (current - seq) >= 0)
+    {
+      return reinterpret_cast<const uint32_t*> (ActSlot (seq) + 1);
+    }
+    if (m_header->closed.load (std::memory_order_acquire))
+    {
+      return nullptr;
+    }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds> (
+      deadline - std::chrono::steady_clock::now ()).count ();
+    if (left <= 0)
+    {
+      return nullptr;
+    }
+    FutexWait (&m_header->actSeq, current, left);
+  }
+}
+
+uint32_t
+NrUShmTransport::GetActionSeq (void) const
+{
+  return m_header ? m_header->actSeq.load (std::memory_order_acquire) : 0;
+}
+
+void
+NrUShmTransport::FutexWake (std::atomic<uint32_t>* word)
+{
+#ifdef __linux__
+  // Shared (not private) futex: the waiter lives in another process
+  syscall (SYS_futex, reinterpret_cast<uint32_t*> (word), FUTEX_WAKE, INT32_MAX,
+           nullptr, nullptr, 0);
+#else
+  (void) word;
+#endif
+}
+
+bool
+NrUShmTransport::FutexWait (std::atomic<uint32_t>* word, uint32_t expected, uint32_t timeoutMs)
+{
+#ifdef __linux__
+  struct timespec timeout;
+  timeout.tv_sec = timeoutMs / 1000;
+  timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+  return syscall (SYS_futex, reinterpret_cast<uint32_t*> (word), FUTEX_WAIT, expected,
+                  &timeout, nullptr, 0) == 0;
+#else
+  // Without futexes, back off briefly and let the caller re-check
+  (void) expected;
+  std::this_thread::sleep_for (std::chrono::microseconds (timeoutMs ? 50 : 0));
+  return word->load (std::memory_order_acquire) != expected;
+#endif
+}
+
+} // namespace ns3
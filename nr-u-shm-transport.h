@@ -0,0 +1,133 @@
+#ifndef NR_U_SHM_TRANSPORT_H
+#define NR_U_SHM_TRANSPORT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief Shared-memory ring between the simulation and a local agent
+ *
+ * Observations and actions are exchanged as raw arrays in a POSIX shared
+ * memory segment (/dev/shm/<name>), with futex signalling on Linux, so a
+ * step costs two memory copies at most and no serialization. The segment
+ * holds a header and two rings of Depth slots:
+ *
+ *   header       magic, version, sizes, closed flag, obsSeq, actSeq
+ *   obs slot k   seq, gameOver, reward, appliedSeq, obsSize floats
+ *   act slot k   seq, reserved, actionSize uint32 values
+ *
+ * The simulation writes observation n (n = 1, 2, ...) into obs slot
+ * (n - 1) % Depth and publishes it by storing n into obsSeq. The agent
+ * answers with the action of observation n in act slot (n - 1) % Depth and
+ * stores n into actSeq. Both sequence words are futex words, so either
+ * side can sleep until the other publishes. appliedSeq records which
+ * observation's action was in effect during the window that produced the
+ * observation (n - 1 when stepping synchronously, less with an action
+ * lag). The layout is mirrored by nr_u_shm.py, which gives the Python
+ * agent numpy views of the slots.
+ */
+class NrUShmTransport
+{
+public:
+  static constexpr uint32_t MAGIC = 0x4e525553;   ///< "NRUS"
+  static constexpr uint32_t VERSION = 2;          ///< Layout version
+
+  NrUShmTransport ();
+  ~NrUShmTransport ();
+
+  NrUShmTransport (const NrUShmTransport&) = delete;
+  NrUShmTransport& operator= (const NrUShmTransport&) = delete;
+
+  /**
+   * \brief Create the segment, replacing a stale one with the same name
+   * \param name The segment name, without the leading slash
+   * \param obsSize Floats per observation
+   * \param actionSize Values per action
+   * \param depth Slots per ring
+   * \return false if the segment cannot be created
+   */
+  bool Open (const std::string& name, uint32_t obsSize, uint32_t actionSize, uint32_t depth);
+
+  /// Mark the segment closed, wake the agent and unlink the segment
+  void Close (void);
+
+  bool IsOpen (void) const;
+  uint32_t GetObsSize (void) const;
+  uint32_t GetActionSize (void) const;
+  uint32_t GetDepth (void) const;
+
+  /**
+   * \brief Get the slot of the next observation, to be filled in place
+   * \return obsSize floats owned by the segment
+   */
+  float* BeginObservation (void);
+
+  /**
+   * \brief Publish the observation written through BeginObservation
+   * \param reward The reward of the step
+   * \param gameOver Whether the episode is over
+   * \param appliedSeq Observation whose action drove the last window, 0 if none
+   * \return the sequence number of the observation
+   */
+  uint32_t CommitObservation (float reward, bool gameOver, uint32_t appliedSeq);
+
+  /**
+   * \brief Wait for the action answering an observation
+   * \param seq The sequence number of the observation
+   * \param timeoutMs Maximum wait in milliseconds, 0 to only poll
+   * \return actionSize values owned by the segment, valid until the slot
+   *         is reused, or nullptr on timeout or if the agent closed the ring
+   */
+  const uint32_t* WaitAction (uint32_t seq, uint32_t timeoutMs);
+
+  /**
+   * \brief Get the sequence number of the last published action
+   * \return the action sequence number, 0 before the first action
+   */
+  uint32_t GetActionSeq (void) const;
+
+private:
+  /// Fixed part at the start of the segment
+  struct Header
+  {
+    uint32_t magic;                     ///< MAGIC once the layout is valid
+    uint32_t version;                   ///< VERSION
+    uint32_t obsSize;                   ///< Floats per observation
+    uint32_t actionSize;                ///< Values per action
+    uint32_t depth;                     ///< Slots per ring
+    uint32_t obsStride;                 ///< Bytes per observation slot
+    uint32_t actStride;                 ///< Bytes per action slot
+    std::atomic<uint32_t> closed;       ///< Non-zero once either side left
+    alignas (64) std::atomic<uint32_t> obsSeq;   ///< Last published observation
+    alignas (64) std::atomic<uint32_t> actSeq;   ///< Last published action
+  };
+
+  /// Header of every slot, followed by the payload
+  struct SlotHeader
+  {
+    uint32_t seq;                       ///< Sequence number held by the slot
+    uint32_t flags;                     ///< Observation: game over; action: unused
+    float reward;                       ///< Observation: reward; action: unused
+    uint32_t appliedSeq;                ///< Observation: action in effect; action: unused
+  };
+
+  static constexpr std::size_t HEADER_BYTES = 192;   ///< Header rounded up
+
+  SlotHeader* ObsSlot (uint32_t seq) const;
+  SlotHeader* ActSlot (uint32_t seq) const;
+  static void FutexWake (std::atomic<uint32_t>* word);
+  static bool FutexWait (std::atomic<uint32_t>* word, uint32_t expected, uint32_t timeoutMs);
+
+  std::string m_name;                   ///< Segment name
+  uint8_t* m_base;                      ///< Mapped segment
+  std::size_t m_bytes;                  ///< Mapped size
+  Header* m_header;                     ///< Header at m_base
+};
+
+} // namespace ns3
+
+#endif /* NR_U_SHM_TRANSPORT_H */
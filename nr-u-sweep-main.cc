@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Parameter sweep driver, replacing the hand-run bwp_metrics*.csv files and
+ * the pandas step of analysis_script.py:
+ *
+ *   nr-u-sweep --rates=0.0025,0.005,0.02,0.1,0.2,0.5 --algorithms=LCA,RLA \
+ *              --replications=20 --output=sweep_summary.csv
+ *
+ * Every list option takes comma-separated values; the summary has one row
+ * per combination with the mean and 95% confidence interval of each metric.
+ */
+
+#include "nr-u-sweep.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+namespace {
+
+template <typename T>
+bool
+ParseList (const std::string& text, std::vector<T>& out)
+{
+  out.clear ();
+  std::stringstream ss (text);
+  std::string item;
+  while (std::getline (ss, item, ','))
+  {
+    std::stringstream is (item);
+    T value;
+    if (!(is >> value))
+    {
+      return false;
+    }
+    out.push_back (value);
+  }
+  return !out.empty ();
+}
+
+void
+PrintUsage (void)
+{
+  std::cerr << "Usage: nr-u-sweep [--option=value ...]\n"
+            << "  --rates=LIST         Arrival rates, packets per UE and slot; 0 draws each UE's\n"
+            << "                       rate from U(0.1, 0.3), written as U(0.1;0.3)\n"
+            << "  --wifi=LIST          Mean WiFi busy probabilities\n"
+            << "  --alpha=LIST         Delay weights of the reward\n"
+            << "  --beta=LIST          Throughput weights of the reward\n"
+            << "  --windows=LIST       TimeWindowSize values, slots\n"
+            << "  --algorithms=LIST    LCA, RLA, Random\n"
+            << "  --replications=N     Replications per combination (10)\n"
+            << "  --slots=N            Simulated slots per replication (100000)\n"
+            << "  --warmup=F           Share of windows left out (0.2)\n"
+            << "  --ues=N              UEs (24)\n"
+            << "  --threads=N          Worker threads, 0 for all cores (0)\n"
+            << "  --seed=N             Base seed (1)\n"
+            << "  --output=FILE        Summary CSV, stdout if omitted\n";
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char* argv[])
+{
+  NrUFastSimConfig base = NrUFastSim::GetDefaultConfig ();
+  NrUSweepGrid grid;
+  uint32_t replications = 10;
+  uint64_t slots = 100000;
+  double warmup = 0.2;
+  uint32_t threads = 0;
+  uint64_t seed = 1;
+  std::string output;
+  bool ok = true;
+
+  for (int i = 1; i < argc && ok; ++i)
+  {
+    std::string arg = argv[i];
+    std::size_t eq = arg.find ('=');
+    std::string key = arg.substr (0, eq);
+    std::string value = eq == std::string::npos ? "" : arg.substr (eq + 1);
+    if (key == "--rates")
+    {
+      ok = ParseList (value, grid.arrivalRates);
+    }
+    else if (key == "--wifi")
+    {
+      ok = ParseList (value, grid.wifiMeans);
+    }
+    else if (key == "--alpha")
+    {
+      ok = ParseList (value, grid.alphas);
+    }
+    else if (key == "--beta")
+    {
+      ok = ParseList (value, grid.betas);
+    }
+    else if (key == "--windows")
+    {
+      ok = ParseList (value, grid.windowSizes);
+    }
+    else if (key == "--algorithms")
+    {
+      ok = ParseList (value, grid.algorithms);
+    }
+    else if (key == "--replications")
+    {
+      replications = std::strtoul (value.c_str (), nullptr, 10);
+    }
+    else if (key == "--slots")
+    {
+      slots = std::strtoull (value.c_str (), nullptr, 10);
+    }
+    else if (key == "--warmup")
+    {
+      warmup = std::strtod (value.c_str (), nullptr);
+    }
+    else if (key == "--ues")
+    {
+      base.numUes = std::strtoul (value.c_str (), nullptr, 10);
+    }
+    else if (key == "--threads")
+    {
+      threads = std::strtoul (value.c_str (), nullptr, 10);
+    }
+    else if (key == "--seed")
+    {
+      seed = std::strtoull (value.c_str (), nullptr, 10);
+    }
+    else if (key == "--output")
+    {
+      output = value;
+    }
+    else
+    {
+      ok = false;
+    }
+    if (!ok)
+    {
+      std::cerr << "Bad option " << arg << "\n";
+    }
+  }
+  if (!ok)
+  {
+    PrintUsage ();
+    return 1;
+  }
+
+  NrUSweep sweep (base);
+  sweep.SetReplications (replications);
+  sweep.SetDuration (slots);
+  sweep.SetWarmup (warmup);
+  sweep.SetThreads (threads);
+  sweep.SetSeed (seed);
+
+  auto start = std::chrono::steady_clock::now ();
+  if (!sweep.Run (grid))
+  {
+    std::cerr << "Unknown algorithm, expected LCA, RLA or Random\n";
+    return 1;
+  }
+  double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  std::cerr << sweep.GetSummaries ().size () << " combinations x " << replications
+            << " replications in " << elapsed << " s\n";
+
+  if (output.empty ())
+  {
+    sweep.WriteCsv (std::cout);
+    return 0;
+  }
+  std::ofstream file (output);
+  sweep.WriteCsv (file);
+  if (!file)
+  {
+    std::cerr << "Cannot write " << output << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,417 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-sweep.h"
+#include "nr-u-thread-pool.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+
+namespace ns3 {
+
+namespace {
+
+// QLearningAgent parameters of RL.py
+const double RLA_LEARNING_RATE = 0.01;
+const double RLA_GAMMA = 0.99;
+const double RLA_EPSILON = 1.0;
+const double RLA_EPSILON_MIN = 0.05;
+const double RLA_EPSILON_DECAY = 0.995;
+
+uint64_t
+Mix (uint64_t z)
+{
+  z += 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/// BWP choice at every window boundary
+class SweepAgent
+{
+public:
+  virtual ~SweepAgent () = default;
+
+  /**
+   * \param sim The engine, for the per-BWP view
+   * \param state Window state of the engine
+   * \param action BWP of every UE; holds the previous action on entry
+   */
+  virtual void Act (const NrUFastSim& sim, const int32_t* state, uint32_t* action) = 0;
+
+  virtual void Learn (const int32_t* /* state */, const uint32_t* /* action */, double /* reward */,
+                      const int32_t* /* nextState */)
+  {
+  }
+};
+
+/// NrUeAiScheduler::AssignBwpsLca on the engine's per-BWP view
+class LcaAgent : public SweepAgent
+{
+public:
+  explicit LcaAgent (const NrUFastSimConfig& config)
+    : m_config (config),
+      m_failureRate (config.numBwps, 0.0),
+      m_quality (config.numBwps, 1.0),
+      m_lastFailure (config.numBwps),
+      m_lastQuality (config.numBwps),
+      m_metric (config.numBwps)
+  {
+  }
+
+  void Act (const NrUFastSim& sim, const int32_t* /* state */, uint32_t* action) override
+  {
+    uint32_t numBwps = m_config.numBwps;
+    sim.GetBwpState (m_lastFailure.data (), m_lastQuality.data ());
+    uint32_t best = 0;
+    double total = 0.0;
+    for (uint32_t b = 0; b < numBwps; ++b)
+    {
+      // An unused BWP keeps its last failure rate
+      if (m_lastFailure[b] >= 0.0)
+      {
+        m_failureRate[b] = m_lastFailure[b];
+      }
+      m_quality[b] = 0.9 * m_quality[b] + 0.1 * m_lastQuality[b];
+      m_metric[b] = (1 - m_failureRate[b]) * m_quality[b] * m_config.bwpRbs[b];
+      total += m_metric[b];
+      best = m_metric[b] > m_metric[best] ? b : best;
+    }
+
+    uint32_t numUes = m_config.numUes;
+    if (numUes <= m_config.maxUesPerSlot || total <= 0.0)
+    {
+      std::fill (action, action + numUes, best);
+      return;
+    }
+    // Proportional split, UEs beyond the rounded counts keep their BWP
+    uint32_t ue = 0;
+    for (uint32_t b = 0; b < numBwps; ++b)
+    {
+      uint32_t share = std::round (numUes * (m_metric[b] / total));
+      for (uint32_t i = 0; i < share && ue < numUes; ++i, ++ue)
+      {
+        action[ue] = b;
+      }
+    }
+  }
+
+private:
+  NrUFastSimConfig m_config;
+  std::vector<double> m_failureRate;
+  std::vector<double> m_quality;
+  std::vector<double> m_lastFailure;
+  std::vector<double> m_lastQuality;
+  std::vector<double> m_metric;
+};
+
+/// QLearningAgent of RL.py: one BWP for every UE, epsilon-greedy
+class RlaAgent : public SweepAgent
+{
+public:
+  RlaAgent (const NrUFastSimConfig& config, uint64_t seed)
+    : m_numUes (config.numUes),
+      m_numBwps (config.numBwps),
+      m_epsilon (RLA_EPSILON),
+      m_rng (seed)
+  {
+  }
+
+  void Act (const NrUFastSim& /* sim */, const int32_t* state, uint32_t* action) override
+  {
+    if (std::uniform_real_distribution<double> (0.0, 1.0) (m_rng) < m_epsilon)
+    {
+      std::uniform_int_distribution<uint32_t> bwp (0, m_numBwps - 1);
+      for (uint32_t ue = 0; ue < m_numUes; ++ue)
+      {
+        action[ue] = bwp (m_rng);
+      }
+      return;
+    }
+    const std::vector<double>& q = GetQ (state);
+    uint32_t best = std::max_element (q.begin (), q.end ()) - q.begin ();
+    std::fill (action, action + m_numUes, best);
+  }
+
+  void Learn (const int32_t* state, const uint32_t* action, double reward, const int32_t* nextState) override
+  {
+    const std::vector<double>& next = GetQ (nextState);
+    double nextMax = *std::max_element (next.begin (), next.end ());
+    double& q = GetQ (state)[action[0]];
+    q = (1 - RLA_LEARNING_RATE) * q + RLA_LEARNING_RATE * (reward + RLA_GAMMA * nextMax);
+    m_epsilon = std::max (RLA_EPSILON_MIN, m_epsilon * RLA_EPSILON_DECAY);
+  }
+
+private:
+  std::vector<double>& GetQ (const int32_t* state)
+  {
+    std::vector<double>& q = m_table[std::vector<int32_t> (state, state + 3 * m_numBwps)];
+    q.resize (m_numBwps, 0.0);
+    return q;
+  }
+
+  uint32_t m_numUes;
+  uint32_t m_numBwps;
+  double m_epsilon;
+  std::mt19937_64 m_rng;
+  std::map<std::vector<int32_t>, std::vector<double>> m_table;   ///< Q-values per window state
+};
+
+/// A uniformly random BWP per UE, the exploration baseline
+class RandomAgent : public SweepAgent
+{
+public:
+  RandomAgent (const NrUFastSimConfig& config, uint64_t seed)
+    : m_numUes (config.numUes),
+      m_bwp (0, config.numBwps - 1),
+      m_rng (seed)
+  {
+  }
+
+  void Act (const NrUFastSim& /* sim */, const int32_t* /* state */, uint32_t* action) override
+  {
+    for (uint32_t ue = 0; ue < m_numUes; ++ue)
+    {
+      action[ue] = m_bwp (m_rng);
+    }
+  }
+
+private:
+  uint32_t m_numUes;
+  std::uniform_int_distribution<uint32_t> m_bwp;
+  std::mt19937_64 m_rng;
+};
+
+std::unique_ptr<SweepAgent>
+CreateAgent (const std::string& algorithm, const NrUFastSimConfig& config, uint64_t seed)
+{
+  if (algorithm == "LCA")
+  {
+    return std::unique_ptr<SweepAgent> (new LcaAgent (config));
+  }
+  if (algorithm == "RLA")
+  {
+    return std::unique_ptr<SweepAgent> (new RlaAgent (config, seed));
+  }
+  return std::unique_ptr<SweepAgent> (new RandomAgent (config, seed));
+}
+
+} // anonymous namespace
+
+NrUSweep::NrUSweep (const NrUFastSimConfig& base)
+  : m_base (base),
+    m_replications (10),
+    m_duration (100000),
+    m_warmup (0.2),
+    m_seed (1),
+    m_numThreads (0)
+{
+}
+
+void
+NrUSweep::SetReplications (uint32_t replications)
+{
+  m_replications = std::max (1u, replications);
+}
+
+void
+NrUSweep::SetDuration (uint64_t slots)
+{
+  m_duration = slots;
+}
+
+void
+NrUSweep::SetWarmup (double fraction)
+{
+  m_warmup = std::max (0.0, std::min (fraction, 1.0));
+}
+
+void
+NrUSweep::SetSeed (uint64_t seed)
+{
+  m_seed = seed;
+}
+
+void
+NrUSweep::SetThreads (uint32_t numThreads)
+{
+  m_numThreads = numThreads;
+}
+
+bool
+NrUSweep::IsKnownAlgorithm (const std::string& algorithm)
+{
+  return algorithm == "LCA" || algorithm == "RLA" || algorithm == "Random";
+}
+
+const std::vector<NrUSweepSummary>&
+NrUSweep::GetSummaries (void) const
+{
+  return m_summaries;
+}
+
+NrUFastSimConfig
+NrUSweep::MakeConfig (const NrUSweepPoint& point, uint64_t seed) const
+{
+  NrUFastSimConfig config = m_base;
+  config.arrivalRate = point.arrivalRate;
+  config.alpha = point.alpha;
+  config.beta = point.beta;
+  config.slotsPerWindow = std::max (1u, point.windowSize);
+  config.seed = seed;
+
+  // Scale the base WiFi profile to the requested mean, keeping its shape
+  uint32_t numBwps = std::max (1u, std::min<uint32_t> (config.numBwps, NR_U_FAST_SIM_MAX_BWPS));
+  double mean = 0.0;
+  for (uint32_t b = 0; b < numBwps; ++b)
+  {
+    mean += config.wifiInterference[b] / numBwps;
+  }
+  for (uint32_t b = 0; b < numBwps; ++b)
+  {
+    double busy = mean > 0.0 ? config.wifiInterference[b] * point.wifiMean / mean : point.wifiMean;
+    config.wifiInterference[b] = std::max (0.0, std::min (busy, 1.0));
+  }
+  return config;
+}
+
+NrUSweep::Replication
+NrUSweep::RunReplication (const NrUSweepPoint& point, uint64_t seed) const
+{
+  NrUFastSim sim (MakeConfig (point, seed));
+  const NrUFastSimConfig& config = sim.GetConfig ();
+  std::unique_ptr<SweepAgent> agent = CreateAgent (point.algorithm, config, Mix (seed));
+
+  std::vector<int32_t> state (3 * config.numBwps);
+  std::vector<int32_t> nextState (state.size ());
+  std::vector<uint32_t> action (config.numUes, 0);
+  sim.Reset (state.data ());
+
+  uint64_t windows = std::max<uint64_t> (1, m_duration / config.slotsPerWindow);
+  uint64_t warmup = std::min<uint64_t> (windows - 1, windows * m_warmup);
+  Replication mean;
+  for (uint64_t w = 0; w < windows; ++w)
+  {
+    agent->Act (sim, state.data (), action.data ());
+    NrUFastSimResult result = sim.Step (action.data (), nextState.data ());
+    agent->Learn (state.data (), action.data (), result.reward, nextState.data ());
+    state.swap (nextState);
+    if (w >= warmup)
+    {
+      mean.reward += result.reward;
+      mean.holDelay += result.avgHolDelay;
+      mean.throughput += result.throughput;
+      mean.lbtSuccessRate += result.lbtSuccessRate;
+      mean.dropped += result.droppedPackets;
+    }
+  }
+  double counted = windows - warmup;
+  mean.reward /= counted;
+  mean.holDelay /= counted;
+  mean.throughput /= counted;
+  mean.lbtSuccessRate /= counted;
+  mean.dropped /= counted;
+  return mean;
+}
+
+bool
+NrUSweep::Run (const NrUSweepGrid& grid)
+{
+  for (const std::string& algorithm : grid.algorithms)
+  {
+    if (!IsKnownAlgorithm (algorithm))
+    {
+      return false;
+    }
+  }
+
+  // Arrival rate innermost, algorithm outermost
+  m_summaries.clear ();
+  for (const std::string& algorithm : grid.algorithms)
+    for (double wifiMean : grid.wifiMeans)
+      for (double alpha : grid.alphas)
+        for (double beta : grid.betas)
+          for (uint32_t windowSize : grid.windowSizes)
+            for (double arrivalRate : grid.arrivalRates)
+            {
+              NrUSweepSummary summary;
+              summary.point = {arrivalRate, wifiMean, alpha, beta, windowSize, algorithm};
+              m_summaries.push_back (summary);
+            }
+  uint32_t numPoints = m_summaries.size ();
+  uint32_t scenarios = grid.algorithms.empty () ? 1 : numPoints / grid.algorithms.size ();
+
+  NrUThreadPool pool (m_numThreads);
+  std::mutex mutex;
+  pool.ParallelFor (numPoints * m_replications, [&] (uint32_t task)
+  {
+    uint32_t index = task % numPoints;
+    uint64_t replication = task / numPoints;
+    NrUSweepSummary& summary = m_summaries[index];
+    uint64_t seed = Mix (Mix (m_seed ^ Mix (index % scenarios)) + replication);
+    Replication result = RunReplication (summary.point, seed);
+
+    std::lock_guard<std::mutex> lock (mutex);
+    summary.reward.Add (result.reward);
+    summary.holDelay.Add (result.holDelay);
+    summary.throughput.Add (result.throughput);
+    summary.lbtSuccessRate.Add (result.lbtSuccessRate);
+    summary.dropped.Add (result.dropped);
+  });
+  return true;
+}
+
+void
+NrUSweep::WriteCsv (std::ostream& os) const
+{
+  os << "Algorithm,Arrival Rate,WiFi Mean,Alpha,Beta,TimeWindowSize,Replications,"
+     << "Reward,Reward CI95,Avg HoL Delay (slots),Avg HoL Delay CI95,"
+     << "Throughput,Throughput CI95,LBT Success Rate,LBT Success Rate CI95,"
+     << "Dropped,Dropped CI95\n";
+  for (const NrUSweepSummary& summary : m_summaries)
+  {
+    const NrUSweepPoint& point = summary.point;
+    os << point.algorithm << ',';
+    // A rate of 0 draws every UE's rate from U(0.1, 0.3)
+    if (point.arrivalRate > 0.0)
+    {
+      os << point.arrivalRate;
+    }
+    else
+    {
+      os << "U(0.1;0.3)";
+    }
+    os << ',' << point.wifiMean << ','
+       << point.alpha << ',' << point.beta << ',' << point.windowSize << ','
+       << summary.reward.GetCount ();
+    for (const NrUOnlineStats* stats : {&summary.reward, &summary.holDelay, &summary.throughput,
+                                        &summary.lbtSuccessRate, &summary.dropped})
+    {
+      os << ',' << stats->GetMean () << ',' << stats->GetCi95 ();
+    }
+    os << '\n';
+  }
+}
+
+} // namespace ns3
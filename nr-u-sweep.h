@@ -0,0 +1,126 @@
+#ifndef NR_U_SWEEP_H
+#define NR_U_SWEEP_H
+
+#include "nr-u-fast-sim.h"
+#include "nr-u-online-stats.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/// Values of every swept parameter; the sweep runs their Cartesian product
+struct NrUSweepGrid
+{
+  std::vector<double> arrivalRates {0.0025, 0.005, 0.02, 0.1, 0.2, 0.5};   ///< Packets per UE and slot
+  std::vector<double> wifiMeans {0.2};        ///< Mean WiFi busy probability over the BWPs
+  std::vector<double> alphas {0.3};           ///< Delay weight of the reward
+  std::vector<double> betas {1.0};            ///< Throughput weight of the reward
+  std::vector<uint32_t> windowSizes {500};    ///< TimeWindowSize, slots
+  std::vector<std::string> algorithms {"LCA", "RLA"};   ///< LCA, RLA or Random
+};
+
+/// One combination of the grid
+struct NrUSweepPoint
+{
+  double arrivalRate;     ///< 0 for U(0.1, 0.3) per UE
+  double wifiMean;
+  double alpha;
+  double beta;
+  uint32_t windowSize;
+  std::string algorithm;
+};
+
+/// Statistics of one grid point over its replications
+struct NrUSweepSummary
+{
+  NrUSweepPoint point;
+  NrUOnlineStats reward;           ///< Mean window reward of each replication
+  NrUOnlineStats holDelay;         ///< Mean HoL delay, slots
+  NrUOnlineStats throughput;       ///< Mean throughput per slot
+  NrUOnlineStats lbtSuccessRate;   ///< Mean successful accesses per slot
+  NrUOnlineStats dropped;          ///< Mean tail drops per window
+};
+
+/**
+ * \brief Parameter sweep over the fast slot engine, replications in parallel
+ *
+ * Every grid point is simulated for a number of independent replications,
+ * spread over an NrUThreadPool. A replication runs NrUFastSim for a fixed
+ * simulated duration with the point's BWP algorithm picking the actions
+ * at every window boundary, drops the warm-up windows and reduces the
+ * rest to one mean per metric; these replication means are folded into
+ * the point's NrUOnlineStats as soon as the replication ends, so nothing
+ * is kept per window and the confidence intervals are across
+ * replications.
+ *
+ * Replication r of a point is seeded from (seed, scenario, r), where the
+ * scenario leaves the algorithm out: all algorithms of a point see the
+ * same initial UEs and channels (common random numbers), and no two
+ * replications share a stream whatever the thread schedule.
+ *
+ * The algorithms mirror the scheduler's: LCA picks BWPs by
+ * (1 - F_n) C_n N_n^RB from the last window, RLA is the tabular Q-learning
+ * agent of RL.py learning online, Random draws a BWP per UE.
+ */
+class NrUSweep
+{
+public:
+  /// \param base Scenario the swept parameters are applied to
+  explicit NrUSweep (const NrUFastSimConfig& base = NrUFastSim::GetDefaultConfig ());
+
+  void SetReplications (uint32_t replications);
+  /// \param slots Simulated slots per replication, whatever the window size
+  void SetDuration (uint64_t slots);
+  /// \param fraction Leading share of the windows left out of the statistics
+  void SetWarmup (double fraction);
+  void SetSeed (uint64_t seed);
+  /// \param numThreads Threads running replications; 0 for all cores
+  void SetThreads (uint32_t numThreads);
+
+  /**
+   * \brief Run every replication of every point of the grid
+   *
+   * The summaries are one per point, in grid order with the arrival rate
+   * varying fastest, so each block of rows is a per-rate table.
+   *
+   * \param grid The swept values
+   * \return false if an algorithm is unknown, before running anything
+   */
+  bool Run (const NrUSweepGrid& grid);
+
+  const std::vector<NrUSweepSummary>& GetSummaries (void) const;
+
+  /// \return true for LCA, RLA and Random
+  static bool IsKnownAlgorithm (const std::string& algorithm);
+
+  /// Write the summaries as CSV, one row per point with mean and 95% CI
+  void WriteCsv (std::ostream& os) const;
+
+private:
+  /// Means of one replication
+  struct Replication
+  {
+    double reward = 0.0;
+    double holDelay = 0.0;
+    double throughput = 0.0;
+    double lbtSuccessRate = 0.0;
+    double dropped = 0.0;
+  };
+
+  NrUFastSimConfig MakeConfig (const NrUSweepPoint& point, uint64_t seed) const;
+  Replication RunReplication (const NrUSweepPoint& point, uint64_t seed) const;
+
+  NrUFastSimConfig m_base;
+  uint32_t m_replications;
+  uint64_t m_duration;
+  double m_warmup;
+  uint64_t m_seed;
+  uint32_t m_numThreads;
+  std::vector<NrUSweepSummary> m_summaries;
+};
+
+} // namespace ns3
+
+#endif /* NR_U_SWEEP_H */
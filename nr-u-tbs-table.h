@@ -0,0 +1,197 @@
+#ifndef NR_U_TBS_TABLE_H
+#define NR_U_TBS_TABLE_H
+
+#include <array>
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * \brief Compile-time transport block size tables for NR-U rate estimation
+ *
+ * The TBS follows TS 38.214 Sec. 5.1.3.2 for a single layer. A CQI index is
+ * mapped to modulation order and code rate through the 256QAM CQI table
+ * (TS 38.214 Table 5.2.2.1-3), and an RB carries 156 data REs per slot
+ * (14 symbols, one of them DMRS). Every (CQI, RB count) pair is evaluated
+ * once at compile time, so rate estimation at run time is a table lookup.
+ *
+ * The TBS of a slot does not depend on the numerology; the numerology only
+ * sets the number of slots per second (1000 << numerology), so rates are
+ * a lookup and a shift.
+ */
+class NrUTbsTable
+{
+public:
+  static constexpr uint8_t MAX_CQI = 15;         ///< Highest CQI index
+  static constexpr uint8_t MAX_NUMEROLOGY = 4;   ///< Highest NR numerology
+  static constexpr uint16_t MAX_RBS = 275;       ///< Max RBs of an NR carrier
+  static constexpr uint16_t RE_PER_RB = 156;     ///< Data REs per RB and slot
+
+  /**
+   * \brief Convert a (possibly averaged) CQI value to a table index
+   * \param cqi The CQI value
+   * \return the nearest CQI index, clamped to [0, MAX_CQI]
+   */
+  static constexpr uint8_t ToCqiIndex (double cqi)
+  {
+    return cqi <= 0.0 ? 0 : cqi >= MAX_CQI ? MAX_CQI : static_cast<uint8_t> (cqi + 0.5);
+  }
+
+  /**
+   * \brief Transport block size of one slot
+   * \param cqi The CQI index
+   * \param numRbs The number of allocated RBs
+   * \return the TBS in bits
+   */
+  static constexpr uint32_t GetTbs (uint8_t cqi, uint16_t numRbs)
+  {
+    return s_tbs[cqi > MAX_CQI ? MAX_CQI : cqi][numRbs > MAX_RBS ? MAX_RBS : numRbs];
+  }
+
+  /**
+   * \brief Data rate of an allocation held over consecutive slots
+   * \param numerology The NR numerology
+   * \param cqi The CQI index
+   * \param numRbs The number of allocated RBs
+   * \return the rate in bit/s
+   */
+  static constexpr uint64_t GetRate (uint8_t numerology, uint8_t cqi, uint16_t numRbs)
+  {
+    return static_cast<uint64_t> (GetTbs (cqi, numRbs)) * (1000u << numerology);
+  }
+
+  /**
+   * \brief Bits carried per RB and slot before TBS quantization
+   * \param cqi The CQI index
+   * \return the bits per RB
+   */
+  static constexpr double GetBitsPerRb (uint8_t cqi)
+  {
+    return s_bitsPerRb[cqi > MAX_CQI ? MAX_CQI : cqi];
+  }
+
+  /**
+   * \brief TBS determination of TS 38.214 Sec. 5.1.3.2, used to fill the table
+   * \param cqi The CQI index
+   * \param numRbs The number of allocated RBs
+   * \return the TBS in bits
+   */
+  static constexpr uint32_t ComputeTbs (uint8_t cqi, uint16_t numRbs);
+
+private:
+  using TbsTable = std::array<std::array<uint32_t, MAX_RBS + 1>, MAX_CQI + 1>;
+  using BitsPerRbTable = std::array<double, MAX_CQI + 1>;
+
+  static constexpr TbsTable BuildTbsTable (void);
+  static constexpr BitsPerRbTable BuildBitsPerRbTable (void);
+  static constexpr uint32_t FloorLog2 (uint64_t x);
+
+  /// Modulation order per CQI index (Table 5.2.2.1-3)
+  static constexpr uint8_t s_modOrder[MAX_CQI + 1] =
+    {0, 2, 2, 2, 4, 4, 4, 6, 6, 6, 6, 6, 8, 8, 8, 8};
+  /// Code rate x 1024 per CQI index (Table 5.2.2.1-3)
+  static constexpr uint16_t s_codeRate[MAX_CQI + 1] =
+    {0, 78, 193, 449, 378, 490, 616, 466, 567, 666, 772, 873, 711, 797, 885, 948};
+  /// TBS for N_info <= 3824 (Table 5.1.3.2-1)
+  static constexpr uint16_t s_smallTbs[93] =
+    {24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, 120, 128, 136, 144, 152, 160,
+     168, 176, 184, 192, 208, 224, 240, 256, 272, 288, 304, 320, 336, 352, 368, 384,
+     408, 432, 456, 480, 504, 528, 552, 576, 608, 640, 672, 704, 736, 768, 808, 848,
+     888, 928, 984, 1032, 1064, 1128, 1160, 1192, 1224, 1256, 1288, 1320, 1352, 1416,
+     1480, 1544, 1608, 1672, 1736, 1800, 1864, 1928, 2024, 2088, 2152, 2216, 2280,
+     2408, 2472, 2536, 2600, 2664, 2728, 2792, 2856, 2976, 3104, 3240, 3368, 3496,
+     3624, 3752, 3824};
+
+  static const TbsTable s_tbs;              ///< TBS per CQI index and RB count
+  static const BitsPerRbTable s_bitsPerRb;  ///< Bits per RB per CQI index
+};
+
+constexpr uint32_t
+NrUTbsTable::FloorLog2 (uint64_t x)
+{
+  uint32_t n = 0;
+  while (x >>= 1)
+  {
+    ++n;
+  }
+  return n;
+}
+
+constexpr uint32_t
+NrUTbsTable::ComputeTbs (uint8_t cqi, uint16_t numRbs)
+{
+  if (cqi == 0 || cqi > MAX_CQI || numRbs == 0)
+  {
+    return 0;
+  }
+
+  // N_info = N_RE * R * Q_m, kept scaled by 1024 to stay in integers
+  uint64_t nInfoScaled = static_cast<uint64_t> (RE_PER_RB) * numRbs
+                         * s_codeRate[cqi] * s_modOrder[cqi];
+  uint64_t nInfo = nInfoScaled / 1024;
+
+  if (nInfo <= 3824)
+  {
+    uint32_t log2Info = FloorLog2 (nInfo);
+    uint32_t n = log2Info > 9 ? log2Info - 6 : 3;
+    uint64_t quantized = (nInfo >> n) << n;
+    quantized = quantized < 24 ? 24 : quantized;
+    for (uint16_t tbs : s_smallTbs)
+    {
+      if (tbs >= quantized)
+      {
+        return tbs;
+      }
+    }
+    return s_smallTbs[92];
+  }
+
+  uint32_t n = FloorLog2 (nInfo - 24) - 5;
+  uint64_t step = static_cast<uint64_t> (1024) << n;
+  uint64_t quantized = ((nInfoScaled - 24 * 1024 + step / 2) / step) << n;
+  quantized = quantized < 3840 ? 3840 : quantized;
+
+  uint64_t codeBlocks = 1;
+  if (s_codeRate[cqi] <= 256)
+  {
+    codeBlocks = (quantized + 24 + 3815) / 3816;
+  }
+  else if (quantized > 8424)
+  {
+    codeBlocks = (quantized + 24 + 8423) / 8424;
+  }
+  uint64_t blockBits = 8 * codeBlocks;
+  return static_cast<uint32_t> (blockBits * ((quantized + 24 + blockBits - 1) / blockBits) - 24);
+}
+
+constexpr NrUTbsTable::TbsTable
+NrUTbsTable::BuildTbsTable (void)
+{
+  TbsTable table {};
+  for (uint8_t cqi = 0; cqi <= MAX_CQI; ++cqi)
+  {
+    for (uint16_t rbs = 0; rbs <= MAX_RBS; ++rbs)
+    {
+      table[cqi][rbs] = ComputeTbs (cqi, rbs);
+    }
+  }
+  return table;
+}
+
+constexpr NrUTbsTable::BitsPerRbTable
+NrUTbsTable::BuildBitsPerRbTable (void)
+{
+  BitsPerRbTable table {};
+  for (uint8_t cqi = 0; cqi <= MAX_CQI; ++cqi)
+  {
+    table[cqi] = RE_PER_RB * s_modOrder[cqi] * s_codeRate[cqi] / 1024.0;
+  }
+  return table;
+}
+
+constexpr NrUTbsTable::TbsTable NrUTbsTable::s_tbs = NrUTbsTable::BuildTbsTable ();
+constexpr NrUTbsTable::BitsPerRbTable NrUTbsTable::s_bitsPerRb = NrUTbsTable::BuildBitsPerRbTable ();
+
+} // namespace ns3
+
+#endif /* NR_U_TBS_TABLE_H */
@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-thread-pool.h"
+#include <algorithm>
+
+namespace ns3 {
+
+NrUThreadPool::NrUThreadPool (uint32_t numThreads)
+  : m_task (nullptr),
+    m_count (0),
+    m_next (0),
+    m_busy (0),
+    m_generation (0),
+    m_stop (false)
+{
+  if (numThreads == 0)
+  {
+    numThreads = std::max (1u, std::thread::hardware_concurrency ());
+  }
+  // The calling thread is the first worker of every batch
+  for (uint32_t i = 1; i < numThreads; ++i)
+  {
+    m_workers.emplace_back (&NrUThreadPool::WorkerLoop, this);
+  }
+}
+
+NrUThreadPool::~NrUThreadPool ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all ();
+  for (auto& worker : m_workers)
+  {
+    worker.join ();
+  }
+}
+
+uint32_t
+NrUThreadPool::GetNumThreads (void) const
+{
+  return m_workers.size () + 1;
+}
+
+void
+NrUThreadPool::ParallelFor (uint32_t count, const std::function<void (uint32_t)>& task)
+{
+  if (m_workers.empty () || count <= 1)
+  {
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      task (i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_task = &task;
+    m_count = count;
+    m_next.store (0, std::memory_order_relaxed);
+    m_busy = m_workers.size ();
+    ++m_generation;
+  }
+  m_wake.notify_all ();
+
+  RunTasks ();
+
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_done.wait (lock, [this] { return m_busy == 0; });
+  m_task = nullptr;
+}
+
+void
+NrUThreadPool::WorkerLoop (void)
+{
+  uint64_t seen = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      m_wake.wait (lock, [this, seen] { return m_stop || m_generation != seen; });
+      if (m_stop)
+      {
+        return;
+      }
+      seen = m_generation;
+    }
+
+    RunTasks ();
+
+    std::lock_guard<std::mutex> lock (m_mutex);
+    if (--m_busy == 0)
+    {
+      m_done.notify_one ();
+    }
+  }
+}
+
+void
+NrUThreadPool::RunTasks (void)
+{
+  uint32_t i;
+  while ((i = m_next.fetch_add (1, std::memory_order_relaxed)) < m_count)
+  {
+    (*m_task) (i);
+  }
+}
+
+} // namespace ns3
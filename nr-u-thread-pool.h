@@ -0,0 +1,68 @@
+#ifndef NR_U_THREAD_POOL_H
+#define NR_U_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Small persistent thread pool for data-parallel loops
+ *
+ * Worker threads are started once and sleep between batches, so a batch
+ * costs a wake-up instead of thread creation. The calling thread takes
+ * part in every batch. Tasks must not touch the ns-3 simulator (it is not
+ * thread-safe); they are meant for independent, read-mostly work such as
+ * packing observations of separate environments.
+ */
+class NrUThreadPool
+{
+public:
+  /**
+   * \brief Start the pool
+   * \param numThreads Threads working on a batch, the caller included;
+   *        0 selects the hardware concurrency
+   */
+  explicit NrUThreadPool (uint32_t numThreads);
+  ~NrUThreadPool ();
+
+  NrUThreadPool (const NrUThreadPool&) = delete;
+  NrUThreadPool& operator= (const NrUThreadPool&) = delete;
+
+  /**
+   * \brief Get the number of threads working on a batch
+   * \return the worker count plus the calling thread
+   */
+  uint32_t GetNumThreads (void) const;
+
+  /**
+   * \brief Run task (i) for every i in [0, count) and wait for completion
+   * \param count The number of task indices
+   * \param task The task, called concurrently with distinct indices
+   */
+  void ParallelFor (uint32_t count, const std::function<void (uint32_t)>& task);
+
+private:
+  void WorkerLoop (void);
+  void RunTasks (void);
+
+  std::vector<std::thread> m_workers;             ///< Worker threads
+  std::mutex m_mutex;                             ///< Protects the batch state
+  std::condition_variable m_wake;                 ///< Signals a new batch
+  std::condition_variable m_done;                 ///< Signals the end of a batch
+  const std::function<void (uint32_t)>* m_task;   ///< Task of the current batch
+  uint32_t m_count;                               ///< Indices in the current batch
+  std::atomic<uint32_t> m_next;                   ///< Next index to hand out
+  uint32_t m_busy;                                ///< Workers still in the batch
+  uint64_t m_generation;                          ///< Batch counter
+  bool m_stop;                                    ///< Set when shutting down
+};
+
+} // namespace ns3
+
+#endif /* NR_U_THREAD_POOL_H */
@@ -0,0 +1,216 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-trace-ring.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+namespace {
+
+const uint32_t MAGIC = 0x5455524E;  // "NRUT"
+const uint32_t VERSION = 1;
+
+static_assert (sizeof (NrUTraceRing::Record) == 32, "trace records are 32 bytes on disk");
+
+/// File header
+struct FileHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t recordSize;
+  uint32_t numRings;
+};
+
+/// Header of each ring, followed by count records, oldest first
+struct RingHeader
+{
+  uint32_t thread;      ///< Registration order of the thread
+  uint32_t reserved;
+  uint64_t written;     ///< Records ever written, count of them kept
+  uint64_t count;       ///< Records that follow
+};
+
+/// write () of a whole buffer, retried on short writes and EINTR
+bool
+WriteAll (int fd, const void* data, std::size_t size)
+{
+  const char* p = static_cast<const char*> (data);
+  while (size > 0)
+  {
+    ssize_t n = write (fd, p, size);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n <= 0)
+    {
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+const int CRASH_SIGNALS[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+} // anonymous namespace
+
+std::atomic<bool> NrUTraceRing::s_enabled (false);
+std::atomic<uint32_t> NrUTraceRing::s_capacity (65536);
+std::atomic<NrUTraceRing*> NrUTraceRing::s_rings[NrUTraceRing::MAX_RINGS];
+std::atomic<uint32_t> NrUTraceRing::s_numRings (0);
+char NrUTraceRing::s_signalPath[256];
+thread_local NrUTraceRing* NrUTraceRing::t_ring = nullptr;
+
+NrUTraceRing::NrUTraceRing (uint32_t capacity)
+  : m_records (new Record[capacity] ()),
+    m_mask (capacity - 1),
+    m_written (0),
+    m_thread (0)
+{
+}
+
+void
+NrUTraceRing::Enable (uint32_t capacity)
+{
+  uint32_t rounded = 1;
+  while (rounded < capacity && rounded < MAX_CAPACITY)
+  {
+    rounded <<= 1;
+  }
+  s_capacity.store (rounded, std::memory_order_relaxed);
+  if (!IsEnabled ())
+  {
+    // The writers stopped at Disable
+    uint32_t numRings = s_numRings.load (std::memory_order_acquire);
+    for (uint32_t i = 0; i < numRings && i < MAX_RINGS; ++i)
+    {
+      NrUTraceRing* ring = s_rings[i].load (std::memory_order_acquire);
+      if (ring != nullptr)
+      {
+        ring->m_written = 0;
+      }
+    }
+  }
+  s_enabled.store (true, std::memory_order_relaxed);
+}
+
+void
+NrUTraceRing::Disable (void)
+{
+  s_enabled.store (false, std::memory_order_relaxed);
+}
+
+NrUTraceRing*
+NrUTraceRing::Attach (void)
+{
+  // Never freed: a dump, possibly from a signal handler, may read any ring
+  NrUTraceRing* ring = new NrUTraceRing (s_capacity.load (std::memory_order_relaxed));
+  uint32_t index = s_numRings.fetch_add (1, std::memory_order_relaxed);
+  ring->m_thread = index;
+  if (index < MAX_RINGS)
+  {
+    s_rings[index].store (ring, std::memory_order_release);
+  }
+  t_ring = ring;
+  return ring;
+}
+
+bool
+NrUTraceRing::Dump (const char* path)
+{
+  int fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    return false;
+  }
+  uint32_t numRings = s_numRings.load (std::memory_order_acquire);
+  numRings = numRings < MAX_RINGS ? numRings : MAX_RINGS;
+  // A ring claimed but not yet stored is written as an empty ring
+  FileHeader header = {MAGIC, VERSION, sizeof (Record), numRings};
+  bool ok = WriteAll (fd, &header, sizeof (header));
+  for (uint32_t i = 0; ok && i < numRings; ++i)
+  {
+    NrUTraceRing* ring = s_rings[i].load (std::memory_order_acquire);
+    RingHeader ringHeader = {i, 0, 0, 0};
+    if (ring == nullptr)
+    {
+      ok = WriteAll (fd, &ringHeader, sizeof (ringHeader));
+      continue;
+    }
+    uint64_t written = ring->m_written;
+    uint64_t capacity = ring->m_mask + 1;
+    uint64_t count = written < capacity ? written : capacity;
+    ringHeader.written = written;
+    ringHeader.count = count;
+    ok = WriteAll (fd, &ringHeader, sizeof (ringHeader));
+    // Oldest first: from the write position to the end, then the start
+    uint64_t start = (written - count) & ring->m_mask;
+    uint64_t first = count < capacity - start ? count : capacity - start;
+    ok = ok && WriteAll (fd, ring->m_records + start, first * sizeof (Record));
+    ok = ok && WriteAll (fd, ring->m_records, (count - first) * sizeof (Record));
+  }
+  return close (fd) == 0 && ok;
+}
+
+void
+NrUTraceRing::HandleSignal (int signal)
+{
+  int savedErrno = errno;
+  Dump (s_signalPath);
+  errno = savedErrno;
+  if (signal != SIGUSR1)
+  {
+    // The handler was reset: the default action ends the process
+    raise (signal);
+  }
+}
+
+bool
+NrUTraceRing::InstallSignalHandlers (const std::string& path)
+{
+  if (path.size () >= sizeof (s_signalPath))
+  {
+    return false;
+  }
+  std::memcpy (s_signalPath, path.c_str (), path.size () + 1);
+
+  struct sigaction action;
+  std::memset (&action, 0, sizeof (action));
+  action.sa_handler = &NrUTraceRing::HandleSignal;
+  sigemptyset (&action.sa_mask);
+  action.sa_flags = SA_RESETHAND;
+  bool ok = true;
+  for (int signal : CRASH_SIGNALS)
+  {
+    ok = sigaction (signal, &action, nullptr) == 0 && ok;
+  }
+  action.sa_flags = SA_RESTART;
+  ok = sigaction (SIGUSR1, &action, nullptr) == 0 && ok;
+  return ok;
+}
+
+} // namespace ns3
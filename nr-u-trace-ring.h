@@ -0,0 +1,144 @@
+#ifndef NR_U_TRACE_RING_H
+#define NR_U_TRACE_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief Per-thread ring of fixed-size binary trace records
+ *
+ * Slot-level events (LBT attempts and outcomes, BWP switches, RB
+ * allocations, decisions) are written as 32-byte records into a ring owned
+ * by the writing thread: one check of a global flag, then a few stores
+ * and an increment, with no locking, formatting or allocation. A full ring
+ * overwrites its oldest records, so it always holds the latest Capacity
+ * events of its thread.
+ *
+ * Tracing is off until Enable. Rings are allocated on the first record of
+ * each thread and live until the process exits, so the trace of a thread
+ * that has ended can still be dumped. Dump writes every ring to one file,
+ * oldest record first, using only open/write/close; InstallSignalHandlers
+ * makes a crash (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT) dump the rings
+ * before the process dies, and SIGUSR1 dump them on demand while it runs.
+ * nr_u_trace.py decodes the file.
+ *
+ * A ring dumped while its thread writes may show a torn latest record.
+ */
+class NrUTraceRing
+{
+public:
+  /// Record types
+  enum Type : uint16_t {
+    LBT_ATTEMPT = 1,  ///< bwp; a = contention window
+    LBT_OUTCOME,      ///< bwp; a = LbtOutcome, b = backoff slots
+    BWP_SWITCH,       ///< ue, bwp = new BWP; a = old BWP
+    ALLOCATION,       ///< ue, bwp; a = RBs, b = bits served
+    DECISION          ///< ue = UEs; a = window, b = algorithm
+  };
+
+  /// Outcome of an LBT_OUTCOME record
+  enum LbtOutcome {
+    LBT_GRANTED,          ///< Channel access granted
+    LBT_ICCA_BUSY,        ///< Channel busy at the immediate check
+    LBT_ECCA_INTERRUPTED  ///< Backoff interrupted by WiFi
+  };
+
+  /// One trace record, 32 bytes
+  struct Record
+  {
+    int64_t time;     ///< Simulation time in nanoseconds
+    uint16_t type;    ///< Type
+    uint16_t bwp;     ///< BWP, if any
+    uint32_t ue;      ///< UE (RNTI) or count, if any
+    uint64_t a;       ///< First type-specific field
+    uint64_t b;       ///< Second type-specific field
+  };
+
+  /// Rings that can be registered for dumping; further threads trace undumped
+  static const uint32_t MAX_RINGS = 256;
+
+  /// Largest ring, 512 MiB per thread
+  static constexpr uint32_t MAX_CAPACITY = 1u << 24;
+
+  /**
+   * \brief Start tracing
+   *
+   * Rings left by an earlier Enable are emptied, so a dump holds the
+   * records of this run only.
+   *
+   * \param capacity Records per thread ring, rounded up to a power of two
+   *        and at most MAX_CAPACITY; applies to the rings of threads not
+   *        traced yet
+   */
+  static void Enable (uint32_t capacity = 65536);
+
+  /// Stop tracing; the rings keep their records
+  static void Disable (void);
+
+  static bool IsEnabled (void)
+  {
+    return s_enabled.load (std::memory_order_relaxed);
+  }
+
+  /// Append a record to the ring of the calling thread, if tracing is enabled
+  static void Write (uint16_t type, int64_t time, uint16_t bwp, uint32_t ue, uint64_t a, uint64_t b)
+  {
+    if (!IsEnabled ())
+    {
+      return;
+    }
+    NrUTraceRing* ring = t_ring != nullptr ? t_ring : Attach ();
+    Record& record = ring->m_records[ring->m_written & ring->m_mask];
+    record.time = time;
+    record.type = type;
+    record.bwp = bwp;
+    record.ue = ue;
+    record.a = a;
+    record.b = b;
+    ring->m_written++;
+  }
+
+  /**
+   * \brief Write every registered ring to a file
+   *
+   * Async-signal-safe: no allocation, only open/write/close.
+   *
+   * \param path The file, replaced
+   * \return false if the file cannot be written
+   */
+  static bool Dump (const char* path);
+
+  /**
+   * \brief Dump to a file on crash signals and on SIGUSR1
+   * \param path The file (at most 255 characters)
+   * \return false if the path is too long or a handler cannot be installed
+   */
+  static bool InstallSignalHandlers (const std::string& path);
+
+private:
+  NrUTraceRing (uint32_t capacity);
+
+  /// \return the ring of the calling thread, created and registered
+  static NrUTraceRing* Attach (void);
+
+  static void HandleSignal (int signal);
+
+  Record* m_records;      ///< capacity records
+  uint64_t m_mask;        ///< capacity - 1
+  uint64_t m_written;     ///< Records written since the ring was created
+  uint32_t m_thread;      ///< Registration order of the thread
+
+  static std::atomic<bool> s_enabled;                   ///< Tracing on
+  static std::atomic<uint32_t> s_capacity;              ///< Capacity of new rings
+  static std::atomic<NrUTraceRing*> s_rings[MAX_RINGS]; ///< Registered rings
+  static std::atomic<uint32_t> s_numRings;              ///< Rings created
+  static char s_signalPath[256];                        ///< Dump file of the handlers
+  static thread_local NrUTraceRing* t_ring;             ///< Ring of this thread
+};
+
+} // namespace ns3
+
+#endif /* NR_U_TRACE_RING_H */
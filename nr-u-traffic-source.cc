@@ -0,0 +1,344 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 Samsung R&D Institute India - Bangalore.
+ * Author: Ram Aditya S <ram.aditya@samsung.com>
+ *         Shyamal Dhua <shyamal.dhua@samsung.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-u-traffic-source.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+namespace {
+
+const uint64_t GOLDEN_GAMMA = 0x9e3779b97f4a7c15ULL;
+const uint32_t NOT_DENSE = UINT32_MAX;
+const double MAX_RATE = 32.0;
+const uint32_t MAX_COUNT = 256;
+const uint32_t LINEAR_SEARCH_SPAN = 64;
+
+/// SplitMix64 finalizer: the i-th draw is Mix (key + i * GOLDEN_GAMMA), so
+/// any number of draws can be computed independently
+inline uint64_t
+Mix (uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/// Uniform in [0, 1) from the top 53 bits
+inline double
+ToUnit (uint64_t x)
+{
+  return (x >> 11) * 0x1.0p-53;
+}
+
+} // anonymous namespace
+
+NrUTrafficSource::NrUTrafficSource (uint32_t numUes, uint64_t seed)
+  : m_key (0),
+    m_counter (0),
+    m_slot (0),
+    m_sparseThreshold (0.05),
+    m_minSize (0),
+    m_sizeSpan (31),
+    m_wheel (WHEEL_SLOTS)
+{
+  SetSeed (seed);
+  Resize (numUes);
+}
+
+void
+NrUTrafficSource::SetSeed (uint64_t seed)
+{
+  m_key = Mix (seed + GOLDEN_GAMMA);
+  m_counter = 0;
+}
+
+void
+NrUTrafficSource::Resize (uint32_t numUes)
+{
+  uint32_t oldUes = m_rate.size ();
+  for (uint32_t ue = numUes; ue < oldUes; ++ue)
+  {
+    // Dropped UEs must leave the dense list and the wheel
+    m_rate[ue] = 0.0;
+    Classify (ue);
+  }
+  if (numUes < oldUes)
+  {
+    // Their wheel entries would index past the per-UE vectors, or match the
+    // reset generation of a UE added back later
+    for (std::vector<WheelEntry>& bucket : m_wheel)
+    {
+      bucket.erase (std::remove_if (bucket.begin (), bucket.end (),
+                                    [numUes] (const WheelEntry& entry) { return entry.ue >= numUes; }),
+                    bucket.end ());
+    }
+  }
+  m_rate.resize (numUes, 0.0);
+  m_p0.resize (numUes, 1.0);
+  m_meanSize.resize (numUes, 0.0);
+  m_sizeCdf.resize (static_cast<std::size_t> (numUes) * m_sizeSpan, 1.0f);
+  m_gen.resize (numUes, 0);
+  m_due.resize (numUes, 0);
+  m_densePos.resize (numUes, NOT_DENSE);
+}
+
+void
+NrUTrafficSource::SetSizeLimits (uint32_t minSize, uint32_t maxSize)
+{
+  m_minSize = minSize;
+  m_sizeSpan = std::min (std::max (maxSize, minSize) - minSize + 1, MAX_SIZE_SPAN);
+  m_sizeCdf.assign (m_rate.size () * static_cast<std::size_t> (m_sizeSpan), 1.0f);
+  for (uint32_t ue = 0; ue < m_rate.size (); ++ue)
+  {
+    BuildSizeTable (ue);
+  }
+}
+
+void
+NrUTrafficSource::SetSparseThreshold (double rate)
+{
+  m_sparseThreshold = rate;
+  for (uint32_t ue = 0; ue < m_rate.size (); ++ue)
+  {
+    Classify (ue);
+  }
+}
+
+void
+NrUTrafficSource::SetRate (uint32_t ue, double rate)
+{
+  m_rate[ue] = std::max (0.0, std::min (rate, MAX_RATE));
+  m_p0[ue] = std::exp (-m_rate[ue]);
+  Classify (ue);
+}
+
+void
+NrUTrafficSource::SetMeanSize (uint32_t ue, double meanSize)
+{
+  m_meanSize[ue] = std::max (0.0, meanSize);
+  BuildSizeTable (ue);
+}
+
+double
+NrUTrafficSource::GetRate (uint32_t ue) const
+{
+  return m_rate[ue];
+}
+
+void
+NrUTrafficSource::BuildSizeTable (uint32_t ue)
+{
+  // CDF of the clamped Poisson size: entry j is P(size <= minSize + j) and
+  // the mass above the maximum lands on the last entry
+  float* cdf = &m_sizeCdf[static_cast<std::size_t> (ue) * m_sizeSpan];
+  double mean = m_meanSize[ue];
+  double logMean = mean > 0.0 ? std::log (mean) : 0.0;
+  double sum = 0.0;
+  // log (k!) accumulated here rather than lgamma, which is not thread-safe
+  double logFactorial = 0.0;
+  uint32_t last = m_minSize + m_sizeSpan - 1;
+  for (uint32_t k = 0; k <= last; ++k)
+  {
+    logFactorial += k > 0 ? std::log (double (k)) : 0.0;
+    double pmf = mean > 0.0 ? std::exp (k * logMean - mean - logFactorial) : (k == 0 ? 1.0 : 0.0);
+    sum += pmf;
+    if (k >= m_minSize)
+    {
+      cdf[k - m_minSize] = static_cast<float> (std::min (sum, 1.0));
+    }
+  }
+  cdf[m_sizeSpan - 1] = 1.0f;
+}
+
+void
+NrUTrafficSource::Classify (uint32_t ue)
+{
+  // Any wheel entry of the UE becomes stale
+  m_gen[ue]++;
+
+  bool dense = m_rate[ue] > m_sparseThreshold;
+  uint32_t pos = m_densePos[ue];
+  if (pos != NOT_DENSE && !dense)
+  {
+    // Swap-remove from the dense arrays
+    uint32_t moved = m_denseUes.back ();
+    m_denseUes[pos] = moved;
+    m_denseP0[pos] = m_denseP0.back ();
+    m_densePos[moved] = pos;
+    m_denseUes.pop_back ();
+    m_denseP0.pop_back ();
+    m_densePos[ue] = NOT_DENSE;
+  }
+  else if (pos == NOT_DENSE && dense)
+  {
+    m_densePos[ue] = m_denseUes.size ();
+    m_denseUes.push_back (ue);
+    m_denseP0.push_back (m_p0[ue]);
+  }
+  else if (dense)
+  {
+    m_denseP0[pos] = m_p0[ue];
+  }
+
+  if (!dense && m_rate[ue] > 0.0)
+  {
+    Schedule (ue, m_slot);
+  }
+}
+
+void
+NrUTrafficSource::Schedule (uint32_t ue, uint64_t from)
+{
+  // Empty slots before the next non-empty one: geometric with success
+  // probability 1 - exp (-rate), i.e. floor (Exp (rate))
+  double u = NextUniform ();
+  double gap = std::floor (-std::log1p (-u) / m_rate[ue]);
+  uint64_t due = from + static_cast<uint64_t> (std::min (gap, 1e15));
+  m_due[ue] = due;
+  m_wheel[due % WHEEL_SLOTS].push_back ({ue, m_gen[ue]});
+}
+
+void
+NrUTrafficSource::Restart (uint64_t slot)
+{
+  m_slot = slot;
+  for (auto& bucket : m_wheel)
+  {
+    bucket.clear ();
+  }
+  // Arrivals are memoryless, so every sparse UE simply draws a new gap
+  for (uint32_t ue = 0; ue < m_rate.size (); ++ue)
+  {
+    if (m_densePos[ue] == NOT_DENSE && m_rate[ue] > 0.0)
+    {
+      m_gen[ue]++;
+      Schedule (ue, slot);
+    }
+  }
+}
+
+double
+NrUTrafficSource::NextUniform (void)
+{
+  return ToUnit (Mix (m_key + (m_counter++) * GOLDEN_GAMMA));
+}
+
+uint32_t
+NrUTrafficSource::DrawCount (uint32_t ue, double u) const
+{
+  // Inversion of the Poisson CDF, walking up from 0
+  double rate = m_rate[ue];
+  double pmf = m_p0[ue];
+  double cdf = pmf;
+  uint32_t k = 0;
+  while (u >= cdf && k < MAX_COUNT)
+  {
+    ++k;
+    pmf *= rate / k;
+    cdf += pmf;
+  }
+  return k;
+}
+
+float
+NrUTrafficSource::DrawSize (uint32_t ue)
+{
+  const float* cdf = &m_sizeCdf[static_cast<std::size_t> (ue) * m_sizeSpan];
+  float u = static_cast<float> (NextUniform ());
+  uint32_t last = m_sizeSpan - 1;
+  if (last > LINEAR_SEARCH_SPAN)
+  {
+    return static_cast<float> (m_minSize + (std::upper_bound (cdf, cdf + last, u) - cdf));
+  }
+  // Short tables (RL.py's 31 sizes): a branch-free count of the entries
+  // at or below u, which beats the mispredicted branches of a search
+  uint32_t j = 0;
+  for (uint32_t k = 0; k < last; ++k)
+  {
+    j += cdf[k] <= u;
+  }
+  return static_cast<float> (m_minSize + j);
+}
+
+uint64_t
+NrUTrafficSource::Generate (Batch& batch)
+{
+  batch.ues.clear ();
+  batch.sizes.clear ();
+  uint64_t slot = m_slot++;
+
+  // Dense UEs: one uniform each, computed independently of each other so
+  // the loop vectorizes, then a compare against P(no arrival)
+  uint32_t numDense = m_denseUes.size ();
+  m_uniform.resize (numDense);
+  double* u = m_uniform.data ();
+  uint64_t key = m_key;
+  uint64_t base = m_counter;
+  m_counter += numDense;
+  for (uint32_t i = 0; i < numDense; ++i)
+  {
+    u[i] = ToUnit (Mix (key + (base + i) * GOLDEN_GAMMA));
+  }
+  for (uint32_t i = 0; i < numDense; ++i)
+  {
+    if (u[i] >= m_denseP0[i])
+    {
+      uint32_t ue = m_denseUes[i];
+      for (uint32_t c = DrawCount (ue, u[i]); c > 0; --c)
+      {
+        batch.ues.push_back (ue);
+        batch.sizes.push_back (DrawSize (ue));
+      }
+    }
+  }
+
+  // Sparse UEs due now. The bucket is detached first, since rescheduled
+  // UEs can land in it again one lap later
+  std::vector<WheelEntry>& bucket = m_wheel[slot % WHEEL_SLOTS];
+  m_carry.swap (bucket);
+  for (const WheelEntry& entry : m_carry)
+  {
+    uint32_t ue = entry.ue;
+    if (entry.gen != m_gen[ue])
+    {
+      continue;
+    }
+    if (m_due[ue] != slot)
+    {
+      bucket.push_back (entry);
+      continue;
+    }
+    // At least one packet: zero-truncated Poisson by inversion above P(0)
+    double p0 = m_p0[ue];
+    uint32_t count = DrawCount (ue, p0 + NextUniform () * (1.0 - p0));
+    for (uint32_t c = std::max (count, 1u); c > 0; --c)
+    {
+      batch.ues.push_back (ue);
+      batch.sizes.push_back (DrawSize (ue));
+    }
+    Schedule (ue, slot + 1);
+  }
+  m_carry.clear ();
+  return slot;
+}
+
+} // namespace ns3
@@ -0,0 +1,150 @@
+"""Python binding of the headless NR-U slot engine (see nr-u-fast-sim.h).
+
+FastNRUEnv is a drop-in replacement for RL.py's PythonNRUEnv:
+
+    env = FastNRUEnv()
+    state = env.reset()
+    next_state, reward, delay, throughput, lbt_rate = env.step(action)
+
+The engine is loaded from libnr-u-fast-sim.so, looked up in NRU_FAST_SIM_LIB,
+next to this file, then in the usual build directories.
+"""
+import ctypes
+import os
+
+import numpy as np
+
+MAX_BWPS = 16
+
+
+class FastSimConfig(ctypes.Structure):
+    _fields_ = [
+        ("num_ues", ctypes.c_uint32),
+        ("num_bwps", ctypes.c_uint32),
+        ("max_ues_per_slot", ctypes.c_uint32),
+        ("slots_per_window", ctypes.c_uint32),
+        ("max_queue_size", ctypes.c_uint32),
+        ("slots_per_sec", ctypes.c_uint32),
+        ("alpha", ctypes.c_double),
+        ("max_delay_threshold", ctypes.c_double),
+        ("wifi_interference", ctypes.c_double * MAX_BWPS),
+        ("bwp_rbs", ctypes.c_uint32 * MAX_BWPS),
+        ("seed", ctypes.c_uint64),
+        ("arrival_rate", ctypes.c_double),
+        ("beta", ctypes.c_double),
+    ]
+
+
+class FastSimResult(ctypes.Structure):
+    _fields_ = [
+        ("reward", ctypes.c_double),
+        ("avg_hol_delay", ctypes.c_double),
+        ("throughput", ctypes.c_double),
+        ("lbt_success_rate", ctypes.c_double),
+        ("dropped_packets", ctypes.c_double),
+    ]
+
+
+def _load_library():
+    here = os.path.dirname(os.path.abspath(__file__))
+    candidates = [os.environ.get("NRU_FAST_SIM_LIB", "")]
+    for directory in (here, os.path.join(here, "build"), os.path.join(here, "_gate_build")):
+        candidates.append(os.path.join(directory, "libnr-u-fast-sim.so"))
+    for path in candidates:
+        if path and os.path.exists(path):
+            lib = ctypes.CDLL(path)
+            break
+    else:
+        raise OSError("libnr-u-fast-sim.so not found, set NRU_FAST_SIM_LIB")
+
+    u32p = np.ctypeslib.ndpointer(np.uint32, flags="C_CONTIGUOUS")
+    i32p = np.ctypeslib.ndpointer(np.int32, flags="C_CONTIGUOUS")
+    f32p = np.ctypeslib.ndpointer(np.float32, flags="C_CONTIGUOUS")
+    lib.nru_fast_sim_create.restype = ctypes.c_void_p
+    lib.nru_fast_sim_create.argtypes = [ctypes.POINTER(FastSimConfig)]
+    lib.nru_fast_sim_destroy.argtypes = [ctypes.c_void_p]
+    lib.nru_fast_sim_default_config.argtypes = [ctypes.POINTER(FastSimConfig)]
+    lib.nru_fast_sim_reset.argtypes = [ctypes.c_void_p, i32p]
+    lib.nru_fast_sim_step.argtypes = [ctypes.c_void_p, u32p, i32p, ctypes.POINTER(FastSimResult)]
+    lib.nru_fast_sim_ue_state.argtypes = [ctypes.c_void_p, f32p]
+    lib.nru_fast_sim_set_rates.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+    return lib
+
+
+_lib = None
+
+
+def default_config():
+    global _lib
+    if _lib is None:
+        _lib = _load_library()
+    config = FastSimConfig()
+    _lib.nru_fast_sim_default_config(ctypes.byref(config))
+    return config
+
+
+class FastNRUEnv:
+    """PythonNRUEnv on the C++ engine; keyword arguments override the RL.py constants.
+
+    arrival_rate=r gives every UE r packets per slot instead of RL.py's
+    U(0.1, 0.3), as in the arrival-rate sweep of analysis_script.py.
+    """
+
+    _sim = None   # until the engine is created, so close() works if __init__ raises
+
+    def __init__(self, seed=None, wifi_interference=None, bwp_rbs=None, **params):
+        config = default_config()
+        fields = {name for name, _ in FastSimConfig._fields_}
+        for key, value in params.items():
+            # ctypes would keep an unknown name as a plain attribute the engine never sees
+            if key not in fields:
+                raise TypeError(f"Unknown parameter {key!r}")
+            setattr(config, key, value)
+        if not 1 <= config.num_bwps <= MAX_BWPS:
+            raise ValueError(f"num_bwps must be between 1 and {MAX_BWPS}, got {config.num_bwps}")
+        if wifi_interference is not None:
+            config.wifi_interference[:len(wifi_interference)] = list(wifi_interference)
+        if bwp_rbs is not None:
+            config.bwp_rbs[:len(bwp_rbs)] = list(bwp_rbs)
+        if seed is not None:
+            config.seed = seed
+        self.num_ues = config.num_ues
+        self.num_bwps = config.num_bwps
+        self._sim = _lib.nru_fast_sim_create(ctypes.byref(config))
+        self._state = np.zeros(3 * self.num_bwps, np.int32)
+        self._action = np.zeros(self.num_ues, np.uint32)
+        self._ue_state = np.zeros((self.num_ues, 4), np.float32)
+        self._result = FastSimResult()
+
+    def reset(self):
+        _lib.nru_fast_sim_reset(self._sim, self._state)
+        return tuple(self._state.tolist())
+
+    def step(self, action):
+        if len(action) != self.num_ues:
+            raise ValueError(f"Action length {len(action)} doesn't match number of UEs {self.num_ues}")
+        self._action[:] = action
+        _lib.nru_fast_sim_step(self._sim, self._action, self._state, ctypes.byref(self._result))
+        r = self._result
+        return tuple(self._state.tolist()), r.reward, r.avg_hol_delay, r.throughput, r.lbt_success_rate
+
+    def ue_state(self):
+        """Per-UE [queued packets, HoL delay, CQI, average throughput]."""
+        _lib.nru_fast_sim_ue_state(self._sim, self._ue_state)
+        return self._ue_state
+
+    def set_rates(self, rates):
+        """Fix per-UE arrival rates (packets per slot) from the next reset on; None restores the default."""
+        if rates is None:
+            _lib.nru_fast_sim_set_rates(self._sim, None)
+            return
+        rates = np.ascontiguousarray(np.broadcast_to(np.asarray(rates, np.float64), (self.num_ues,)))
+        _lib.nru_fast_sim_set_rates(self._sim, rates.ctypes.data)
+
+    def close(self):
+        if self._sim:
+            _lib.nru_fast_sim_destroy(self._sim)
+            self._sim = None
+
+    def __del__(self):
+        self.close()
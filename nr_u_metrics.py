@@ -0,0 +1,92 @@
+"""Reader of the columnar metrics files written by NrUMetricsWriter (see nr-u-metrics-writer.h).
+
+    columns = read_metrics("run.window.nrum")       # dict of numpy arrays
+    df = read_metrics_frame("run.window.nrum")      # pandas DataFrame
+
+The file is memory-mapped; raw chunks are viewed in place, compressed ones
+are inflated chunk by chunk. A file still being written, or cut short, is
+read up to its last whole chunk.
+"""
+import mmap
+import struct
+import zlib
+
+import numpy as np
+
+MAGIC = 0x4D55524E
+CHUNK_MAGIC = 0x4B4E4843
+VERSION = 1
+CODEC_RAW = 0
+CODEC_SHUFFLE_DEFLATE = 1
+DTYPES = {0: np.dtype("<u4"), 1: np.dtype("<u8"), 2: np.dtype("<i8"), 3: np.dtype("<f4"), 4: np.dtype("<f8")}
+
+# Column names of the older CSV outputs, for scripts written against them.
+# Their delay is in seconds, unlike AvgHolDelay (slots), so it keeps its own column
+CSV_NAMES = {
+    "Throughput (bits)": "TotalThroughput",
+    "Throughput_bits": "TotalThroughput",
+    "Avg HoL Delay (s)": "AvgHolDelaySeconds",
+    "Avg_HoL_Delay_s": "AvgHolDelaySeconds",
+}
+
+
+def _pad8(n):
+    return (8 - n % 8) % 8
+
+
+def read_schema(buf):
+    """Return [(name, dtype)] and the offset of the first chunk."""
+    magic, version, num_columns, _ = struct.unpack_from("<4I", buf, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not an NR-U metrics file (version %d)" % VERSION)
+    offset = 16
+    schema = []
+    for _ in range(num_columns):
+        type_id, length = struct.unpack_from("<BB", buf, offset)
+        name = bytes(buf[offset + 2:offset + 2 + length]).decode()
+        schema.append((name, DTYPES[type_id]))
+        offset += 2 + length
+    return schema, offset + _pad8(offset)
+
+
+def read_metrics(path):
+    """Read every whole chunk of a metrics file into one array per column."""
+    with open(path, "rb") as f:
+        try:
+            buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        except ValueError:
+            buf = b""   # empty file
+    if len(buf) < 16:
+        raise ValueError("truncated NR-U metrics file")
+    schema, offset = read_schema(buf)
+    parts = [[] for _ in schema]
+    entry_bytes = 16 * len(schema)
+    while offset + 8 + entry_bytes <= len(buf):
+        magic, rows = struct.unpack_from("<2I", buf, offset)
+        if magic != CHUNK_MAGIC:
+            break
+        entries = [struct.unpack_from("<IIQ", buf, offset + 8 + 16 * c) for c in range(len(schema))]
+        end = offset + 8 + entry_bytes + sum(e[2] + _pad8(e[2]) for e in entries)
+        if end > len(buf):
+            break   # chunk still being written
+        offset += 8 + entry_bytes
+        for c, ((_, dtype), (codec, _, stored)) in enumerate(zip(schema, entries)):
+            if codec == CODEC_RAW:
+                parts[c].append(np.frombuffer(buf, dtype, rows, offset))
+            else:
+                planes = np.frombuffer(zlib.decompress(buf[offset:offset + stored]), np.uint8)
+                parts[c].append(planes.reshape(dtype.itemsize, rows).T.copy().view(dtype).ravel())
+            offset += stored + _pad8(stored)
+    columns = {}
+    for (name, dtype), chunks in zip(schema, parts):
+        if len(chunks) == 1:
+            columns[name] = chunks[0]
+        else:
+            columns[name] = np.concatenate(chunks) if chunks else np.empty(0, dtype)
+    return columns
+
+
+def read_metrics_frame(path):
+    """read_metrics as a pandas DataFrame."""
+    import pandas as pd
+    return pd.DataFrame(read_metrics(path))
@@ -0,0 +1,54 @@
+"""Weight file of the in-process RLA policy (see nr-u-policy.h).
+
+Export a trained feed-forward Q-network so GymBwpRlEnv can run it through
+its PolicyFile attribute, in float or int8:
+
+    save_policy("policy.bin", [(W1, b1), (W2, b2), (W3, b3)])
+
+Each W is (outputs, inputs), as in torch.nn.Linear.weight; ReLU is applied
+between layers and the last layer is linear. The output width must be the
+number of action slots (UEs, or 1) times the number of BWPs.
+"""
+import struct
+
+import numpy as np
+
+MAGIC = 0x5055524E
+VERSION = 1
+
+
+def save_policy(path, layers):
+    """Write [(weight, bias), ...] from the input layer to the output layer."""
+    with open(path, "wb") as f:
+        f.write(struct.pack("<3I", MAGIC, VERSION, len(layers)))
+        for weight, bias in layers:
+            weight = np.ascontiguousarray(weight, dtype="<f4")
+            bias = np.ascontiguousarray(bias, dtype="<f4").reshape(-1)
+            outputs, inputs = weight.shape
+            if bias.size != outputs:
+                raise ValueError("bias size %d does not match %d outputs" % (bias.size, outputs))
+            f.write(struct.pack("<2I", inputs, outputs))
+            f.write(weight.tobytes())
+            f.write(bias.tobytes())
+
+
+def from_torch(module):
+    """Collect the (weight, bias) pairs of the Linear layers of a torch module, in order."""
+    import torch.nn as nn
+    return [(m.weight.detach().cpu().numpy(), m.bias.detach().cpu().numpy())
+            for m in module.modules() if isinstance(m, nn.Linear)]
+
+
+def load_policy(path):
+    """Read a weight file back as [(weight, bias), ...]."""
+    with open(path, "rb") as f:
+        magic, version, count = struct.unpack("<3I", f.read(12))
+        if magic != MAGIC or version != VERSION:
+            raise ValueError("not a policy file: %s" % path)
+        layers = []
+        for _ in range(count):
+            inputs, outputs = struct.unpack("<2I", f.read(8))
+            weight = np.frombuffer(f.read(4 * inputs * outputs), "<f4").reshape(outputs, inputs)
+            bias = np.frombuffer(f.read(4 * outputs), "<f4")
+            layers.append((weight, bias))
+        return layers
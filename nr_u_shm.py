@@ -0,0 +1,123 @@
+"""Agent side of the NR-U shared-memory transport (see nr-u-shm-transport.h).
+
+Usage from an agent loop:
+
+    channel = ShmAgentChannel("nr-u-gym")
+    while True:
+        obs, reward, done = channel.recv()      # numpy view into the segment
+        if obs is None:
+            break                                # simulation closed the ring
+        channel.send(policy(obs))
+
+With an ActionLag on the simulation side, channel.action_lag tells how many
+windows old the action behind the last observation was.
+"""
+import ctypes
+import mmap
+import os
+import platform
+import struct
+import time
+
+import numpy as np
+
+MAGIC = 0x4E525553
+VERSION = 2
+HEADER_BYTES = 192
+OBS_SEQ_OFFSET = 64
+ACT_SEQ_OFFSET = 128
+CLOSED_OFFSET = 28
+SLOT_HEADER_BYTES = 16
+
+FUTEX_WAIT = 0
+FUTEX_WAKE = 1
+SYS_FUTEX = {"x86_64": 202, "aarch64": 98, "arm64": 98}.get(platform.machine())
+
+_libc = ctypes.CDLL(None, use_errno=True)
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+class ShmAgentChannel:
+    def __init__(self, name, timeout=30.0):
+        path = "/dev/shm/" + name
+        deadline = time.monotonic() + timeout
+        # The simulation creates the segment and writes the magic last
+        while True:
+            if os.path.exists(path) and os.path.getsize(path) >= HEADER_BYTES:
+                fd = os.open(path, os.O_RDWR)
+                self._mm = mmap.mmap(fd, os.path.getsize(path))
+                os.close(fd)
+                if struct.unpack_from("<I", self._mm, 0)[0] == MAGIC:
+                    break
+                self._mm.close()
+            if time.monotonic() > deadline:
+                raise TimeoutError("shared-memory segment %s not ready" % name)
+            time.sleep(0.01)
+
+        (_, version, self.obs_size, self.action_size, self.depth,
+         self._obs_stride, self._act_stride) = struct.unpack_from("<7I", self._mm, 0)
+        if version != VERSION:
+            raise RuntimeError("unsupported transport version %d" % version)
+
+        self._obs_seq = ctypes.c_uint32.from_buffer(self._mm, OBS_SEQ_OFFSET)
+        self._act_seq = ctypes.c_uint32.from_buffer(self._mm, ACT_SEQ_OFFSET)
+        self._closed = ctypes.c_uint32.from_buffer(self._mm, CLOSED_OFFSET)
+        self._act_base = HEADER_BYTES + self.depth * self._obs_stride
+        self._obs_views = [
+            np.frombuffer(self._mm, np.float32, self.obs_size,
+                          HEADER_BYTES + k * self._obs_stride + SLOT_HEADER_BYTES)
+            for k in range(self.depth)]
+        self._act_views = [
+            np.frombuffer(self._mm, np.uint32, self.action_size,
+                          self._act_base + k * self._act_stride + SLOT_HEADER_BYTES)
+            for k in range(self.depth)]
+        self.last_seq = self._act_seq.value
+        self.applied_seq = 0
+        self.action_lag = 0
+
+    def _futex(self, word, op, value, timeout=None):
+        if SYS_FUTEX is None:
+            time.sleep(50e-6)
+            return
+        ts = None
+        if timeout is not None:
+            ts = ctypes.byref(_Timespec(int(timeout), int((timeout % 1) * 1e9)))
+        _libc.syscall(SYS_FUTEX, ctypes.c_void_p(ctypes.addressof(word)), op, value, ts, None, 0)
+
+    def recv(self, timeout=None):
+        """Wait for the next observation; returns (obs, reward, done) or (None, 0, True)."""
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while True:
+            seq = self._obs_seq.value
+            if seq != self.last_seq:
+                break
+            if self._closed.value:
+                return None, 0.0, True
+            left = None if deadline is None else deadline - time.monotonic()
+            if left is not None and left <= 0:
+                raise TimeoutError("no observation from the simulation")
+            self._futex(self._obs_seq, FUTEX_WAIT, seq, left if left is not None else 1.0)
+        self.last_seq = self.last_seq + 1
+        slot = HEADER_BYTES + ((self.last_seq - 1) % self.depth) * self._obs_stride
+        _, flags, reward, self.applied_seq = struct.unpack_from("<IIfI", self._mm, slot)
+        self.action_lag = (self.last_seq - 1 - self.applied_seq) if self.applied_seq else 0
+        return self._obs_views[(self.last_seq - 1) % self.depth], reward, bool(flags)
+
+    def send(self, action):
+        """Publish the action answering the last observation returned by recv."""
+        view = self._act_views[(self.last_seq - 1) % self.depth]
+        view[:] = np.asarray(action, dtype=np.uint32).reshape(-1)[:self.action_size]
+        slot = self._act_base + ((self.last_seq - 1) % self.depth) * self._act_stride
+        struct.pack_into("<I", self._mm, slot, self.last_seq)
+        self._act_seq.value = self.last_seq
+        self._futex(self._act_seq, FUTEX_WAKE, 0x7FFFFFFF)
+
+    def close(self):
+        self._closed.value = 1
+        self._futex(self._act_seq, FUTEX_WAKE, 0x7FFFFFFF)
+        del self._obs_seq, self._act_seq, self._closed
+        self._obs_views = self._act_views = None
+        self._mm.close()
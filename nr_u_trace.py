@@ -0,0 +1,113 @@
+"""Decoder of the trace rings dumped by NrUTraceRing (see nr-u-trace-ring.h).
+
+    rings = read_trace("run.nrut")      # {thread: numpy structured array}
+    python3 nr_u_trace.py run.nrut      # one line per record, all threads by time
+    python3 nr_u_trace.py run.nrut --csv --type LBT_OUTCOME --bwp 1
+
+Records keep the order they were written in within each thread; printing
+merges the threads by time (stable, so same-time records stay in order).
+"""
+import argparse
+import csv
+import struct
+import sys
+
+import numpy as np
+
+MAGIC = 0x5455524E
+VERSION = 1
+RECORD = np.dtype([("time", "<i8"), ("type", "<u2"), ("bwp", "<u2"), ("ue", "<u4"),
+                   ("a", "<u8"), ("b", "<u8")])
+
+TYPES = {1: "LBT_ATTEMPT", 2: "LBT_OUTCOME", 3: "BWP_SWITCH", 4: "ALLOCATION", 5: "DECISION"}
+LBT_OUTCOMES = {0: "granted", 1: "icca_busy", 2: "ecca_interrupted"}
+ALGORITHMS = {0: "LCA", 1: "RLA", 2: "External"}
+
+
+def read_trace(path):
+    """Return {thread: records} with the records of each ring oldest first."""
+    with open(path, "rb") as f:
+        buf = f.read()
+    if len(buf) < 16:
+        raise ValueError("truncated NR-U trace file")
+    magic, version, record_size, num_rings = struct.unpack_from("<4I", buf, 0)
+    if magic != MAGIC or version != VERSION or record_size != RECORD.itemsize:
+        raise ValueError("not an NR-U trace file (version %d)" % VERSION)
+    offset = 16
+    rings = {}
+    for _ in range(num_rings):
+        if offset + 24 > len(buf):
+            break   # dump cut short
+        thread, _, written, count = struct.unpack_from("<IIQQ", buf, offset)
+        offset += 24
+        count = min(count, (len(buf) - offset) // RECORD.itemsize)
+        rings[thread] = np.frombuffer(buf, RECORD, count, offset)
+        offset += count * RECORD.itemsize
+        if written > count:
+            print("thread %d: %d oldest records overwritten" % (thread, written - count),
+                  file=sys.stderr)
+    return rings
+
+
+def merge_by_time(rings):
+    """Return all records with a thread column, ordered by time."""
+    parts = []
+    for thread, records in rings.items():
+        part = np.empty(len(records), RECORD.descr + [("thread", "<u4")])
+        for name in RECORD.names:
+            part[name] = records[name]
+        part["thread"] = thread
+        parts.append(part)
+    if not parts:
+        return np.empty(0, RECORD.descr + [("thread", "<u4")])
+    merged = np.concatenate(parts)
+    return merged[np.argsort(merged["time"], kind="stable")]
+
+
+def describe(record):
+    """Return the type-specific fields of a record as text."""
+    kind, bwp, ue, a, b = (int(record[n]) for n in ("type", "bwp", "ue", "a", "b"))
+    if kind == 1:
+        return "bwp=%d cw=%d" % (bwp, a)
+    if kind == 2:
+        return "bwp=%d %s backoff=%d" % (bwp, LBT_OUTCOMES.get(a, a), b)
+    if kind == 3:
+        return "ue=%d bwp %d -> %d" % (ue, a, bwp)
+    if kind == 4:
+        return "ue=%d bwp=%d rbs=%d bits=%d" % (ue, bwp, a, b)
+    if kind == 5:
+        return "window=%d ues=%d %s" % (a, ue, ALGORITHMS.get(b, b))
+    return "bwp=%d ue=%d a=%d b=%d" % (bwp, ue, a, b)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help="file written by NrUTraceRing::Dump")
+    parser.add_argument("--csv", action="store_true", help="write CSV instead of text")
+    parser.add_argument("--type", choices=sorted(TYPES.values()), help="only this record type")
+    parser.add_argument("--bwp", type=int, help="only records of this BWP")
+    parser.add_argument("--ue", type=int, help="only records of this UE")
+    args = parser.parse_args()
+
+    records = merge_by_time(read_trace(args.trace))
+    if args.type:
+        records = records[records["type"] == {v: k for k, v in TYPES.items()}[args.type]]
+    if args.bwp is not None:
+        records = records[records["bwp"] == args.bwp]
+    if args.ue is not None:
+        records = records[records["ue"] == args.ue]
+
+    if args.csv:
+        writer = csv.writer(sys.stdout)
+        writer.writerow(["time_ns", "thread", "type", "bwp", "ue", "a", "b"])
+        for r in records:
+            writer.writerow([int(r["time"]), int(r["thread"]), TYPES.get(int(r["type"]), int(r["type"])),
+                             int(r["bwp"]), int(r["ue"]), int(r["a"]), int(r["b"])])
+    else:
+        for r in records:
+            print("%14.6f ms  t%-3d %-12s %s" % (r["time"] / 1e6, r["thread"],
+                                                 TYPES.get(int(r["type"]), r["type"]), describe(r)))
+
+
+if __name__ == "__main__":
+    main()
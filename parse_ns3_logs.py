@@ -12,21 +12,36 @@ import matplotlib.pyplot as plt
 import xml.etree.ElementTree as ET
 from pathlib import Path
 import numpy as np
+from nr_u_metrics import CSV_NAMES, read_metrics_frame
 
 # Constants matching paper parameters
 PAPER_ALPHA = 1.0  # Delay weight in reward function
 PAPER_BETA = 1.0   # Throughput weight in reward function
 BASELINE_DELAY = 1.0  # Normalized baseline values
 BASELINE_THROUGHPUT = 1.0
+SLOT_DURATION = 0.5e-3  # Seconds per slot, the unit of AvgHolDelay
 
-def parse_simulation_csv(csv_file):
-    """Parse the main simulation stats CSV file."""
-    df = pd.read_csv(csv_file)
+def has_reward(df):
+    """Whether the run recorded the agent's reward (NaN without an RL environment)."""
+    return 'Reward' in df and df['Reward'].notna().any()
+
+def parse_simulation_csv(csv_file, slot_duration=SLOT_DURATION):
+    """Parse the main simulation stats CSV file, or the window metrics
+    file (.nrum) written by the scheduler's MetricsFile attribute."""
+    if str(csv_file).endswith('.nrum'):
+        df = read_metrics_frame(csv_file)
+    else:
+        df = pd.read_csv(csv_file).rename(columns=CSV_NAMES)
+   
+    # Older CSV outputs give the delay in seconds
+    if 'AvgHolDelay' not in df and 'AvgHolDelaySeconds' in df:
+        df['AvgHolDelay'] = df['AvgHolDelaySeconds'] / slot_duration
    
     # Calculate moving averages for smoothing
     df['AvgHolDelaySmooth'] = df['AvgHolDelay'].rolling(window=10).mean()
     df['TotalThroughputSmooth'] = df['TotalThroughput'].rolling(window=10).mean()
-    df['RewardSmooth'] = df['Reward'].rolling(window=10).mean()
+    if has_reward(df):
+        df['RewardSmooth'] = df['Reward'].rolling(window=10).mean()
    
     return df
 
@@ -58,21 +73,24 @@ def generate_plots(stats_df, algorithm, output_dir):
     output_dir.mkdir(exist_ok=True)
    
     # Plot 1: Reward convergence (Fig 2a)
-    plt.figure(figsize=(10, 6))
-    plt.plot(stats_df['Time'], stats_df['RewardSmooth'], label='Smoothed Reward')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Reward')
-    plt.title(f'Reward Convergence ({algorithm} Algorithm)')
-    plt.grid(True)
-    plt.savefig(output_dir / f'reward_convergence_{algorithm}.png')
-    plt.close()
+    if has_reward(stats_df):
+        plt.figure(figsize=(10, 6))
+        plt.plot(stats_df['Time'], stats_df['RewardSmooth'], label='Smoothed Reward')
+        plt.xlabel('Time (s)')
+        plt.ylabel('Reward')
+        plt.title(f'Reward Convergence ({algorithm} Algorithm)')
+        plt.grid(True)
+        plt.savefig(output_dir / f'reward_convergence_{algorithm}.png')
+        plt.close()
+    else:
+        print(f"No reward recorded for {algorithm}, skipping the reward plot")
    
     # Plot 2: Delay and Throughput (Fig 2b)
     fig, ax1 = plt.subplots(figsize=(10, 6))
    
     color = 'tab:red'
     ax1.set_xlabel('Time (s)')
-    ax1.set_ylabel('Avg HoL Delay', color=color)
+    ax1.set_ylabel('Avg HoL Delay (slots)', color=color)
     ax1.plot(stats_df['Time'], stats_df['AvgHolDelaySmooth'], color=color)
     ax1.tick_params(axis='y', labelcolor=color)
    
@@ -103,17 +121,19 @@ def compare_algorithms(results_dict, output_dir):
     """Generate comparative plots between algorithms."""
     output_dir = Path(output_dir)
    
-    # Comparative reward plot
-    plt.figure(figsize=(10, 6))
-    for algo, df in results_dict.items():
-        plt.plot(df['Time'], df['RewardSmooth'], label=algo)
-    plt.xlabel('Time (s)')
-    plt.ylabel('Reward')
-    plt.title('Algorithm Comparison: Reward Convergence')
-    plt.legend()
-    plt.grid(True)
-    plt.savefig(output_dir / 'comparison_reward.png')
-    plt.close()
+    # Comparative reward plot, over the runs that recorded a reward
+    rewarded = {algo: df for algo, df in results_dict.items() if has_reward(df)}
+    if rewarded:
+        plt.figure(figsize=(10, 6))
+        for algo, df in rewarded.items():
+            plt.plot(df['Time'], df['RewardSmooth'], label=algo)
+        plt.xlabel('Time (s)')
+        plt.ylabel('Reward')
+        plt.title('Algorithm Comparison: Reward Convergence')
+        plt.legend()
+        plt.grid(True)
+        plt.savefig(output_dir / 'comparison_reward.png')
+        plt.close()
    
     # Comparative delay-throughput
     fig, (ax1, ax2) = plt.subplots(2, 1, figsize=(10, 12))
@@ -122,7 +142,7 @@ def compare_algorithms(results_dict, output_dir):
         ax1.plot(df['Time'], df['AvgHolDelaySmooth'], label=algo)
         ax2.plot(df['Time'], df['TotalThroughputSmooth'], label=algo)
    
-    ax1.set_ylabel('Avg HoL Delay')
+    ax1.set_ylabel('Avg HoL Delay (slots)')
     ax1.set_title('Algorithm Comparison: Delay')
     ax1.legend()
     ax1.grid(True)
@@ -165,7 +185,7 @@ def compare_algorithms(results_dict, output_dir):
         # Generate summary table
         summary = pd.DataFrame({
             'Algorithm': ['Baseline', 'LCA', 'RLA'],
-            'Avg HoL Delay': [baseline_delay, lca_delay, rla_delay],
+            'Avg HoL Delay (slots)': [baseline_delay, lca_delay, rla_delay],
             'Delay Improvement %': ['-',
                                   f"{lca_delay_improvement:.2f}%",
                                   f"{rla_delay_improvement:.2f}%"],
@@ -183,7 +203,7 @@ def compare_algorithms(results_dict, output_dir):
 
 def main():
     parser = argparse.ArgumentParser(description='Parse and analyze NR-U simulation logs')
-    parser.add_argument('--csv', required=True, help='Input CSV file from simulation')
+    parser.add_argument('--csv', required=True, help='Input CSV or .nrum metrics file from simulation')
     parser.add_argument('--xml', help='Flow monitor XML file')
     parser.add_argument('--algorithm', required=True,
                        choices=['LCA', 'RLA', 'BASELINE'],
@@ -0,0 +1,83 @@
+"""Plot the scaling curves written by nr-u-scale and point out superlinear phases.
+
+    python3 plot_scaling.py scaling.csv [output_dir]
+
+For every BWP count, wall time per simulated second (total and per phase),
+peak RSS and event-queue size are drawn against the UE count on log-log
+axes. Between consecutive UE counts, the local exponent
+d log(time) / d log(UEs) of each phase is printed; above 1 the phase grows
+faster than the number of UEs.
+"""
+import sys
+from pathlib import Path
+
+import numpy as np
+import pandas as pd
+import matplotlib.pyplot as plt
+
+PHASES = ["traffic", "candidates", "lbt", "allocation", "other"]
+SUPERLINEAR = 1.15   # exponents above this are reported
+
+
+def local_exponents(ues, values):
+    ues = np.asarray(ues, dtype=float)
+    values = np.maximum(np.asarray(values, dtype=float), 1e-12)
+    return np.diff(np.log(values)) / np.diff(np.log(ues))
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+    df = pd.read_csv(sys.argv[1])
+    output_dir = Path(sys.argv[2] if len(sys.argv) > 2 else "scaling")
+    output_dir.mkdir(exist_ok=True)
+
+    for bwps, group in df.groupby("bwps"):
+        group = group.sort_values("ues")
+        ues = group["ues"].values
+
+        plt.figure(figsize=(10, 6))
+        plt.loglog(ues, group["wall_per_sim_second"], "k-o", label="total")
+        for phase in PHASES:
+            plt.loglog(ues, group[f"{phase}_seconds"] / group["sim_seconds"], "-o", label=phase)
+        plt.xlabel("UEs")
+        plt.ylabel("Wall seconds per simulated second")
+        plt.title(f"Scaling with {bwps} BWPs per cell")
+        plt.legend()
+        plt.grid(True, which="both")
+        plt.savefig(output_dir / f"scaling_time_{bwps}bwps.png")
+        plt.close()
+
+        fig, (ax1, ax2) = plt.subplots(2, 1, figsize=(10, 10))
+        ax1.loglog(ues, group["peak_rss_mb"], "-o")
+        ax1.set_ylabel("Peak RSS (MB)")
+        ax1.grid(True, which="both")
+        ax2.loglog(ues, group["peak_event_queue"], "-o", label="peak")
+        ax2.loglog(ues, group["mean_event_queue"], "-o", label="mean")
+        ax2.set_xlabel("UEs")
+        ax2.set_ylabel("Events queued")
+        ax2.legend()
+        ax2.grid(True, which="both")
+        fig.suptitle(f"Memory and event queue with {bwps} BWPs per cell")
+        fig.tight_layout()
+        plt.savefig(output_dir / f"scaling_memory_{bwps}bwps.png")
+        plt.close()
+
+        if len(ues) < 2:
+            continue
+        print(f"\nLocal exponents, {bwps} BWPs (UEs -> UEs: exponent)")
+        series = {"total": group["wall_per_sim_second"].values,
+                  "rss": group["peak_rss_mb"].values,
+                  "event_queue": group["peak_event_queue"].values}
+        for phase in PHASES:
+            series[phase] = group[f"{phase}_seconds"].values
+        for name, values in series.items():
+            exponents = local_exponents(ues, values)
+            cells = [f"{a}->{b}: {e:.2f}{' !' if e > SUPERLINEAR else ''}"
+                     for a, b, e in zip(ues[:-1], ues[1:], exponents)]
+            print(f"  {name:12s} " + "  ".join(cells))
+
+
+if __name__ == "__main__":
+    main()